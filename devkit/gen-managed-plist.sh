@@ -64,13 +64,19 @@ add_bool NaturalScroll         "${TVNC_NATURAL_SCROLL:-}"
 add_bool AutoAssistEnabled     "${TVNC_AUTO_ASSIST_ENABLED:-}"
 add_bool ServerCursor          "${TVNC_SERVER_CURSOR:-}"
 add_bool AsyncSwap             "${TVNC_ASYNC_SWAP:-}"
+add_bool ZeroCopy              "${TVNC_ZERO_COPY:-}"
 add_bool BonjourEnabled        "${TVNC_BONJOUR_ENABLED:-}"
 add_bool KeyLogging            "${TVNC_KEY_LOGGING:-}"
+add_bool AdaptiveTileSize      "${TVNC_ADAPTIVE_TILE_SIZE:-}"
+add_bool AutoCalibrate         "${TVNC_AUTO_CALIBRATE:-}"
 
 # Strings (optional)
 add_str DesktopName            "${TVNC_DESKTOP_NAME:-}"
 add_str FrameRateSpec          "${TVNC_FRAME_RATE_SPEC:-}"
 add_str WheelTuning            "${TVNC_WHEEL_TUNING:-}"
+add_str DirtyTuning            "${TVNC_DIRTY_TUNING:-}"
+add_str RegionMasks            "${TVNC_REGION_MASKS:-}"
+add_str ScaleQuality           "${TVNC_SCALE_QUALITY:-}"
 add_str HttpDir                "${TVNC_HTTP_DIR:-}"
 add_str SslCertFile            "${TVNC_SSL_CERT_FILE:-}"
 add_str SslKeyFile             "${TVNC_SSL_KEY_FILE:-}"
@@ -0,0 +1,144 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DamageMapper.h"
+
+#include <algorithm>
+
+// MARK: - Rotation
+
+DirtyRect DamageMapper::rotateRect(const DirtyRect &r, int srcWidth, int srcHeight, int rotQ) {
+    switch (rotQ & 3) {
+    case 1: // (x, y) -> (H - 1 - y, x)
+        return DirtyRect{srcHeight - r.y - r.h, r.x, r.h, r.w};
+    case 2: // (x, y) -> (W - 1 - x, H - 1 - y)
+        return DirtyRect{srcWidth - r.x - r.w, srcHeight - r.y - r.h, r.w, r.h};
+    case 3: // (x, y) -> (y, W - 1 - x)
+        return DirtyRect{r.y, srcWidth - r.x - r.w, r.h, r.w};
+    default:
+        return r;
+    }
+}
+
+DirtyRect DamageMapper::unrotateRect(const DirtyRect &r, int srcWidth, int srcHeight, int rotQ) {
+    switch (rotQ & 3) {
+    case 1:
+        return DirtyRect{r.y, srcHeight - r.x - r.w, r.h, r.w};
+    case 2:
+        return DirtyRect{srcWidth - r.x - r.w, srcHeight - r.y - r.h, r.w, r.h};
+    case 3:
+        return DirtyRect{srcWidth - r.y - r.h, r.x, r.h, r.w};
+    default:
+        return r;
+    }
+}
+
+// MARK: - Cut Points
+
+// A cut point maps to output space within 1/32 px of an integer. 0 and srcLen always qualify.
+bool DamageMapper::Axis::isCut(int x) const {
+    long long rem = ((long long)x * (long long)dstLen) % (long long)srcLen;
+    long long err = std::min(rem, (long long)srcLen - rem);
+    return err * 32 <= (long long)srcLen;
+}
+
+int DamageMapper::Axis::cutBelow(int x) const {
+    x = std::clamp(x, 0, srcLen);
+    while (x > 0 && !isCut(x))
+        x--;
+    return x;
+}
+
+int DamageMapper::Axis::cutAbove(int x) const {
+    x = std::clamp(x, 0, srcLen);
+    while (x < srcLen && !isCut(x))
+        x++;
+    return x;
+}
+
+int DamageMapper::Axis::toDst(int x) const {
+    return (int)(((long long)x * (long long)dstLen + srcLen / 2) / (long long)srcLen);
+}
+
+// MARK: - Mapping
+
+void DamageMapper::configure(int srcWidth, int srcHeight, int rotQ, int dstWidth, int dstHeight, bool scaled,
+                             int haloPx) {
+    mSrcW = srcWidth;
+    mSrcH = srcHeight;
+    mRotQ = rotQ & 3;
+    mRotW = (mRotQ % 2 == 0) ? srcWidth : srcHeight;
+    mRotH = (mRotQ % 2 == 0) ? srcHeight : srcWidth;
+    mDstW = dstWidth;
+    mDstH = dstHeight;
+    mScaled = scaled;
+    mHalo = haloPx < 0 ? 0 : haloPx;
+    mAxisX.srcLen = mRotW;
+    mAxisX.dstLen = dstWidth;
+    mAxisY.srcLen = mRotH;
+    mAxisY.dstLen = dstHeight;
+}
+
+bool DamageMapper::map(const DirtyRect &srcDirty, DamageJob *outJob) const {
+    if (mRotW <= 0 || mRotH <= 0 || mDstW <= 0 || mDstH <= 0 || srcDirty.w <= 0 || srcDirty.h <= 0)
+        return false;
+
+    DirtyRect rot = rotateRect(srcDirty, mSrcW, mSrcH, mRotQ);
+    DamageJob job;
+
+    if (!mScaled) {
+        // 1:1 copy: clip to the overlap, then extend over the padding it feeds
+        int overlapW = std::min(mRotW, mDstW);
+        int overlapH = std::min(mRotH, mDstH);
+        int x0 = std::max(rot.x, 0), y0 = std::max(rot.y, 0);
+        int x1 = std::min(rot.x + rot.w, overlapW), y1 = std::min(rot.y + rot.h, overlapH);
+        if (x1 <= x0 || y1 <= y0)
+            return false;
+        job.rotRender = DirtyRect{x0, y0, x1 - x0, y1 - y0};
+        job.dstRender = job.rotRender;
+        int ix1 = (x1 == overlapW) ? mDstW : x1;
+        int iy1 = (y1 == overlapH) ? mDstH : y1;
+        job.dstInterior = DirtyRect{x0, y0, ix1 - x0, iy1 - y0};
+    } else {
+        // Interior: dirty + halo, snapped outwards to cut points
+        int ix0 = mAxisX.cutBelow(rot.x - mHalo);
+        int iy0 = mAxisY.cutBelow(rot.y - mHalo);
+        int ix1 = mAxisX.cutAbove(rot.x + rot.w + mHalo);
+        int iy1 = mAxisY.cutAbove(rot.y + rot.h + mHalo);
+        // Render region: interior + halo, snapped outwards to cut points
+        int rx0 = mAxisX.cutBelow(ix0 - mHalo);
+        int ry0 = mAxisY.cutBelow(iy0 - mHalo);
+        int rx1 = mAxisX.cutAbove(ix1 + mHalo);
+        int ry1 = mAxisY.cutAbove(iy1 + mHalo);
+
+        int dix0 = mAxisX.toDst(ix0), diy0 = mAxisY.toDst(iy0);
+        int dix1 = mAxisX.toDst(ix1), diy1 = mAxisY.toDst(iy1);
+        int drx0 = mAxisX.toDst(rx0), dry0 = mAxisY.toDst(ry0);
+        int drx1 = mAxisX.toDst(rx1), dry1 = mAxisY.toDst(ry1);
+        if (dix1 <= dix0 || diy1 <= diy0 || rx1 <= rx0 || ry1 <= ry0)
+            return false;
+
+        job.rotRender = DirtyRect{rx0, ry0, rx1 - rx0, ry1 - ry0};
+        job.dstRender = DirtyRect{drx0, dry0, drx1 - drx0, dry1 - dry0};
+        job.dstInterior = DirtyRect{dix0, diy0, dix1 - dix0, diy1 - diy0};
+    }
+
+    job.srcRect = unrotateRect(job.rotRender, mSrcW, mSrcH, mRotQ);
+    if (outJob)
+        *outJob = job;
+    return true;
+}
@@ -0,0 +1,90 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef DamageMapper_h
+#define DamageMapper_h
+
+#include "TileDiffEngine.h"
+
+/** One partial render: rotate `srcRect`, scale the result to `dstRender`, keep only `dstInterior`. */
+typedef struct {
+    DirtyRect srcRect;     // region to read, portrait source space
+    DirtyRect rotRender;   // same region in rotated space
+    DirtyRect dstRender;   // rotRender mapped to output space (size of the scaled temp)
+    DirtyRect dstInterior; // output pixels to write back (inside dstRender)
+} DamageJob;
+
+/**
+ DamageMapper
+ ----------------
+ Maps dirty rectangles found on the portrait capture to partial rotate/scale jobs
+ in output space, so only changed regions need to be rotated and resampled.
+
+ Scaled output:
+ - The dirty region is grown by the resampling halo (changed source pixels
+   affect output pixels within the kernel support) to form the interior, and
+   by the halo again to form the render region, so interior pixels see the
+   same neighbourhood as in a full-frame scale.
+ - Region edges snap to "cut points": rotated-space coordinates whose output
+   coordinate is (nearly) an integer. Scaling a region between cut points then
+   samples at the same positions as scaling the whole frame (within 1/32 px).
+
+ Unscaled output (1:1 copy with pad/crop):
+ - The interior is the rotated rect clipped to the output, extended over the
+   right/bottom padding when it touches the last source column/row.
+ */
+class DamageMapper {
+  public:
+    DamageMapper() = default;
+
+    /** Geometry: portrait source, rotQ quarter turns clockwise, output size. haloPx is in rotated-space pixels. */
+    void configure(int srcWidth, int srcHeight, int rotQ, int dstWidth, int dstHeight, bool scaled, int haloPx);
+
+    /** Map a source-space dirty rect. Returns false if nothing of it is visible in the output. */
+    bool map(const DirtyRect &srcDirty, DamageJob *outJob) const;
+
+    int rotatedWidth() const { return mRotW; }
+    int rotatedHeight() const { return mRotH; }
+
+    /** Rect in source space -> rotated space (rotQ quarter turns clockwise), and back. */
+    static DirtyRect rotateRect(const DirtyRect &r, int srcWidth, int srcHeight, int rotQ);
+    static DirtyRect unrotateRect(const DirtyRect &r, int srcWidth, int srcHeight, int rotQ);
+
+  private:
+    struct Axis {
+        int srcLen = 0;
+        int dstLen = 0;
+        bool isCut(int x) const;
+        int cutBelow(int x) const;
+        int cutAbove(int x) const;
+        int toDst(int x) const;
+    };
+
+    int mSrcW = 0;
+    int mSrcH = 0;
+    int mRotQ = 0;
+    int mRotW = 0;
+    int mRotH = 0;
+    int mDstW = 0;
+    int mDstH = 0;
+    bool mScaled = false;
+    int mHalo = 0;
+    Axis mAxisX;
+    Axis mAxisY;
+};
+
+#endif /* DamageMapper_h */
@@ -0,0 +1,173 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DuplicateTileFinder.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const int kMaxSources = 4; // nearest published tiles with the same hash that vote per dirty tile
+
+// Offsets in tiles (|offset| < 0x4000), packed into one non-negative int so votes sort and count cheaply
+static inline int packOffset(int dtx, int dty) { return (dty + 0x4000) << 16 | (dtx + 0x4000); }
+static inline int offsetX(int packed) { return (packed & 0xFFFF) - 0x4000; }
+static inline int offsetY(int packed) { return (packed >> 16) - 0x4000; }
+
+// MARK: - Configuration
+
+void DuplicateTileFinder::configure(int width, int height, int tileSize, int bytesPerPixel) {
+    tileSize = std::max(1, tileSize);
+    if (width == mWidth && height == mHeight && tileSize == mTileSize && bytesPerPixel == mBytesPerPixel)
+        return;
+    mWidth = width;
+    mHeight = height;
+    mTileSize = tileSize;
+    mBytesPerPixel = bytesPerPixel;
+    mTilesX = width / tileSize;
+    mTilesY = height / tileSize;
+    mGridX = (width + tileSize - 1) / tileSize;
+    int gridY = (height + tileSize - 1) / tileSize;
+    mMask.assign((size_t)mGridX * (size_t)gridY, 0);
+}
+
+// MARK: - Index
+
+void DuplicateTileFinder::buildIndex(const uint64_t *prevHashes) {
+    mIndex.clear();
+    mIndex.reserve((size_t)mTilesX * (size_t)mTilesY);
+    for (int ty = 0; ty < mTilesY; ++ty) {
+        for (int tx = 0; tx < mTilesX; ++tx) {
+            int t = ty * mGridX + tx;
+            mIndex.emplace_back(prevHashes[t], t);
+        }
+    }
+    std::sort(mIndex.begin(), mIndex.end());
+}
+
+bool DuplicateTileFinder::tileEqual(const uint8_t *cur, const uint8_t *ref, size_t bytesPerRow, int tile,
+                                    int source) const {
+    const size_t bpp = (size_t)mBytesPerPixel;
+    const size_t len = (size_t)mTileSize * bpp;
+    const uint8_t *a = cur + (size_t)(tile / mGridX * mTileSize) * bytesPerRow + (size_t)(tile % mGridX) * len;
+    const uint8_t *b = ref + (size_t)(source / mGridX * mTileSize) * bytesPerRow + (size_t)(source % mGridX) * len;
+    for (int y = 0; y < mTileSize; ++y) {
+        if (memcmp(a + (size_t)y * bytesPerRow, b + (size_t)y * bytesPerRow, len) != 0)
+            return false;
+    }
+    return true;
+}
+
+// MARK: - Search
+
+int DuplicateTileFinder::find(const uint64_t *currHashes, const uint64_t *prevHashes, const uint8_t *cur,
+                              const uint8_t *ref, size_t bytesPerRow, const DirtyRect *rects, int rectCount,
+                              DirtyRect *moves, int maxMoves, int *outDx, int *outDy, int *outTiles) {
+    if (outTiles)
+        *outTiles = 0;
+    if (!currHashes || !prevHashes || !cur || !ref || mTilesX <= 0 || mTilesY <= 0 || rectCount <= 0 ||
+        maxMoves <= 0)
+        return 0;
+
+    buildIndex(prevHashes);
+
+    // Changed full tiles vote for the offsets to the nearest published tiles with the same hash
+    mVotes.clear();
+    for (int i = 0; i < rectCount; ++i) {
+        const DirtyRect &r = rects[i];
+        int tx0 = r.x / mTileSize, ty0 = r.y / mTileSize;
+        int tx1 = std::min(mTilesX, (r.x + r.w) / mTileSize), ty1 = std::min(mTilesY, (r.y + r.h) / mTileSize);
+        for (int ty = ty0; ty < ty1; ++ty) {
+            for (int tx = tx0; tx < tx1; ++tx) {
+                const int t = ty * mGridX + tx;
+                const uint64_t h = currHashes[t];
+                if (h == prevHashes[t] || mMask[(size_t)t])
+                    continue; // unchanged, or already seen through an overlapping rect
+                mMask[(size_t)t] = 1;
+                auto lo = std::lower_bound(mIndex.begin(), mIndex.end(), std::make_pair(h, 0));
+                auto hi = std::upper_bound(lo, mIndex.end(), std::make_pair(h, INT32_MAX));
+                if (lo == hi)
+                    continue;
+                // Entries of one hash are sorted by position: walk outwards from this tile's position
+                auto mid = std::lower_bound(lo, hi, std::make_pair(h, t));
+                auto left = mid, right = mid;
+                for (int n = 0; n < kMaxSources && (left != lo || right != hi);) {
+                    bool takeRight = left == lo || (right != hi && right->second - t < t - (left - 1)->second);
+                    int source = takeRight ? (right++)->second : (--left)->second;
+                    if (source == t)
+                        continue;
+                    int dtx = tx - source % mGridX, dty = ty - source / mGridX;
+                    mVotes.emplace_back(packOffset(dtx, dty), t);
+                    ++n;
+                }
+            }
+        }
+    }
+    std::fill(mMask.begin(), mMask.end(), 0);
+    if (mVotes.empty())
+        return 0;
+
+    // The offset with the most votes wins; its tiles are verified against the published frame
+    std::sort(mVotes.begin(), mVotes.end());
+    int bestOffset = 0;
+    size_t bestBegin = 0, bestCount = 0;
+    for (size_t i = 0; i < mVotes.size();) {
+        size_t j = i;
+        while (j < mVotes.size() && mVotes[j].first == mVotes[i].first)
+            ++j;
+        if (j - i > bestCount) {
+            bestCount = j - i;
+            bestBegin = i;
+            bestOffset = mVotes[i].first;
+        }
+        i = j;
+    }
+    const int dtx = offsetX(bestOffset), dty = offsetY(bestOffset);
+    const int delta = dty * mGridX + dtx;
+    int tiles = 0;
+    for (size_t i = bestBegin; i < bestBegin + bestCount; ++i) {
+        int t = mVotes[i].second;
+        if (tileEqual(cur, ref, bytesPerRow, t, t - delta)) {
+            mMask[(size_t)t] = 1;
+            ++tiles;
+        }
+    }
+    if (tiles == 0)
+        return 0;
+
+    std::vector<DirtyRect> out;
+    RectCoalescer::tileMaskRects(mMask.data(), mGridX, (int)(mMask.size() / (size_t)mGridX), mTileSize, mWidth,
+                                 mHeight, out);
+    std::fill(mMask.begin(), mMask.end(), 0);
+
+    // Largest first; duplicates that do not fit simply stay dirty
+    std::sort(out.begin(), out.end(),
+              [](const DirtyRect &a, const DirtyRect &b) { return (int64_t)a.w * a.h > (int64_t)b.w * b.h; });
+    int count = std::min(maxMoves, (int)out.size());
+    std::copy(out.begin(), out.begin() + count, moves);
+    if (count < (int)out.size()) {
+        tiles = 0;
+        for (int i = 0; i < count; ++i)
+            tiles += (moves[i].w / mTileSize) * (moves[i].h / mTileSize);
+    }
+    if (outDx)
+        *outDx = dtx * mTileSize;
+    if (outDy)
+        *outDy = dty * mTileSize;
+    if (outTiles)
+        *outTiles = tiles;
+    return count;
+}
@@ -0,0 +1,73 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef DuplicateTileFinder_h
+#define DuplicateTileFinder_h
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "RectCoalescer.h"
+
+/**
+ DuplicateTileFinder
+ ----------------
+ Finds dirty tiles whose exact content is already on screen elsewhere in the
+ published frame (table separators, repeated cells, patterned backgrounds),
+ so they can be sent as CopyRect from that location instead of re-encoded.
+
+ - The published frame's tile hashes (TileDiffEngine, Hash mode) are indexed
+   hash -> tile positions at flush time.
+ - Each changed dirty tile looks its current hash up; the nearest few tiles
+   with that hash vote for their offset (in whole tiles).
+ - CopyRect regions share one offset per client, so only the offset with the
+   most votes is used. Its tiles are verified byte for byte.
+ Only full tiles take part (edge tiles have other dimensions).
+ */
+class DuplicateTileFinder {
+  public:
+    DuplicateTileFinder() = default;
+
+    /** Tile grid of the hashes and frames (must match the TileDiffEngine). */
+    void configure(int width, int height, int tileSize, int bytesPerPixel);
+
+    /** Find duplicates for the changed tiles covered by rects. cur/ref are the new and published frames (same
+        stride); currHashes/prevHashes their tile hashes. Returns the number of move rects written (destination,
+        tile-aligned); outTiles receives the deduplicated tile count. */
+    int find(const uint64_t *currHashes, const uint64_t *prevHashes, const uint8_t *cur, const uint8_t *ref,
+             size_t bytesPerRow, const DirtyRect *rects, int rectCount, DirtyRect *moves, int maxMoves, int *outDx,
+             int *outDy, int *outTiles);
+
+  private:
+    void buildIndex(const uint64_t *prevHashes);
+    bool tileEqual(const uint8_t *cur, const uint8_t *ref, size_t bytesPerRow, int tile, int source) const;
+
+    int mWidth = 0;
+    int mHeight = 0;
+    int mTileSize = 32;
+    int mBytesPerPixel = 4;
+    int mTilesX = 0; // full tiles only
+    int mTilesY = 0;
+    int mGridX = 0; // tile grid including edge tiles (hash array layout)
+    std::vector<std::pair<uint64_t, int>> mIndex; // published hashes of full tiles, sorted
+    std::vector<std::pair<int, int>> mVotes;      // (packed offset, tile)
+    std::vector<uint8_t> mMask;                   // per tile of the grid: deduplicated
+};
+
+#endif /* DuplicateTileFinder_h */
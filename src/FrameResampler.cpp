@@ -0,0 +1,276 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "FrameResampler.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const int kWeightBits = 11;   // per-axis weights sum to 1 << kWeightBits
+static const int kLineBits = 7;      // fraction bits of the line sums (largest value 255 << 7 fits int16)
+static const int kBytesPerPixel = 4;
+static const int kBlockOuter = 32;   // output lines per block along the outer axis
+static const int kBlockInner = 64;   // output pixels per block along the inner axis
+
+// MARK: - Accumulators
+
+// Weighted sums of 4 channels in 32-bit lanes, from 8-bit pixels or 16-bit line sums (weights below 1 << 15).
+#if defined(__aarch64__)
+typedef uint32x4_t PixelAcc;
+static inline PixelAcc accZero() { return vdupq_n_u32(0); }
+static inline PixelAcc accAddPixel(PixelAcc acc, const uint8_t *px, uint32_t w) {
+    uint32_t v;
+    memcpy(&v, px, sizeof(v));
+    return vmlal_n_u16(acc, vget_low_u16(vmovl_u8(vcreate_u8((uint64_t)v))), (uint16_t)w);
+}
+static inline PixelAcc accAddLine(PixelAcc acc, const uint16_t *sum, uint32_t w) {
+    return vmlal_n_u16(acc, vld1_u16(sum), (uint16_t)w);
+}
+static inline void accStoreLine(PixelAcc acc, uint16_t *out) {
+    vst1_u16(out, vqrshrn_n_u32(acc, kWeightBits - kLineBits));
+}
+static inline uint32_t accPixel(PixelAcc acc) {
+    uint16x4_t n = vqmovn_u32(vrshrq_n_u32(acc, kWeightBits + kLineBits));
+    return vget_lane_u32(vreinterpret_u32_u8(vqmovn_u16(vcombine_u16(n, n))), 0);
+}
+#elif defined(__SSE2__)
+typedef __m128i PixelAcc;
+static inline PixelAcc accZero() { return _mm_setzero_si128(); }
+// Each 32-bit lane holds (channel, 0) and (w, 0): madd yields channel * w
+static inline PixelAcc accAddPixel(PixelAcc acc, const uint8_t *px, uint32_t w) {
+    uint32_t v;
+    memcpy(&v, px, sizeof(v));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i p = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)v), zero), zero);
+    return _mm_add_epi32(acc, _mm_madd_epi16(p, _mm_set1_epi32((int)w)));
+}
+static inline PixelAcc accAddLine(PixelAcc acc, const uint16_t *sum, uint32_t w) {
+    __m128i p = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)sum), _mm_setzero_si128());
+    return _mm_add_epi32(acc, _mm_madd_epi16(p, _mm_set1_epi32((int)w)));
+}
+static inline void accStoreLine(PixelAcc acc, uint16_t *out) {
+    const int shift = kWeightBits - kLineBits;
+    acc = _mm_srli_epi32(_mm_add_epi32(acc, _mm_set1_epi32(1 << (shift - 1))), shift);
+    _mm_storel_epi64((__m128i *)out, _mm_packs_epi32(acc, acc));
+}
+static inline uint32_t accPixel(PixelAcc acc) {
+    const int shift = kWeightBits + kLineBits;
+    acc = _mm_srli_epi32(_mm_add_epi32(acc, _mm_set1_epi32(1 << (shift - 1))), shift);
+    acc = _mm_packs_epi32(acc, acc);
+    return (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+}
+#else
+struct PixelAcc {
+    uint32_t c[4];
+};
+static inline PixelAcc accZero() { return PixelAcc{{0, 0, 0, 0}}; }
+static inline PixelAcc accAddPixel(PixelAcc acc, const uint8_t *px, uint32_t w) {
+    for (int i = 0; i < 4; ++i)
+        acc.c[i] += (uint32_t)px[i] * w;
+    return acc;
+}
+static inline PixelAcc accAddLine(PixelAcc acc, const uint16_t *sum, uint32_t w) {
+    for (int i = 0; i < 4; ++i)
+        acc.c[i] += (uint32_t)sum[i] * w;
+    return acc;
+}
+static inline void accStoreLine(PixelAcc acc, uint16_t *out) {
+    const int shift = kWeightBits - kLineBits;
+    for (int i = 0; i < 4; ++i)
+        out[i] = (uint16_t)((acc.c[i] + (1u << (shift - 1))) >> shift);
+}
+static inline uint32_t accPixel(PixelAcc acc) {
+    const int shift = kWeightBits + kLineBits;
+    uint8_t b[4];
+    for (int i = 0; i < 4; ++i)
+        b[i] = (uint8_t)std::min<uint32_t>(255, (acc.c[i] + (1u << (shift - 1))) >> shift);
+    uint32_t v;
+    memcpy(&v, b, sizeof(v));
+    return v;
+}
+#endif
+
+// MARK: - Configuration
+
+void FrameResampler::Axis::build(int srcLen, int dstLen, ResampleFilter filter) {
+    const int64_t s = srcLen, d = dstLen;
+    const int one = 1 << kWeightBits;
+    const int boxTaps = std::clamp((int)((s + d / 2) / d), 1, srcLen);
+    switch (filter) {
+    case ResampleFilter::Box:
+        maxTaps = boxTaps;
+        break;
+    case ResampleFilter::Bilinear:
+        maxTaps = 2;
+        break;
+    default:
+        maxTaps = (srcLen + dstLen - 1) / dstLen + 1;
+        break;
+    }
+    first.assign((size_t)dstLen, 0);
+    count.assign((size_t)dstLen, 0);
+    weights.assign((size_t)dstLen * (size_t)maxTaps, 0);
+
+    for (int i = 0; i < dstLen; ++i) {
+        uint16_t *w = &weights[(size_t)i * (size_t)maxTaps];
+        int k0 = 0, n = 0;
+        if (filter == ResampleFilter::Box) {
+            k0 = std::min(srcLen - boxTaps, (int)(i * s / d));
+            n = boxTaps;
+            for (int k = 0; k < n; ++k)
+                w[k] = (uint16_t)(one * (k + 1) / n - one * k / n); // remainder spread evenly, sums to one
+        } else if (filter == ResampleFilter::Bilinear) {
+            // Footprint center in rotated pixels: ((2i + 1) * s - d) / (2d), clamped to the source
+            const int64_t c2 = std::clamp<int64_t>((2 * i + 1) * s - d, 0, 2 * d * (s - 1));
+            k0 = (int)(c2 / (2 * d));
+            const int frac = (int)(((c2 - k0 * 2 * d) * one + d) / (2 * d));
+            n = (frac > 0 && k0 + 1 < srcLen) ? 2 : 1;
+            w[0] = (uint16_t)(n == 2 ? one - frac : one);
+            if (n == 2)
+                w[1] = (uint16_t)frac;
+        } else {
+            // Footprint [a, b) in 1/dstLen rotated pixels; tap k covers [k * d, (k + 1) * d)
+            const int64_t a = i * s, b = (i + 1) * s;
+            k0 = (int)(a / d);
+            n = std::min(srcLen, (int)((b + d - 1) / d)) - k0;
+            int sum = 0, largest = 0;
+            for (int k = 0; k < n; ++k) {
+                const int64_t cover = std::min(b, (k0 + k + 1) * d) - std::max(a, (k0 + k) * d);
+                w[k] = (uint16_t)((cover * one + s / 2) / s);
+                sum += w[k];
+                if (w[k] > w[largest])
+                    largest = k;
+            }
+            w[largest] = (uint16_t)(w[largest] + one - sum); // rounding slack goes to the largest tap
+        }
+        first[(size_t)i] = k0;
+        count[(size_t)i] = n;
+    }
+}
+
+void FrameResampler::configure(int srcWidth, int srcHeight, int rotQ, int dstWidth, int dstHeight,
+                               ResampleFilter filter) {
+    rotQ &= 3;
+    if (srcWidth == mSrcW && srcHeight == mSrcH && rotQ == mRotQ && dstWidth == mDstW && dstHeight == mDstH &&
+        filter == mFilter)
+        return;
+    mSrcW = srcWidth;
+    mSrcH = srcHeight;
+    mRotQ = rotQ;
+    mDstW = dstWidth;
+    mDstH = dstHeight;
+    mFilter = filter;
+    if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) {
+        mDstW = mDstH = 0;
+        return;
+    }
+    mAxisX.build(rotQ % 2 == 0 ? srcWidth : srcHeight, dstWidth, filter);
+    mAxisY.build(rotQ % 2 == 0 ? srcHeight : srcWidth, dstHeight, filter);
+}
+
+// MARK: - Rendering
+
+void FrameResampler::render(const uint8_t *src, size_t srcBytesPerRow, uint8_t *dst, size_t dstBytesPerRow,
+                            const DirtyRect &rect) const {
+    const int x0 = std::max(0, rect.x), y0 = std::max(0, rect.y);
+    const int x1 = std::min(mDstW, rect.x + rect.w), y1 = std::min(mDstH, rect.y + rect.h);
+    if (!src || !dst || x1 <= x0 || y1 <= y0)
+        return;
+
+    // Rotated-space pixel (rx, ry) lives at src + origin + rx * stepX + ry * stepY
+    const ptrdiff_t bpr = (ptrdiff_t)srcBytesPerRow, bpp = kBytesPerPixel;
+    ptrdiff_t origin, stepX, stepY;
+    switch (mRotQ) {
+    case 1: // rx = H - 1 - sy, ry = sx
+        origin = (ptrdiff_t)(mSrcH - 1) * bpr;
+        stepX = -bpr;
+        stepY = bpp;
+        break;
+    case 2: // rx = W - 1 - sx, ry = H - 1 - sy
+        origin = (ptrdiff_t)(mSrcH - 1) * bpr + (ptrdiff_t)(mSrcW - 1) * bpp;
+        stepX = -bpp;
+        stepY = -bpr;
+        break;
+    case 3: // rx = sy, ry = W - 1 - sx
+        origin = (ptrdiff_t)(mSrcW - 1) * bpp;
+        stepX = bpr;
+        stepY = -bpp;
+        break;
+    default:
+        origin = 0;
+        stepX = bpp;
+        stepY = bpr;
+        break;
+    }
+
+    // Inner taps run along the axis that is contiguous in the source, outer taps across source lines
+    const bool innerX = (mRotQ & 1) == 0;
+    const Axis &outer = innerX ? mAxisY : mAxisX;
+    const Axis &inner = innerX ? mAxisX : mAxisY;
+    const ptrdiff_t outerStep = innerX ? stepY : stepX;
+    const ptrdiff_t innerStep = innerX ? stepX : stepY;
+    const int o0 = innerX ? y0 : x0, o1 = innerX ? y1 : x1;
+    const int i0 = innerX ? x0 : y0, i1 = innerX ? x1 : y1;
+
+    // Separable per block: first each source line covered by the block is reduced along the inner axis (reading
+    // short contiguous runs), then the line sums are combined along the outer axis. Blocks keep the lines in cache.
+    thread_local std::vector<uint16_t> sums;
+    for (int ob = o0; ob < o1; ob += kBlockOuter) {
+        const int ob1 = std::min(o1, ob + kBlockOuter);
+        const int line0 = outer.first[(size_t)ob];
+        const int line1 = outer.first[(size_t)ob1 - 1] + outer.count[(size_t)ob1 - 1];
+        for (int ib = i0; ib < i1; ib += kBlockInner) {
+            const int ib1 = std::min(i1, ib + kBlockInner);
+            const size_t n = (size_t)(ib1 - ib);
+            sums.resize((size_t)(line1 - line0) * n * 4);
+
+            for (int line = line0; line < line1; ++line) {
+                const uint8_t *lp = src + origin + (ptrdiff_t)line * outerStep;
+                uint16_t *out = &sums[(size_t)(line - line0) * n * 4];
+                for (int ii = ib; ii < ib1; ++ii) {
+                    const uint8_t *p = lp + (ptrdiff_t)inner.first[(size_t)ii] * innerStep;
+                    const uint16_t *w = &inner.weights[(size_t)ii * (size_t)inner.maxTaps];
+                    PixelAcc acc = accZero();
+                    for (int t = 0, nt = inner.count[(size_t)ii]; t < nt; ++t)
+                        acc = accAddPixel(acc, p + (ptrdiff_t)t * innerStep, w[t]);
+                    accStoreLine(acc, out + (size_t)(ii - ib) * 4);
+                }
+            }
+
+            for (int oi = ob; oi < ob1; ++oi) {
+                const uint16_t *w = &outer.weights[(size_t)oi * (size_t)outer.maxTaps];
+                const uint16_t *first = &sums[(size_t)(outer.first[(size_t)oi] - line0) * n * 4];
+                const int nt = outer.count[(size_t)oi];
+                for (int ii = ib; ii < ib1; ++ii) {
+                    const uint16_t *sp = first + (size_t)(ii - ib) * 4;
+                    PixelAcc acc = accZero();
+                    for (int t = 0; t < nt; ++t)
+                        acc = accAddLine(acc, sp + (size_t)t * n * 4, w[t]);
+                    const uint32_t px = accPixel(acc);
+                    const int x = innerX ? ii : oi, y = innerX ? oi : ii;
+                    memcpy(dst + (size_t)y * dstBytesPerRow + (size_t)x * kBytesPerPixel, &px, sizeof(px));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef FrameResampler_h
+#define FrameResampler_h
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RectCoalescer.h"
+
+/** Resampling filter of FrameResampler. */
+enum class ResampleFilter : uint8_t {
+    Area,     // mean over the footprint of each output pixel (fractional coverage at the edges)
+    Box,      // mean over a block of round(ratio) pixels per axis: exact 2:1 / 4:1 box for integer ratios
+    Bilinear, // two taps per axis around the footprint center
+};
+
+/**
+ FrameResampler
+ ----------------
+ Fused rotate + downscale of 32-bit pixels: output pixels are resampled
+ straight from the portrait capture through the rotated sampling pattern, so
+ no full-resolution rotated copy is written and read back. With no rotation
+ it is a plain downscaler.
+
+ - Separable weights per axis are built once per geometry and filter; the
+   footprint of an output pixel is axis-aligned in the source for every
+   quarter turn.
+ - Separable per block of output pixels: each source line the block covers is
+   first reduced along its contiguous axis, then the line sums are combined
+   across lines. Odd quarter turns thus read short runs of adjacent pixels
+   rather than walking down source columns.
+ - An output pixel depends on its footprint only, so any output rect can be
+   rendered on its own (bands on the pool, partial damage renders) with the
+   same result as a full-frame render.
+ */
+class FrameResampler {
+  public:
+    FrameResampler() = default;
+
+    /** Geometry: portrait source, rotQ quarter turns clockwise (DamageMapper convention), output size. */
+    void configure(int srcWidth, int srcHeight, int rotQ, int dstWidth, int dstHeight,
+                   ResampleFilter filter = ResampleFilter::Area);
+
+    /** Render the output pixels of rect into dst (full output frame, dstBytesPerRow stride). */
+    void render(const uint8_t *src, size_t srcBytesPerRow, uint8_t *dst, size_t dstBytesPerRow,
+                const DirtyRect &rect) const;
+
+    /** Render output rows [y0, y1). */
+    void renderRows(const uint8_t *src, size_t srcBytesPerRow, uint8_t *dst, size_t dstBytesPerRow, int y0,
+                    int y1) const {
+        render(src, srcBytesPerRow, dst, dstBytesPerRow, DirtyRect{0, y0, mDstW, y1 - y0});
+    }
+
+    ResampleFilter filter() const { return mFilter; }
+    int maxTaps() const { return mAxisX.maxTaps * mAxisY.maxTaps; }
+
+  private:
+    struct Axis {
+        int maxTaps = 0;
+        std::vector<int> first;        // per output index: first rotated-space tap
+        std::vector<int> count;        // per output index: taps used
+        std::vector<uint16_t> weights; // per output index: maxTaps weights, summing to 1 << kWeightBits
+        void build(int srcLen, int dstLen, ResampleFilter filter);
+    };
+
+    int mSrcW = 0;
+    int mSrcH = 0;
+    int mRotQ = 0;
+    int mDstW = 0;
+    int mDstH = 0;
+    ResampleFilter mFilter = ResampleFilter::Area;
+    Axis mAxisX; // rotated-space columns
+    Axis mAxisY; // rotated-space rows
+};
+
+#endif /* FrameResampler_h */
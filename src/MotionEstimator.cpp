@@ -0,0 +1,255 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "MotionEstimator.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const int kRecentVectors = 4;   // recent translations tried first
+static const int kAnchorTiles = 3;     // tiles seeding axis searches
+static const int kMinDetailTiles = 2;  // moved tiles with detail needed to report a translation
+static const int kDeadlineStride = 32; // comparisons between deadline checks
+
+// MARK: - Configuration
+
+void MotionEstimator::configure(int width, int height, int tileSize, int bytesPerPixel) {
+    tileSize = std::max(1, tileSize);
+    if (width == mWidth && height == mHeight && tileSize == mTileSize && bytesPerPixel == mBytesPerPixel)
+        return;
+    mWidth = width;
+    mHeight = height;
+    mTileSize = tileSize;
+    mBytesPerPixel = bytesPerPixel;
+    mTilesX = (width + tileSize - 1) / tileSize;
+    mTilesY = (height + tileSize - 1) / tileSize;
+    mMatched.assign((size_t)mTilesX * (size_t)mTilesY, 0);
+    mScratch.assign(mMatched.size(), 0);
+    mRecent.clear();
+}
+
+void MotionEstimator::remember(int dx, int dy) {
+    if (dx == 0 && dy == 0)
+        return;
+    Vec v{dx, dy};
+    mRecent.erase(std::remove(mRecent.begin(), mRecent.end(), v), mRecent.end());
+    mRecent.insert(mRecent.begin(), v);
+    if ((int)mRecent.size() > kRecentVectors)
+        mRecent.resize((size_t)kRecentVectors);
+}
+
+// MARK: - Tiles
+
+DirtyRect MotionEstimator::tileRect(int tile) const {
+    int tx = tile % mTilesX, ty = tile / mTilesX;
+    int x = tx * mTileSize, y = ty * mTileSize;
+    return DirtyRect{x, y, std::min(mTileSize, mWidth - x), std::min(mTileSize, mHeight - y)};
+}
+
+bool MotionEstimator::tileHasDetail(const uint8_t *buf, size_t bytesPerRow, int tile) const {
+    // Two rows with more than one color: a flat tile matches almost any offset
+    const DirtyRect r = tileRect(tile);
+    const size_t bpp = (size_t)mBytesPerPixel;
+    for (int y : {r.y, r.y + r.h / 2}) {
+        const uint8_t *row = buf + (size_t)y * bytesPerRow + (size_t)r.x * bpp;
+        for (int x = 1; x < r.w; ++x) {
+            if (memcmp(row, row + (size_t)x * bpp, bpp) != 0)
+                return true;
+        }
+    }
+    return false;
+}
+
+bool MotionEstimator::probe(const uint8_t *cur, const uint8_t *prev, size_t bytesPerRow, const DirtyRect &r, Vec v) {
+    const int sx = r.x - v.dx, sy = r.y - v.dy;
+    if (sx < 0 || sy < 0 || sx + r.w > mWidth || sy + r.h > mHeight)
+        return false;
+    mProbes++;
+    const size_t bpp = (size_t)mBytesPerPixel;
+    const size_t len = (size_t)r.w * bpp;
+    for (int y : {0, r.h / 2}) {
+        if (memcmp(cur + (size_t)(r.y + y) * bytesPerRow + (size_t)r.x * bpp,
+                   prev + (size_t)(sy + y) * bytesPerRow + (size_t)sx * bpp, len) != 0)
+            return false;
+    }
+    return true;
+}
+
+bool MotionEstimator::matches(const uint8_t *cur, const uint8_t *prev, size_t bytesPerRow, const DirtyRect &r, Vec v) {
+    if (!probe(cur, prev, bytesPerRow, r, v))
+        return false;
+    const size_t bpp = (size_t)mBytesPerPixel;
+    const size_t len = (size_t)r.w * bpp;
+    for (int y = 0; y < r.h; ++y) {
+        if (memcmp(cur + (size_t)(r.y + y) * bytesPerRow + (size_t)r.x * bpp,
+                   prev + (size_t)(r.y - v.dy + y) * bytesPerRow + (size_t)(r.x - v.dx) * bpp, len) != 0)
+            return false;
+    }
+    return true;
+}
+
+// MARK: - Candidates
+
+void MotionEstimator::axisSearch(const uint8_t *cur, const uint8_t *prev, size_t bytesPerRow, int tile,
+                                 Deadline deadline, std::vector<Vec> &out) {
+    const DirtyRect r = tileRect(tile);
+    for (int axis = 0; axis < 2; ++axis) {
+        const int range = axis == 0 ? mHeight : mWidth;
+        int checks = 0;
+        // Nearest offsets first: short slides are the common case and hit early
+        for (int d = 1; d < range; ++d) {
+            if (++checks % kDeadlineStride == 0 && std::chrono::steady_clock::now() >= deadline)
+                return;
+            bool found = false;
+            for (int sign : {1, -1}) {
+                Vec v = axis == 0 ? Vec{0, sign * d} : Vec{sign * d, 0};
+                if (matches(cur, prev, bytesPerRow, r, v)) {
+                    if (std::find(out.begin(), out.end(), v) == out.end())
+                        out.push_back(v);
+                    found = true;
+                    break;
+                }
+            }
+            if (found)
+                break;
+        }
+    }
+}
+
+// MARK: - Search
+
+int MotionEstimator::score(const uint8_t *cur, const uint8_t *prev, size_t bytesPerRow, Vec v, Deadline deadline) {
+    int hits = 0;
+    for (size_t i = 0; i < mTiles.size(); ++i) {
+        if (!mDetail[i])
+            continue;
+        if (++mScored % kDeadlineStride == 0 && std::chrono::steady_clock::now() >= deadline)
+            break;
+        bool hit = matches(cur, prev, bytesPerRow, tileRect(mTiles[i]), v);
+        mScratch[(size_t)mTiles[i]] = hit ? 1 : 0;
+        hits += hit;
+    }
+    return hits;
+}
+
+int MotionEstimator::search(const uint8_t *cur, const uint8_t *prev, size_t bytesPerRow, const DirtyRect *rects,
+                            int rectCount, Deadline deadline, DirtyRect *moves, int maxMoves, int *outDx,
+                            int *outDy) {
+    mProbes = 0;
+    mScored = 0;
+    if (!cur || !prev || mTilesX <= 0 || rectCount <= 0 || maxMoves <= 0)
+        return 0;
+
+    // Dirty tiles covered by the rects (rects are tile-aligned, except at the frame edges)
+    mTiles.clear();
+    for (int i = 0; i < rectCount; ++i) {
+        const DirtyRect &r = rects[i];
+        int tx0 = std::max(0, r.x / mTileSize), ty0 = std::max(0, r.y / mTileSize);
+        int tx1 = std::min(mTilesX - 1, (r.x + r.w - 1) / mTileSize);
+        int ty1 = std::min(mTilesY - 1, (r.y + r.h - 1) / mTileSize);
+        for (int ty = ty0; ty <= ty1; ++ty) {
+            for (int tx = tx0; tx <= tx1; ++tx) {
+                int t = ty * mTilesX + tx;
+                if (!mMatched[(size_t)t]) {
+                    mMatched[(size_t)t] = 1; // dedup marker, cleared below
+                    mTiles.push_back(t);
+                }
+            }
+        }
+    }
+    for (int t : mTiles)
+        mMatched[(size_t)t] = 0;
+
+    mDetail.resize(mTiles.size());
+    int detailed = 0;
+    for (size_t i = 0; i < mTiles.size(); ++i) {
+        mDetail[i] = tileHasDetail(cur, bytesPerRow, mTiles[i]) ? 1 : 0;
+        detailed += mDetail[i];
+    }
+    if (detailed < kMinDetailTiles)
+        return 0;
+
+    // Score candidates by the tiles with detail they move exactly; stop once one moves most of them
+    Vec best{0, 0};
+    int bestScore = 0;
+    std::vector<Vec> tried;
+    auto consider = [&](Vec v) {
+        if (std::find(tried.begin(), tried.end(), v) != tried.end())
+            return;
+        tried.push_back(v);
+        int hits = score(cur, prev, bytesPerRow, v, deadline);
+        if (hits > bestScore) {
+            bestScore = hits;
+            best = v;
+            mMatched.swap(mScratch);
+        }
+        for (int t : mTiles)
+            mScratch[(size_t)t] = 0;
+    };
+    auto settled = [&] { return 2 * bestScore >= detailed || std::chrono::steady_clock::now() >= deadline; };
+
+    // Recent translations first, then axis searches from anchors spread over the tiles not moved yet
+    for (size_t i = 0; i < mRecent.size() && !settled(); ++i)
+        consider(mRecent[i]);
+    std::vector<Vec> found;
+    for (int a = 0; a < kAnchorTiles && !settled(); ++a) {
+        int seen = 0, pick = (2 * a + 1) * detailed / (2 * kAnchorTiles);
+        int anchor = -1;
+        for (size_t i = 0; i < mTiles.size() && anchor < 0; ++i) {
+            if (mDetail[i] && seen++ >= pick && !mMatched[(size_t)mTiles[i]])
+                anchor = mTiles[i];
+        }
+        if (anchor < 0)
+            continue;
+        found.clear();
+        axisSearch(cur, prev, bytesPerRow, anchor, deadline, found);
+        for (size_t i = 0; i < found.size() && std::chrono::steady_clock::now() < deadline; ++i)
+            consider(found[i]);
+    }
+    if (bestScore < kMinDetailTiles) {
+        for (int t : mTiles)
+            mMatched[(size_t)t] = 0;
+        return 0;
+    }
+
+    // Flat tiles only move along with the winner (they would match almost any candidate)
+    for (size_t i = 0; i < mTiles.size(); ++i) {
+        if (mDetail[i])
+            continue;
+        if (++mScored % kDeadlineStride == 0 && std::chrono::steady_clock::now() >= deadline)
+            break;
+        if (matches(cur, prev, bytesPerRow, tileRect(mTiles[i]), best))
+            mMatched[(size_t)mTiles[i]] = 1;
+    }
+
+    // Moved tiles as exact rects
+    std::vector<DirtyRect> out;
+    RectCoalescer::tileMaskRects(mMatched.data(), mTilesX, mTilesY, mTileSize, mWidth, mHeight, out);
+    for (int t : mTiles)
+        mMatched[(size_t)t] = 0;
+
+    // Largest first; moves that do not fit simply stay dirty
+    std::sort(out.begin(), out.end(),
+              [](const DirtyRect &a, const DirtyRect &b) { return (int64_t)a.w * a.h > (int64_t)b.w * b.h; });
+    int count = std::min(maxMoves, (int)out.size());
+    std::copy(out.begin(), out.begin() + count, moves);
+    if (outDx)
+        *outDx = best.dx;
+    if (outDy)
+        *outDy = best.dy;
+    return count;
+}
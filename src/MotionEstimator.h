@@ -0,0 +1,100 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MotionEstimator_h
+#define MotionEstimator_h
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RectCoalescer.h"
+
+/**
+ MotionEstimator
+ ----------------
+ Block motion search over dirty tiles, for UI elements that slide as a whole
+ (sheets, app switcher cards, the keyboard). Finds one translation (dx, dy)
+ such that dirty tiles of the current frame equal blocks of the previous
+ frame at (x - dx, y - dy), so they can be sent as CopyRect.
+
+ Only one offset is reported per update: CopyRect regions scheduled in
+ libvncserver share a single offset per client.
+
+ Candidates, cheapest first:
+ - Motion vectors of recent updates (animations keep moving the same way).
+ - Axis searches from a few anchor tiles (tiles with detail, spread over the
+   dirty tiles not moved yet): offsets along x and y, nearest first, screened
+   by probing two rows of the tile. Diagonal slides are only found through
+   recent vectors.
+ Each candidate is scored by the tiles with detail it moves exactly; the
+ search ends once one moves at least half of them. Flat tiles would match
+ almost any offset, so they are only checked against the winner. Every match
+ is verified byte for byte.
+
+ The search stops at a deadline; the best candidate so far is used.
+ */
+class MotionEstimator {
+  public:
+    typedef std::chrono::steady_clock::time_point Deadline;
+
+    MotionEstimator() = default;
+
+    /** Tile grid of the frames to search (must match the dirty rects). Forgets recent vectors on change. */
+    void configure(int width, int height, int tileSize, int bytesPerPixel);
+
+    /** Search the tiles covered by rects. Returns the number of move rects written (destination, tile-aligned). */
+    int search(const uint8_t *cur, const uint8_t *prev, size_t bytesPerRow, const DirtyRect *rects, int rectCount,
+               Deadline deadline, DirtyRect *moves, int maxMoves, int *outDx, int *outDy);
+
+    /** Record a translation that was sent (also from scroll detection), tried first next time. */
+    void remember(int dx, int dy);
+
+    /** Tile comparisons made by the last search (for logging). */
+    uint64_t lastProbes() const { return mProbes; }
+
+  private:
+    struct Vec {
+        int dx, dy;
+        bool operator==(const Vec &o) const { return dx == o.dx && dy == o.dy; }
+    };
+
+    DirtyRect tileRect(int tile) const;
+    bool tileHasDetail(const uint8_t *buf, size_t bytesPerRow, int tile) const;
+    bool probe(const uint8_t *cur, const uint8_t *prev, size_t bytesPerRow, const DirtyRect &r, Vec v);
+    bool matches(const uint8_t *cur, const uint8_t *prev, size_t bytesPerRow, const DirtyRect &r, Vec v);
+    void axisSearch(const uint8_t *cur, const uint8_t *prev, size_t bytesPerRow, int tile, Deadline deadline,
+                    std::vector<Vec> &out);
+    int score(const uint8_t *cur, const uint8_t *prev, size_t bytesPerRow, Vec v, Deadline deadline);
+
+    int mWidth = 0;
+    int mHeight = 0;
+    int mTileSize = 32;
+    int mBytesPerPixel = 4;
+    int mTilesX = 0;
+    int mTilesY = 0;
+    uint64_t mProbes = 0;
+    uint64_t mScored = 0; // tiles scored, for deadline checks
+    std::vector<Vec> mRecent;      // most recent first
+    std::vector<int> mTiles;       // dirty tiles of the current search
+    std::vector<uint8_t> mDetail;  // per dirty tile: has detail (counts towards the score)
+    std::vector<uint8_t> mMatched; // per tile: moved by the best candidate
+    std::vector<uint8_t> mScratch; // per tile: moved by the candidate being scored
+};
+
+#endif /* MotionEstimator_h */
@@ -0,0 +1,333 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "RectCoalescer.h"
+
+#include <algorithm>
+#include <numeric>
+#include <queue>
+
+static inline DirtyRect unionRect(const DirtyRect &a, const DirtyRect &b) {
+    int x0 = std::min(a.x, b.x);
+    int y0 = std::min(a.y, b.y);
+    int x1 = std::max(a.x + a.w, b.x + b.w);
+    int y1 = std::max(a.y + a.h, b.y + b.h);
+    return DirtyRect{x0, y0, x1 - x0, y1 - y0};
+}
+
+// MARK: - Cost Model
+
+void RectCoalescer::setCostModel(double headerBytes, double pixelBytes) {
+    mHeaderBytes = headerBytes < 0.0 ? 0.0 : headerBytes;
+    mPixelBytes = pixelBytes <= 0.0 ? 1.0 : pixelBytes;
+}
+
+double RectCoalescer::cost(const DirtyRect *rects, int count) const {
+    double total = 0.0;
+    for (int i = 0; i < count; ++i)
+        total += rectCost(rects[i]);
+    return total;
+}
+
+// MARK: - Sweep
+
+void RectCoalescer::begin() {
+    mRowY = -1;
+    mRow.clear();
+    mOpen.clear();
+    mClosed.clear();
+}
+
+void RectCoalescer::addRun(int x, int y, int w, int h) {
+    if (w <= 0 || h <= 0)
+        return;
+    if (y != mRowY) {
+        endRow();
+        mRowY = y;
+    }
+    DirtyRect run{x, y, w, h};
+    if (!mRow.empty()) {
+        DirtyRect &last = mRow.back();
+        DirtyRect joined = unionRect(last, run);
+        if (rectCost(joined) <= rectCost(last) + rectCost(run)) {
+            last = joined; // gap is cheaper than another header
+            return;
+        }
+    }
+    mRow.push_back(run);
+}
+
+// Match the finished row's runs against the open rects (both sorted by x).
+void RectCoalescer::endRow() {
+    if (mRow.empty())
+        return;
+    mNext.clear();
+    mExtended.assign(mOpen.size(), 0);
+    size_t first = 0;
+    for (const DirtyRect &run : mRow) {
+        while (first < mOpen.size() && mOpen[first].x + mOpen[first].w <= run.x)
+            first++;
+        bool merged = false;
+        for (size_t k = first; k < mOpen.size() && mOpen[k].x < run.x + run.w; ++k) {
+            DirtyRect grown = unionRect(mOpen[k], run);
+            if (rectCost(grown) <= rectCost(mOpen[k]) + rectCost(run)) {
+                mOpen[k] = grown;
+                mExtended[k] = 1;
+                merged = true;
+                break;
+            }
+        }
+        if (!merged)
+            mNext.push_back(run);
+    }
+    for (size_t k = 0; k < mOpen.size(); ++k) {
+        if (mExtended[k])
+            mNext.push_back(mOpen[k]);
+        else
+            mClosed.push_back(mOpen[k]);
+    }
+    std::sort(mNext.begin(), mNext.end(), [](const DirtyRect &a, const DirtyRect &b) { return a.x < b.x; });
+    mOpen.swap(mNext);
+    mRow.clear();
+}
+
+int RectCoalescer::finish(DirtyRect *rects, int maxRects) {
+    endRow();
+    mClosed.insert(mClosed.end(), mOpen.begin(), mOpen.end());
+    mOpen.clear();
+    if (maxRects <= 0 || mClosed.empty())
+        return 0;
+    int count = reduce(mClosed.data(), (int)mClosed.size(), maxRects);
+    std::copy(mClosed.begin(), mClosed.begin() + count, rects);
+    return count;
+}
+
+// MARK: - Reduce
+
+int RectCoalescer::reduce(DirtyRect *rects, int count, int maxRects) {
+    if (count <= 1)
+        return count;
+    if (maxRects < 1)
+        maxRects = 1;
+
+    const int n = count;
+    std::vector<int> order(n);
+    std::vector<int> prevY(n, -1), nextY(n, -1), prevX(n, -1), nextX(n, -1);
+    auto link = [&](std::vector<int> &prev, std::vector<int> &next) {
+        for (int k = 1; k < n; ++k) {
+            prev[order[k]] = order[k - 1];
+            next[order[k - 1]] = order[k];
+        }
+    };
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [rects](int a, int b) {
+        return rects[a].y != rects[b].y ? rects[a].y < rects[b].y : rects[a].x < rects[b].x;
+    });
+    link(prevY, nextY);
+    std::sort(order.begin(), order.end(), [rects](int a, int b) {
+        return rects[a].x != rects[b].x ? rects[a].x < rects[b].x : rects[a].y < rects[b].y;
+    });
+    link(prevX, nextX);
+
+    struct Candidate {
+        double delta; // cost(union) - cost(a) - cost(b)
+        int a, b;
+        uint32_t versionA, versionB;
+    };
+    auto cheaper = [](const Candidate &l, const Candidate &r) { return l.delta > r.delta; };
+    std::priority_queue<Candidate, std::vector<Candidate>, decltype(cheaper)> heap(cheaper);
+    std::vector<uint32_t> version(n, 0);
+    std::vector<uint8_t> alive(n, 1);
+    auto push = [&](int a, int b) {
+        if (a < 0 || b < 0)
+            return;
+        double delta = rectCost(unionRect(rects[a], rects[b])) - rectCost(rects[a]) - rectCost(rects[b]);
+        heap.push(Candidate{delta, a, b, version[a], version[b]});
+    };
+    for (int i = 0; i < n; ++i) {
+        push(i, nextY[i]);
+        push(i, nextX[i]);
+    }
+
+    auto unlink = [](std::vector<int> &prev, std::vector<int> &next, int k) {
+        if (prev[k] >= 0)
+            next[prev[k]] = next[k];
+        if (next[k] >= 0)
+            prev[next[k]] = prev[k];
+    };
+
+    int aliveCount = n;
+    while (!heap.empty() && aliveCount > 1) {
+        Candidate c = heap.top();
+        heap.pop();
+        if (!alive[c.a] || !alive[c.b] || version[c.a] != c.versionA || version[c.b] != c.versionB)
+            continue; // stale
+        if (c.delta >= 0.0 && aliveCount <= maxRects)
+            break; // nothing cheaper left and within the limit
+
+        rects[c.a] = unionRect(rects[c.a], rects[c.b]);
+        version[c.a]++;
+        alive[c.b] = 0;
+        aliveCount--;
+        unlink(prevY, nextY, c.b);
+        unlink(prevX, nextX, c.b);
+        push(prevY[c.b], nextY[c.b]);
+        push(prevX[c.b], nextX[c.b]);
+        push(prevY[c.a], c.a);
+        push(c.a, nextY[c.a]);
+        push(prevX[c.a], c.a);
+        push(c.a, nextX[c.a]);
+    }
+
+    int k = 0;
+    for (int i = 0; i < n; ++i) {
+        if (alive[i])
+            rects[k++] = rects[i];
+    }
+    // Rects grown by the sweep or by merges may reach over rects they were never paired with
+    return resolveOverlaps(rects, k, std::min(maxRects, n));
+}
+
+// MARK: - Overlaps
+
+static inline bool overlaps(const DirtyRect &a, const DirtyRect &b) {
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+static inline bool contains(const DirtyRect &a, const DirtyRect &b) {
+    return a.x <= b.x && a.y <= b.y && a.x + a.w >= b.x + b.w && a.y + a.h >= b.y + b.h;
+}
+
+// b minus the part it shares with a: bands above and below the overlap, then the pieces left and right of it.
+static int subtractRect(const DirtyRect &b, const DirtyRect &a, DirtyRect out[4]) {
+    int ix0 = std::max(a.x, b.x), iy0 = std::max(a.y, b.y);
+    int ix1 = std::min(a.x + a.w, b.x + b.w), iy1 = std::min(a.y + a.h, b.y + b.h);
+    int n = 0;
+    if (iy0 > b.y)
+        out[n++] = DirtyRect{b.x, b.y, b.w, iy0 - b.y};
+    if (b.y + b.h > iy1)
+        out[n++] = DirtyRect{b.x, iy1, b.w, b.y + b.h - iy1};
+    if (ix0 > b.x)
+        out[n++] = DirtyRect{b.x, iy0, ix0 - b.x, iy1 - iy0};
+    if (b.x + b.w > ix1)
+        out[n++] = DirtyRect{ix1, iy0, b.x + b.w - ix1, iy1 - iy0};
+    return n;
+}
+
+// Each overlapping pair becomes whichever is cheapest: their union, or one of them minus the other. Splits need
+// room under capacity. Passes repeat until no pair overlaps; after a few passes only unions are made, which lower
+// the count every time, so this always ends.
+int RectCoalescer::resolveOverlaps(DirtyRect *rects, int count, int capacity) {
+    static const int kSplitPasses = 8;
+    std::vector<DirtyRect> work(rects, rects + count);
+    std::vector<int> order;
+    int alive = count;
+    for (int pass = 0;; ++pass) {
+        order.resize(work.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return work[a].x < work[b].x; });
+        bool found = false;
+        for (size_t oi = 0; oi < order.size(); ++oi) {
+            const int i = order[oi];
+            for (size_t oj = oi + 1; oj < order.size() && work[i].w > 0; ++oj) {
+                const int j = order[oj];
+                if (work[j].x >= work[i].x + work[i].w)
+                    break; // sorted by x: nothing further right can reach back
+                if (work[j].w <= 0 || !overlaps(work[i], work[j]))
+                    continue;
+                found = true;
+                DirtyRect &a = work[i], &b = work[j];
+                if (contains(a, b) || contains(b, a)) {
+                    if (contains(b, a))
+                        a = b;
+                    b.w = b.h = 0;
+                    alive--;
+                    continue;
+                }
+                DirtyRect piecesB[4], piecesA[4];
+                const int nb = subtractRect(b, a, piecesB);
+                const int na = subtractRect(a, b, piecesA);
+                const DirtyRect u = unionRect(a, b);
+                const double unionCost = rectCost(u);
+                double splitB = rectCost(a), splitA = rectCost(b);
+                for (int k = 0; k < nb; ++k)
+                    splitB += rectCost(piecesB[k]);
+                for (int k = 0; k < na; ++k)
+                    splitA += rectCost(piecesA[k]);
+                const bool canSplitB = pass < kSplitPasses && alive - 1 + nb <= capacity;
+                const bool canSplitA = pass < kSplitPasses && alive - 1 + na <= capacity;
+                if ((!canSplitB || unionCost <= splitB) && (!canSplitA || unionCost <= splitA)) {
+                    a = u;
+                    b.w = b.h = 0;
+                    alive--;
+                    continue;
+                }
+                // Split the one whose remainder is cheaper; pieces are checked again on the next pass
+                const bool useB = canSplitB && (!canSplitA || splitB <= splitA);
+                const DirtyRect *pieces = useB ? piecesB : piecesA;
+                const int np = useB ? nb : na;
+                DirtyRect &victim = useB ? b : a;
+                victim.w = victim.h = 0;
+                for (int k = 0; k < np; ++k)
+                    work.push_back(pieces[k]); // may reallocate: a and b are not used past this point
+                alive += np - 1;
+                break;
+            }
+        }
+        if (!found)
+            break;
+        work.erase(std::remove_if(work.begin(), work.end(), [](const DirtyRect &r) { return r.w <= 0; }),
+                   work.end());
+    }
+    std::copy(work.begin(), work.end(), rects);
+    return (int)work.size();
+}
+
+// MARK: - Tile Masks
+
+void RectCoalescer::tileMaskRects(const uint8_t *mask, int tilesX, int tilesY, int tileSize, int width, int height,
+                                  std::vector<DirtyRect> &out) {
+    out.clear();
+    std::vector<size_t> open, nextOpen;
+    for (int ty = 0; ty < tilesY; ++ty) {
+        nextOpen.clear();
+        const uint8_t *row = mask + (size_t)ty * (size_t)tilesX;
+        for (int tx = 0; tx < tilesX;) {
+            if (!row[tx]) {
+                ++tx;
+                continue;
+            }
+            int end = tx;
+            while (end < tilesX && row[end])
+                ++end;
+            int y = ty * tileSize;
+            DirtyRect run = {tx * tileSize, y, std::min(end * tileSize, width) - tx * tileSize,
+                             std::min(tileSize, height - y)};
+            auto it = std::find_if(open.begin(), open.end(),
+                                   [&](size_t o) { return out[o].x == run.x && out[o].w == run.w; });
+            if (it != open.end()) {
+                out[*it].h += run.h;
+                nextOpen.push_back(*it);
+            } else {
+                nextOpen.push_back(out.size());
+                out.push_back(run);
+            }
+            tx = end;
+        }
+        open.swap(nextOpen);
+    }
+}
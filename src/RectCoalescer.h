@@ -0,0 +1,95 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef RectCoalescer_h
+#define RectCoalescer_h
+
+#include <cstdint>
+#include <vector>
+
+typedef struct {
+    int x, y, w, h;
+} DirtyRect;
+
+/**
+ RectCoalescer
+ ----------------
+ Merges dirty rectangles to minimize the estimated wire cost of an update:
+ every rect costs a fixed header (RFB rect header plus encoder framing) and
+ every covered pixel costs its estimated encoded size. Two rects are merged
+ into their bounding box when that is cheaper than sending both.
+
+ - Sweep (begin/addRun/finish): horizontal runs arrive row by row, top-down.
+   Runs in a row are joined across cheap gaps; each run then extends an open
+   rect of the rows above when that lowers the cost, else opens a new one.
+   Open rects that are not extended are closed. O(n log n) in the run count.
+ - Reduce: greedy pairwise merging of arbitrary rects, cheapest first, between
+   neighbours in y-major and x-major order (min-heap with lazy invalidation).
+   Merges while it lowers the cost, and keeps merging the cheapest pairs while
+   there are more than maxRects rects. O(n log n). The result always covers
+   the input.
+ - Overlaps: merged rects can reach over rects they were never paired with.
+   A final pass turns every overlapping pair into their union or splits one
+   of them around the other, whichever is cheaper, so no pixel is sent twice.
+ */
+class RectCoalescer {
+  public:
+    RectCoalescer() = default;
+
+    /** Cost model: bytes per rect, and estimated encoded bytes per pixel. */
+    void setCostModel(double headerBytes, double pixelBytes);
+    double headerBytes() const { return mHeaderBytes; }
+    double pixelBytes() const { return mPixelBytes; }
+
+    /** Estimated wire cost of a rect list. */
+    double cost(const DirtyRect *rects, int count) const;
+
+    /** Start a sweep. */
+    void begin();
+
+    /** Add a horizontal run. Runs of one row share y and h and arrive sorted by x; rows arrive top-down. */
+    void addRun(int x, int y, int w, int h);
+
+    /** Finish the sweep: writes at most maxRects rects (reduced if needed). Returns the count. */
+    int finish(DirtyRect *rects, int maxRects);
+
+    /** Merge rects in place while it lowers the cost or the count exceeds maxRects, then remove overlaps.
+        Returns the new count, which never exceeds the input count. */
+    int reduce(DirtyRect *rects, int count, int maxRects);
+
+    /** Exact cover of the marked tiles of a tile grid (one byte per tile, row-major), never merging across
+        unmarked tiles: runs per tile row, extended downwards while the next row has the same run. */
+    static void tileMaskRects(const uint8_t *mask, int tilesX, int tilesY, int tileSize, int width, int height,
+                              std::vector<DirtyRect> &out);
+
+  private:
+    double rectCost(const DirtyRect &r) const { return mHeaderBytes + mPixelBytes * (double)r.w * (double)r.h; }
+    void endRow();
+    int resolveOverlaps(DirtyRect *rects, int count, int capacity);
+
+    double mHeaderBytes = 64.0;
+    double mPixelBytes = 1.0;
+
+    int mRowY = -1;
+    std::vector<DirtyRect> mRow;    // runs of the current row (joined across cheap gaps)
+    std::vector<DirtyRect> mOpen;   // rects still growing downwards, sorted by x
+    std::vector<DirtyRect> mNext;   // scratch: open rects for the next row
+    std::vector<uint8_t> mExtended; // scratch: open rect got a run in this row
+    std::vector<DirtyRect> mClosed; // finished rects
+};
+
+#endif /* RectCoalescer_h */
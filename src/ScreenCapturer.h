@@ -96,9 +96,17 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)setInstantFpsSmoothingFactor:(double)alpha;
 
+/**
+ Capture into a ring of count screen-sized IOSurfaces instead of a single one (default 1; must be called on the main
+ thread). Each frame goes to the next surface that is not in use (IOSurfaceIsInUse), so a consumer may keep reading
+ a frame after the handler returns: retain its pixel buffer and call IOSurfaceIncrementUseCount on its surface, then
+ IOSurfaceDecrementUseCount when done. When every surface is in use, frames are skipped until one is released.
+ */
+- (void)setSurfaceRingCount:(NSUInteger)count;
+
 /**
  Force the next frame to be treated as dirty, causing it to be captured and sent
- to the frame handler even if no screen changes are detected.
+ to the frame handler even if no screen changes are detected. May be called from any thread.
  */
 - (void)forceNextFrameUpdate;
 
@@ -23,6 +23,7 @@
 #import <UIKit/UIGeometry.h>
 #import <UIKit/UIImage.h>
 #import <UIKit/UIScreen.h>
+#import <atomic>
 #import <mach/mach.h>
 
 #import "FBSOrientationObserver.h"
@@ -45,7 +46,9 @@ void CARenderServerRenderDisplay(kern_return_t a, CFStringRef b, IOSurfaceRef su
 
 @implementation ScreenCapturer {
     NSDictionary *mRenderProperties;
-    IOSurfaceRef mScreenSurface;
+    IOSurfaceRef mScreenSurface; // surface the next frame is captured into
+    NSArray *mSurfaceRing;       // IOSurfaceRef ring (setSurfaceRingCount:); nil: mScreenSurface only
+    NSUInteger mSurfaceRingIndex;
     CADisplayLink *mDisplayLink;
     void (^mFrameHandler)(CMSampleBufferRef sampleBuffer);
     NSInteger mMinFps;
@@ -115,6 +118,8 @@ void CARenderServerRenderDisplay(kern_return_t a, CFStringRef b, IOSurfaceRef su
 #endif
 
     mScreenSurface = IOSurfaceCreate((__bridge CFDictionaryRef)mRenderProperties);
+    mSurfaceRing = nil;
+    mSurfaceRingIndex = 0;
     mDisplayLink = nil;
     mFrameHandler = NULL;
     mMinFps = 0;
@@ -147,7 +152,7 @@ void CARenderServerRenderDisplay(kern_return_t a, CFStringRef b, IOSurfaceRef su
 
 #pragma mark - Rendering
 
-static CFIndex sDirtyFrameCount = 0;
+static std::atomic<CFIndex> sDirtyFrameCount(0); // forceNextFrameUpdate resets it from client threads
 
 - (BOOL)renderDisplayToScreenSurface:(IOSurfaceRef)dstSurface {
 #if TARGET_OS_SIMULATOR
@@ -170,7 +175,7 @@ static CFIndex sDirtyFrameCount = 0;
     });
 
     CFIndex dirtyFrameCount = CARenderServerGetDirtyFrameCount(NULL);
-    if (dirtyFrameCount == sDirtyFrameCount) {
+    if (dirtyFrameCount == sDirtyFrameCount.load(std::memory_order_relaxed)) {
         return NO; // No change
     }
 
@@ -178,7 +183,7 @@ static CFIndex sDirtyFrameCount = 0;
     CARenderServerRenderDisplay(0 /* Main Display */, CFSTR("LCD"), srcSurface, 0, 0);
     IOSurfaceAcceleratorTransferSurface(accelerator, srcSurface, dstSurface, NULL, NULL, NULL, NULL);
 
-    sDirtyFrameCount = dirtyFrameCount;
+    sDirtyFrameCount.store(dirtyFrameCount, std::memory_order_relaxed);
     return YES;
 #endif
 }
@@ -359,16 +364,63 @@ static CFIndex sDirtyFrameCount = 0;
     mInstFpsAlpha = alpha;
 }
 
+- (void)setSurfaceRingCount:(NSUInteger)count {
+    if (count <= 1) {
+        mSurfaceRing = nil;
+        return;
+    }
+
+    NSMutableArray *ring = [NSMutableArray arrayWithCapacity:count];
+    [ring addObject:(__bridge id)mScreenSurface];
+    while (ring.count < count) {
+        IOSurfaceRef surface = IOSurfaceCreate((__bridge CFDictionaryRef)mRenderProperties);
+        if (!surface)
+            break;
+        [ring addObject:(__bridge_transfer id)surface];
+    }
+
+    mSurfaceRing = [ring copy];
+    mSurfaceRingIndex = 0;
+
+#if DEBUG
+    TVLog(@"capture surface ring of %lu", (unsigned long)mSurfaceRing.count);
+#endif
+}
+
 - (void)forceNextFrameUpdate {
-    sDirtyFrameCount = 0; // Force next frame to be treated as dirty
+    sDirtyFrameCount.store(0, std::memory_order_relaxed); // Force next frame to be treated as dirty
 }
 
 #pragma mark - Private Methods
 
+// Next surface of the ring nobody is reading, or NULL when all of them are in use.
+- (IOSurfaceRef)nextFreeSurface {
+    if (!mSurfaceRing)
+        return mScreenSurface;
+
+    NSUInteger count = mSurfaceRing.count;
+    for (NSUInteger i = 1; i <= count; i++) {
+        NSUInteger index = (mSurfaceRingIndex + i) % count;
+        IOSurfaceRef surface = (__bridge IOSurfaceRef)mSurfaceRing[index];
+        if (!IOSurfaceIsInUse(surface)) {
+            mSurfaceRingIndex = index;
+            return surface;
+        }
+    }
+
+    return NULL;
+}
+
 - (void)onDisplayLink:(CADisplayLink *)link {
     if (!mFrameHandler)
         return;
 
+    // Every surface still being read: leave the change for a later tick
+    IOSurfaceRef surface = [self nextFreeSurface];
+    if (!surface)
+        return;
+    mScreenSurface = surface;
+
     // Update the screen contents into our IOSurface
     BOOL displayChanged = [self updateDisplay:link];
     if (!displayChanged) {
@@ -0,0 +1,182 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ScrollDetector.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "TileHash.h"
+
+static const uint64_t kColumnBasis = 0xCBF29CE484222325ULL;
+
+// MARK: - Configuration
+
+void ScrollDetector::configure(int minLines, int minVotes) {
+    mMinLines = std::max(1, minLines);
+    mMinVotes = std::max(1, minVotes);
+}
+
+// MARK: - Line Hashes
+
+void ScrollDetector::hashLines(const uint8_t *buf, size_t bytesPerRow, int bytesPerPixel, const DirtyRect &region,
+                               bool horizontal, std::vector<uint64_t> &out) {
+    const size_t bpp = (size_t)bytesPerPixel;
+    const uint8_t *origin = buf + (size_t)region.y * bytesPerRow + (size_t)region.x * bpp;
+    if (!horizontal) {
+        // Rows: one streaming pass per row with the fastest hash kernel
+        const TileHashOps &ops = TileHashResolve(TileHashKernel::Auto);
+        out.resize((size_t)region.h);
+        for (int y = 0; y < region.h; ++y)
+            out[(size_t)y] = ops.update(ops.basis, origin + (size_t)y * bytesPerRow, (size_t)region.w * bpp);
+        return;
+    }
+
+    // Columns: fold each row into every column's hash (independent lanes, row-major reads)
+    out.assign((size_t)region.w, kColumnBasis);
+    uint64_t *cols = out.data();
+    for (int y = 0; y < region.h; ++y) {
+        const uint8_t *row = origin + (size_t)y * bytesPerRow;
+        for (int x = 0; x < region.w; ++x) {
+            uint32_t v = 0;
+            memcpy(&v, row + (size_t)x * bpp, std::min(bpp, sizeof(v)));
+            cols[x] = (cols[x] ^ v) * 0x9E3779B97F4A7C15ULL;
+        }
+    }
+}
+
+// MARK: - Detection
+
+int ScrollDetector::detect(const uint8_t *cur, const uint8_t *prev, size_t bytesPerRow, int bytesPerPixel,
+                           const DirtyRect &region, bool horizontal, DirtyRect *moves, int maxMoves, int *outDx,
+                           int *outDy) {
+    const int lines = horizontal ? region.w : region.h;
+    const int span = horizontal ? region.h : region.w;
+    if (lines < 2 * mMinLines || span <= 0 || maxMoves <= 0)
+        return 0;
+
+    hashLines(cur, bytesPerRow, bytesPerPixel, region, horizontal, mCurLines);
+    hashLines(prev, bytesPerRow, bytesPerPixel, region, horizontal, mPrevLines);
+
+    mSorted.resize((size_t)lines);
+    for (int i = 0; i < lines; ++i)
+        mSorted[(size_t)i] = {mPrevLines[(size_t)i], i};
+    std::sort(mSorted.begin(), mSorted.end());
+
+    // Changed lines vote for the offset to their unique match in the previous frame
+    mVotes.assign((size_t)(2 * lines + 1), 0);
+    for (int i = 0; i < lines; ++i) {
+        uint64_t h = mCurLines[(size_t)i];
+        if (h == mPrevLines[(size_t)i])
+            continue;
+        auto range = std::equal_range(mSorted.begin(), mSorted.end(), std::make_pair(h, 0),
+                                      [](const auto &a, const auto &b) { return a.first < b.first; });
+        if (range.second - range.first != 1)
+            continue; // absent or ambiguous (blank/repeated line)
+        mVotes[(size_t)(i - range.first->second + lines)]++;
+    }
+    auto best = std::max_element(mVotes.begin(), mVotes.end());
+    if (*best < mMinVotes)
+        return 0;
+    const int shift = (int)(best - mVotes.begin()) - lines;
+
+    // Runs of consecutive lines matching at that offset, with at least one line that actually changed
+    struct Run {
+        int begin, end;
+    };
+    std::vector<Run> runs;
+    int runStart = -1;
+    bool runChanged = false;
+    const int first = std::max(0, shift);
+    const int last = std::min(lines, lines + shift);
+    for (int i = first; i <= last; ++i) {
+        bool match = i < last && mCurLines[(size_t)i] == mPrevLines[(size_t)(i - shift)];
+        if (match) {
+            if (runStart < 0) {
+                runStart = i;
+                runChanged = false;
+            }
+            runChanged = runChanged || mCurLines[(size_t)i] != mPrevLines[(size_t)i];
+            continue;
+        }
+        if (runStart >= 0 && i - runStart >= mMinLines && runChanged)
+            runs.push_back(Run{runStart, i});
+        runStart = -1;
+    }
+    std::sort(runs.begin(), runs.end(), [](const Run &a, const Run &b) { return a.end - a.begin > b.end - b.begin; });
+
+    const int dx = horizontal ? shift : 0;
+    const int dy = horizontal ? 0 : shift;
+    const size_t bpp = (size_t)bytesPerPixel;
+    int count = 0;
+    for (const Run &run : runs) {
+        if (count >= maxMoves)
+            break;
+        DirtyRect dst = horizontal ? DirtyRect{region.x + run.begin, region.y, run.end - run.begin, region.h}
+                                   : DirtyRect{region.x, region.y + run.begin, region.w, run.end - run.begin};
+        // Hashes only nominate; the copy must be exact
+        bool same = true;
+        for (int y = dst.y; y < dst.y + dst.h && same; ++y) {
+            same = memcmp(cur + (size_t)y * bytesPerRow + (size_t)dst.x * bpp,
+                          prev + (size_t)(y - dy) * bytesPerRow + (size_t)(dst.x - dx) * bpp,
+                          (size_t)dst.w * bpp) == 0;
+        }
+        if (same)
+            moves[count++] = dst;
+    }
+    if (count > 0) {
+        if (outDx)
+            *outDx = dx;
+        if (outDy)
+            *outDy = dy;
+    }
+    return count;
+}
+
+// MARK: - Rect Subtraction
+
+int ScrollDetector::subtractRects(const DirtyRect *rects, int count, const DirtyRect *cuts, int cutCount,
+                                  DirtyRect *out, int maxOut) {
+    std::vector<DirtyRect> pieces(rects, rects + count);
+    std::vector<DirtyRect> next;
+    for (int c = 0; c < cutCount; ++c) {
+        const DirtyRect &k = cuts[c];
+        next.clear();
+        for (const DirtyRect &r : pieces) {
+            int ix0 = std::max(r.x, k.x), iy0 = std::max(r.y, k.y);
+            int ix1 = std::min(r.x + r.w, k.x + k.w), iy1 = std::min(r.y + r.h, k.y + k.h);
+            if (ix0 >= ix1 || iy0 >= iy1) {
+                next.push_back(r);
+                continue;
+            }
+            // Full-width strips above and below the cut, then the left/right remainders beside it
+            if (iy0 > r.y)
+                next.push_back(DirtyRect{r.x, r.y, r.w, iy0 - r.y});
+            if (r.y + r.h > iy1)
+                next.push_back(DirtyRect{r.x, iy1, r.w, r.y + r.h - iy1});
+            if (ix0 > r.x)
+                next.push_back(DirtyRect{r.x, iy0, ix0 - r.x, iy1 - iy0});
+            if (r.x + r.w > ix1)
+                next.push_back(DirtyRect{ix1, iy0, r.x + r.w - ix1, iy1 - iy0});
+        }
+        pieces.swap(next);
+    }
+    if ((int)pieces.size() > maxOut)
+        return -1;
+    std::copy(pieces.begin(), pieces.end(), out);
+    return (int)pieces.size();
+}
@@ -0,0 +1,74 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ScrollDetector_h
+#define ScrollDetector_h
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "RectCoalescer.h"
+
+/**
+ ScrollDetector
+ ----------------
+ Finds content that moved along one axis between the previously published
+ frame and the current one, so it can be sent as CopyRect instead of being
+ re-encoded.
+
+ Within a region (e.g. the bounding box of the dirty rects), every line (row
+ for vertical scrolling, column for horizontal) of both frames is hashed:
+ - Changed lines vote for the offset to the previous line with the same hash.
+   Only hashes that are unique in the previous frame vote, so blank or
+   repeated lines cannot pick an offset.
+ - For the winning offset, runs of consecutive matching lines become moves.
+   Each run is verified byte for byte before it is reported.
+
+ All moves of one detection share the offset (dx, dy): the destination rect
+ in the current frame was at (x - dx, y - dy) in the previous frame.
+ Both frames must have the same geometry and stride.
+ */
+class ScrollDetector {
+  public:
+    ScrollDetector() = default;
+
+    /** Minimum run length in lines, and minimum votes for an offset. */
+    void configure(int minLines, int minVotes);
+
+    /** Detect moves inside region. Returns the number of destination rects written (up to maxMoves). */
+    int detect(const uint8_t *cur, const uint8_t *prev, size_t bytesPerRow, int bytesPerPixel, const DirtyRect &region,
+               bool horizontal, DirtyRect *moves, int maxMoves, int *outDx, int *outDy);
+
+    /** rects minus the union of cuts, as disjoint pieces. Returns the count, or -1 if more than maxOut. */
+    static int subtractRects(const DirtyRect *rects, int count, const DirtyRect *cuts, int cutCount, DirtyRect *out,
+                             int maxOut);
+
+  private:
+    void hashLines(const uint8_t *buf, size_t bytesPerRow, int bytesPerPixel, const DirtyRect &region,
+                   bool horizontal, std::vector<uint64_t> &out);
+
+    int mMinLines = 16;
+    int mMinVotes = 8;
+    std::vector<uint64_t> mCurLines;
+    std::vector<uint64_t> mPrevLines;
+    std::vector<std::pair<uint64_t, int>> mSorted; // previous line hashes, sorted for lookup
+    std::vector<int> mVotes;
+};
+
+#endif /* ScrollDetector_h */
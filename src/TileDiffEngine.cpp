@@ -0,0 +1,760 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "TileDiffEngine.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Order-dependent 64-bit fold used for band and frame fingerprints.
+static inline uint64_t foldFingerprint(uint64_t h, uint64_t v) {
+    h = (h << 23) | (h >> 41);
+    return (h ^ v) * 0x9E3779B97F4A7C15ULL;
+}
+
+// dst |= src over n bitset words. Returns the OR of all src words (non-zero if any bit was set).
+static inline uint64_t orWords(uint64_t *dst, const uint64_t *src, size_t n) {
+    size_t i = 0;
+    uint64_t any = 0;
+#if defined(__aarch64__)
+    uint64x2_t acc = vdupq_n_u64(0);
+    for (; i + 2 <= n; i += 2) {
+        uint64x2_t v = vld1q_u64(src + i);
+        vst1q_u64(dst + i, vorrq_u64(vld1q_u64(dst + i), v));
+        acc = vorrq_u64(acc, v);
+    }
+    any = vgetq_lane_u64(acc, 0) | vgetq_lane_u64(acc, 1);
+#elif defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(d, v));
+        acc = _mm_or_si128(acc, v);
+    }
+    any = (uint64_t)_mm_cvtsi128_si64(acc) | (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(acc, acc));
+#endif
+    for (; i < n; ++i) {
+        dst[i] |= src[i];
+        any |= src[i];
+    }
+    return any;
+}
+
+static const uint16_t kRecentFlushes = 0x000F; // activity bits of the last 4 flushes: finest sparse lattice
+static const uint16_t kWarmFlushes = 0x00FF;   // last 8 flushes: half the sparse stride
+static const int kHotMaxTilesDivisor = 4;       // hot regions cover at most 1/4 of the tiles (else none is hot)
+
+static inline bool testBit(const uint64_t *words, int i) { return (words[i >> 6] >> (i & 63)) & 1; }
+static inline void setBit(uint64_t *words, int i) { words[i >> 6] |= 1ULL << (i & 63); }
+
+// MARK: - Hashing
+
+void TileDiffEngine::setHashKernel(TileHashKernel kernel) {
+    const TileHashOps *ops = &TileHashResolve(kernel);
+    if (ops == mHashOps)
+        return;
+    mHashOps = ops;
+    // Hashes from different kernels are not comparable; force a full update.
+    if (!mPrevHash.empty()) {
+        memset(mPrevHash.data(), 0, mTileCount * sizeof(uint64_t));
+        std::fill(mPrevRowHash.begin(), mPrevRowHash.end(), 0);
+        resetCurrentHashes();
+    }
+}
+
+void TileDiffEngine::setDiffMode(TileDiffMode mode) {
+    if (mode == mDiffMode)
+        return;
+    mDiffMode = mode;
+    if (!mPrevHash.empty()) {
+        memset(mPrevHash.data(), 0, mTileCount * sizeof(uint64_t));
+        std::fill(mPrevRowHash.begin(), mPrevRowHash.end(), 0);
+        resetCurrentHashes();
+        resetChanged();
+    }
+}
+
+// MARK: - Tiling
+
+void TileDiffEngine::configure(int width, int height, int tileSize, int bytesPerPixel) {
+    if (tileSize < 1)
+        tileSize = 1;
+    int tilesX = (width + tileSize - 1) / tileSize;
+    int tilesY = (height + tileSize - 1) / tileSize;
+    size_t tileCount = (size_t)tilesX * (size_t)tilesY;
+
+    mWidth = width;
+    mHeight = height;
+    mBytesPerPixel = bytesPerPixel;
+
+    if (tilesX != mTilesX || tilesY != mTilesY || tileSize != mTileSize || tileCount != mTileCount ||
+        mPrevHash.empty() || mCurrHash.empty()) {
+        mPrevHash.assign(tileCount, 0); // force full update first frame
+        mCurrHash.assign(tileCount, mHashOps->basis);
+        mWordsPerRow = (tilesX + 63) / 64;
+        mPendingDirty.assign((size_t)tilesY * (size_t)mWordsPerRow, 0);
+        mChanged.assign((size_t)tilesY * (size_t)mWordsPerRow, 0);
+        mPrevRowHash.assign((size_t)tilesY, 0);
+        mCurrRowHash.assign((size_t)tilesY, 0);
+        mChangedRow.assign((size_t)tilesY, 0);
+        mPendingRow.assign((size_t)tilesY, 0);
+        mActivity.assign(tileCount, 0);
+        mHot.assign((size_t)tilesY * (size_t)mWordsPerRow, 0);
+        mHeld.assign((size_t)tilesY * (size_t)mWordsPerRow, 0);
+        mDropped.assign((size_t)tilesY * (size_t)mWordsPerRow, 0);
+        mExcluded.assign((size_t)tilesY * (size_t)mWordsPerRow, 0);
+        mHoldMask.assign((size_t)tilesY * (size_t)mWordsPerRow, 0);
+        mExcludedTiles = 0;
+        mHoldMaskTiles = 0;
+        mHotTiles = 0;
+        mDroppedTiles = 0;
+
+        mTileSize = tileSize;
+        mTilesX = tilesX;
+        mTilesY = tilesY;
+        mTileCount = tileCount;
+    }
+    resetCurrentHashes();
+}
+
+void TileDiffEngine::reserve(int width, int height, int tileSize) {
+    if (tileSize < 1)
+        tileSize = 1;
+    size_t tilesX = (size_t)((width + tileSize - 1) / tileSize);
+    size_t tilesY = (size_t)((height + tileSize - 1) / tileSize);
+    size_t tileCount = tilesX * tilesY;
+    size_t words = tilesY * ((tilesX + 63) / 64);
+    mPrevHash.reserve(tileCount);
+    mCurrHash.reserve(tileCount);
+    mRowBits.reserve((tilesX + 63) / 64);
+    for (std::vector<uint64_t> *v : {&mPendingDirty, &mChanged, &mHot, &mHeld, &mDropped, &mExcluded, &mHoldMask})
+        v->reserve(words);
+    mPrevRowHash.reserve(tilesY);
+    mCurrRowHash.reserve(tilesY);
+    mChangedRow.reserve(tilesY);
+    mPendingRow.reserve(tilesY);
+    mActivity.reserve(tileCount);
+}
+
+void TileDiffEngine::resetCurrentHashes() {
+    if (mCurrHash.empty())
+        return;
+    uint64_t basis = mHashOps->basis;
+    for (size_t i = 0; i < mTileCount; ++i) {
+        mCurrHash[i] = basis;
+    }
+    // Band fingerprints must match the reset tiles, or bands left unhashed would compare as unchanged
+    uint64_t rowHash = basis;
+    for (int tx = 0; tx < mTilesX; ++tx)
+        rowHash = foldFingerprint(rowHash, basis);
+    std::fill(mCurrRowHash.begin(), mCurrRowHash.end(), rowHash);
+    mHashDiffStale = true;
+}
+
+void TileDiffEngine::swapHashes() {
+    mPrevHash.swap(mCurrHash);
+    mPrevRowHash.swap(mCurrRowHash);
+    mHashDiffStale = true;
+}
+
+void TileDiffEngine::clearPending() {
+    std::fill(mPendingDirty.begin(), mPendingDirty.end(), 0);
+    std::fill(mPendingRow.begin(), mPendingRow.end(), 0);
+    if (mHeldTiles == 0)
+        return;
+    // Held hot tiles were not sent: they stay pending for a later flush
+    mPendingDirty.swap(mHeld);
+    for (int ty = 0; ty < mTilesY; ++ty) {
+        const uint64_t *bits = pendingWords(ty);
+        mPendingRow[(size_t)ty] = std::any_of(bits, bits + mWordsPerRow, [](uint64_t w) { return w != 0; });
+    }
+    mHeldTiles = 0;
+}
+
+// MARK: - Pyramid
+
+void TileDiffEngine::foldRowHash(int ty) {
+    const uint64_t *rowHashes = mCurrHash.data() + (size_t)ty * (size_t)mTilesX;
+    uint64_t h = mHashOps->basis;
+    for (int tx = 0; tx < mTilesX; ++tx)
+        h = foldFingerprint(h, rowHashes[tx]);
+    mCurrRowHash[(size_t)ty] = h;
+}
+
+bool TileDiffEngine::rowChanged(int ty) const {
+    if (mDiffMode != TileDiffMode::Hash)
+        return mChangedRow[(size_t)ty] != 0;
+    return mCurrRowHash[(size_t)ty] != mPrevRowHash[(size_t)ty];
+}
+
+bool TileDiffEngine::frameChanged() const {
+    if (mDiffMode != TileDiffMode::Hash)
+        return std::find(mChangedRow.begin(), mChangedRow.end(), 1) != mChangedRow.end();
+    uint64_t curr = mHashOps->basis;
+    uint64_t prev = mHashOps->basis;
+    for (int ty = 0; ty < mTilesY; ++ty) {
+        curr = foldFingerprint(curr, mCurrRowHash[(size_t)ty]);
+        prev = foldFingerprint(prev, mPrevRowHash[(size_t)ty]);
+    }
+    return curr != prev;
+}
+
+bool TileDiffEngine::hasPendingTiles() const {
+    return std::find(mPendingRow.begin(), mPendingRow.end(), 1) != mPendingRow.end();
+}
+
+void TileDiffEngine::refreshHashDiff() {
+    if (mDiffMode != TileDiffMode::Hash || !mHashDiffStale || mChanged.empty())
+        return;
+    mHashDiffStale = false;
+    for (int ty = 0; ty < mTilesY; ++ty) {
+        uint64_t *bits = changedWords(ty);
+        std::fill(bits, bits + mWordsPerRow, 0);
+        if (!rowChanged(ty))
+            continue; // identical band fingerprint
+        const uint64_t *curr = mCurrHash.data() + (size_t)ty * (size_t)mTilesX;
+        const uint64_t *prev = mPrevHash.data() + (size_t)ty * (size_t)mTilesX;
+        for (int tx = 0; tx < mTilesX; ++tx)
+            bits[tx >> 6] |= (uint64_t)(curr[tx] != prev[tx]) << (tx & 63);
+    }
+}
+
+// Accumulate pending dirty tiles for time-based coalescing: OR the changed words of changed bands into pending.
+void TileDiffEngine::accumulatePending() {
+    if (mPendingDirty.empty() || !frameChanged())
+        return;
+
+    refreshHashDiff();
+    uint64_t visited = 0;
+    for (int ty = 0; ty < mTilesY; ++ty) {
+        if (!rowChanged(ty))
+            continue;
+        if (orWords(pendingWords(ty), changedWords(ty), (size_t)mWordsPerRow) != 0)
+            mPendingRow[(size_t)ty] = 1;
+        visited += (uint64_t)mTilesX;
+    }
+    mTilesVisited.fetch_add(visited, std::memory_order_relaxed);
+}
+
+void TileDiffEngine::hashFull(const uint8_t *buf, size_t bytesPerRow) {
+    resetCurrentHashes();
+    hashTileRows(buf, bytesPerRow, 0, 1);
+}
+
+void TileDiffEngine::hashTileRows(const uint8_t *buf, size_t bytesPerRow, int firstRow, int rowStep) {
+    if (rowStep < 1)
+        rowStep = 1;
+    uint64_t *curr = mCurrHash.data();
+    const TileHashRowFn hashRow = mHashOps->hashRow;
+    const size_t tileBytes = (size_t)mTileSize * (size_t)mBytesPerPixel;
+    const size_t lastTileBytes = (size_t)(mWidth - (mTilesX - 1) * mTileSize) * (size_t)mBytesPerPixel;
+    uint64_t touched = 0;
+    for (int ty = firstRow; ty < mTilesY; ty += rowStep) {
+        int startY = ty * mTileSize;
+        int endY = startY + mTileSize;
+        if (startY >= mHeight)
+            break;
+        if (endY > mHeight)
+            endY = mHeight;
+        uint64_t *rowHashes = curr + (size_t)ty * (size_t)mTilesX;
+        for (int y = startY; y < endY; ++y) {
+            hashRow(rowHashes, buf + (size_t)y * bytesPerRow, mTilesX, tileBytes, lastTileBytes);
+        }
+        foldRowHash(ty);
+        touched += (uint64_t)(endY - startY) * (uint64_t)mWidth * (uint64_t)mBytesPerPixel;
+    }
+    mBytesTouched.fetch_add(touched, std::memory_order_relaxed);
+}
+
+void TileDiffEngine::hashRow(const uint8_t *row, int y) {
+    if (y < 0 || y >= mHeight)
+        return;
+    const size_t tileBytes = (size_t)mTileSize * (size_t)mBytesPerPixel;
+    const size_t lastTileBytes = (size_t)(mWidth - (mTilesX - 1) * mTileSize) * (size_t)mBytesPerPixel;
+    int ty = y / mTileSize;
+    uint64_t *rowHashes = mCurrHash.data() + (size_t)ty * (size_t)mTilesX;
+    mHashOps->hashRow(rowHashes, row, mTilesX, tileBytes, lastTileBytes);
+    if (y == std::min((ty + 1) * mTileSize, mHeight) - 1)
+        foldRowHash(ty); // last row of this tile row
+    mBytesTouched.fetch_add((uint64_t)mWidth * (uint64_t)mBytesPerPixel, std::memory_order_relaxed);
+}
+
+// MARK: - Sparse Sampling
+
+void TileDiffEngine::setFocusRect(const DirtyRect &rect) {
+    if (rect.w <= 0 || rect.h <= 0 || mTilesX <= 0) {
+        mFocusX0 = mFocusY0 = 0;
+        mFocusX1 = mFocusY1 = -1;
+        return;
+    }
+    mFocusX0 = std::max(rect.x, 0) / mTileSize;
+    mFocusY0 = std::max(rect.y, 0) / mTileSize;
+    mFocusX1 = std::min((rect.x + rect.w - 1) / mTileSize, mTilesX - 1);
+    mFocusY1 = std::min((rect.y + rect.h - 1) / mTileSize, mTilesY - 1);
+}
+
+bool TileDiffEngine::hasPendingInRect(const DirtyRect &rect) const {
+    if (mPendingDirty.empty() || rect.w <= 0 || rect.h <= 0)
+        return false;
+    int tx0 = std::max(rect.x, 0) / mTileSize, ty0 = std::max(rect.y, 0) / mTileSize;
+    int tx1 = std::min((rect.x + rect.w - 1) / mTileSize, mTilesX - 1);
+    int ty1 = std::min((rect.y + rect.h - 1) / mTileSize, mTilesY - 1);
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        if (!mPendingRow[(size_t)ty])
+            continue;
+        const uint64_t *bits = mPendingDirty.data() + (size_t)ty * (size_t)mWordsPerRow;
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            if (testBit(bits, tx))
+                return true;
+        }
+    }
+    return false;
+}
+
+int TileDiffEngine::sparseStride(int tile, int base) const {
+    const int tx = tile % mTilesX, ty = tile / mTilesX;
+    if (tx >= mFocusX0 && tx <= mFocusX1 && ty >= mFocusY0 && ty <= mFocusY1)
+        return 1;
+    const uint16_t activity = mActivity[(size_t)tile];
+    if (activity & kRecentFlushes)
+        return 1;
+    if (activity & kWarmFlushes)
+        return std::max(1, base / 2);
+    return base;
+}
+
+int TileDiffEngine::sampleSparse(const uint8_t *buf, const uint8_t *ref, size_t bytesPerRow, int sx, int sy) {
+    if (mPendingDirty.empty())
+        return 0;
+    mSparseStrideX = std::max(1, sx);
+    mSparseStrideY = std::max(1, sy);
+    const size_t bpp = (size_t)mBytesPerPixel;
+    const uint32_t phase = mSparsePhase++;
+    uint64_t samples = 0;
+    int marked = 0;
+
+    for (int ty = 0; ty < mTilesY; ++ty) {
+        uint64_t *pending = pendingWords(ty);
+        const int startY = ty * mTileSize;
+        const int endY = std::min(startY + mTileSize, mHeight);
+        for (int tx = 0; tx < mTilesX; ++tx) {
+            if (testBit(pending, tx))
+                continue; // already known dirty
+            const int tile = ty * mTilesX + tx;
+            const int stepX = sparseStride(tile, mSparseStrideX), stepY = sparseStride(tile, mSparseStrideY);
+            // Consecutive phases walk every (px, py) of the tile's lattice cell once per stepX * stepY calls
+            const int px = (int)(phase % (uint32_t)stepX), py = (int)(phase / (uint32_t)stepX % (uint32_t)stepY);
+            const int startX = tx * mTileSize;
+            const int endX = std::min(startX + mTileSize, mWidth);
+            bool differs = false;
+            for (int y = startY + py; y < endY && !differs; y += stepY) {
+                const uint8_t *a = buf + (size_t)y * bytesPerRow;
+                const uint8_t *b = ref + (size_t)y * bytesPerRow;
+                for (int x = startX + px; x < endX; x += stepX) {
+                    samples++;
+                    if (memcmp(a + (size_t)x * bpp, b + (size_t)x * bpp, bpp) != 0) {
+                        differs = true;
+                        break;
+                    }
+                }
+            }
+            if (differs) {
+                setBit(pending, tx);
+                mPendingRow[(size_t)ty] = 1;
+                marked++;
+            }
+        }
+    }
+    mSparseCoverage = mWidth > 0 && mHeight > 0 ? (double)samples / ((double)mWidth * (double)mHeight) : 0.0;
+    mBytesTouched.fetch_add(2 * samples * bpp, std::memory_order_relaxed);
+    return marked;
+}
+
+void TileDiffEngine::updateChangeHistory() {
+    if (mActivity.empty())
+        return;
+    refreshHashDiff();
+    int hotTiles = 0;
+    for (int ty = 0; ty < mTilesY; ++ty) {
+        const uint64_t *pending = pendingWords(ty);
+        const uint64_t *changed = changedWords(ty);
+        const uint64_t *held = mHeld.data() + (size_t)ty * (size_t)mWordsPerRow;
+        uint64_t *hot = mHot.data() + (size_t)ty * (size_t)mWordsPerRow;
+        uint16_t *activity = mActivity.data() + (size_t)ty * (size_t)mTilesX;
+        std::fill(hot, hot + mWordsPerRow, 0);
+        for (int tx = 0; tx < mTilesX; ++tx) {
+            bool dirty = testBit(pending, tx) || testBit(changed, tx) || testBit(held, tx);
+            activity[tx] = (uint16_t)(activity[tx] << 1 | (dirty ? 1 : 0));
+            if (mHotMinFlushes > 0 && std::popcount(activity[tx]) >= mHotMinFlushes) {
+                setBit(hot, tx);
+                hotTiles++;
+            }
+        }
+    }
+    // Most of the screen changing all the time is the user scrolling, dragging or playing: never throttle that
+    if ((size_t)hotTiles * (size_t)kHotMaxTilesDivisor > mTileCount) {
+        std::fill(mHot.begin(), mHot.end(), 0);
+        hotTiles = 0;
+    }
+    mHotTiles = hotTiles;
+}
+
+// MARK: - Hot Regions & Region Masks
+
+void TileDiffEngine::setHotThreshold(int minFlushes) { mHotMinFlushes = std::max(0, std::min(16, minFlushes)); }
+
+uint64_t TileDiffEngine::focusWord(int ty, int w) const {
+    if (ty < mFocusY0 || ty > mFocusY1)
+        return 0;
+    const int lo = std::max(mFocusX0 - w * 64, 0), hi = std::min(mFocusX1 - w * 64, 63);
+    if (lo > hi)
+        return 0;
+    const uint64_t upTo = hi == 63 ? ~0ULL : (1ULL << (hi + 1)) - 1;
+    return upTo & ~((1ULL << lo) - 1);
+}
+
+// Set the bits of the tiles touching any of the rects; returns the number of tiles set
+static int fillTileMask(std::vector<uint64_t> &mask, int wordsPerRow, int tileSize, int tilesX, int tilesY,
+                        const DirtyRect *rects, int count) {
+    std::fill(mask.begin(), mask.end(), 0);
+    int tiles = 0;
+    for (int i = 0; i < count; ++i) {
+        const DirtyRect &r = rects[i];
+        if (r.w <= 0 || r.h <= 0)
+            continue;
+        int tx0 = std::max(r.x, 0) / tileSize, ty0 = std::max(r.y, 0) / tileSize;
+        int tx1 = std::min((r.x + r.w - 1) / tileSize, tilesX - 1);
+        int ty1 = std::min((r.y + r.h - 1) / tileSize, tilesY - 1);
+        for (int ty = ty0; ty <= ty1; ++ty) {
+            uint64_t *bits = mask.data() + (size_t)ty * (size_t)wordsPerRow;
+            for (int tx = tx0; tx <= tx1; ++tx) {
+                if (!testBit(bits, tx)) {
+                    setBit(bits, tx);
+                    tiles++;
+                }
+            }
+        }
+    }
+    return tiles;
+}
+
+void TileDiffEngine::setRegionMasks(const DirtyRect *excluded, int excludedCount, const DirtyRect *held,
+                                    int heldCount) {
+    if (mExcluded.empty())
+        return;
+    if (excludedCount > 0 || mExcludedTiles > 0)
+        mExcludedTiles = fillTileMask(mExcluded, mWordsPerRow, mTileSize, mTilesX, mTilesY, excluded, excludedCount);
+    if (heldCount > 0 || mHoldMaskTiles > 0)
+        mHoldMaskTiles = fillTileMask(mHoldMask, mWordsPerRow, mTileSize, mTilesX, mTilesY, held, heldCount);
+}
+
+void TileDiffEngine::restoreHeldTiles(uint8_t *buf, const uint8_t *ref, size_t bytesPerRow) const {
+    if (mHeldTiles == 0 && mDroppedTiles == 0)
+        return;
+    const size_t bpp = (size_t)mBytesPerPixel;
+    for (int ty = 0; ty < mTilesY; ++ty) {
+        const uint64_t *held = mHeld.data() + (size_t)ty * (size_t)mWordsPerRow;
+        const uint64_t *dropped = mDropped.data() + (size_t)ty * (size_t)mWordsPerRow;
+        const int startY = ty * mTileSize;
+        const int endY = std::min(startY + mTileSize, mHeight);
+        for (int tx = 0; tx < mTilesX; ++tx) {
+            if (!testBit(held, tx) && !testBit(dropped, tx))
+                continue;
+            const int startX = tx * mTileSize;
+            const size_t len = (size_t)(std::min(startX + mTileSize, mWidth) - startX) * bpp;
+            for (int y = startY; y < endY; ++y)
+                memcpy(buf + (size_t)y * bytesPerRow + (size_t)startX * bpp,
+                       ref + (size_t)y * bytesPerRow + (size_t)startX * bpp, len);
+        }
+    }
+}
+
+void TileDiffEngine::releaseHeldTiles() {
+    std::fill(mHeld.begin(), mHeld.end(), 0);
+    std::fill(mDropped.begin(), mDropped.end(), 0);
+    mHeldTiles = 0;
+    mDroppedTiles = 0;
+}
+
+// MARK: - Compare
+
+void TileDiffEngine::resetChanged() {
+    std::fill(mChanged.begin(), mChanged.end(), 0);
+    std::fill(mChangedRow.begin(), mChangedRow.end(), 0);
+    mHashDiffStale = true;
+}
+
+void TileDiffEngine::markChanged(const DirtyRect &rect) {
+    if (mChanged.empty() || rect.w <= 0 || rect.h <= 0)
+        return;
+    int tx0 = std::max(rect.x, 0) / mTileSize;
+    int ty0 = std::max(rect.y, 0) / mTileSize;
+    int tx1 = std::min((rect.x + rect.w - 1) / mTileSize, mTilesX - 1);
+    int ty1 = std::min((rect.y + rect.h - 1) / mTileSize, mTilesY - 1);
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        uint64_t *bits = changedWords(ty);
+        for (int tx = tx0; tx <= tx1; ++tx)
+            setBit(bits, tx);
+        mChangedRow[(size_t)ty] = 1;
+    }
+}
+
+void TileDiffEngine::compareFull(const uint8_t *buf, const uint8_t *ref, size_t bytesPerRow) {
+    resetChanged();
+    compareTileRows(buf, ref, bytesPerRow, 0, 1);
+}
+
+// Row-major walk over each tile row; a tile stops being read as soon as one of its row segments differs.
+void TileDiffEngine::compareTileRows(const uint8_t *buf, const uint8_t *ref, size_t bytesPerRow, int firstRow,
+                                     int rowStep) {
+    if (rowStep < 1)
+        rowStep = 1;
+    const size_t tileBytes = (size_t)mTileSize * (size_t)mBytesPerPixel;
+    const size_t lastTileBytes = (size_t)(mWidth - (mTilesX - 1) * mTileSize) * (size_t)mBytesPerPixel;
+    uint64_t touched = 0;
+    for (int ty = firstRow; ty < mTilesY; ty += rowStep) {
+        int startY = ty * mTileSize;
+        int endY = startY + mTileSize;
+        if (startY >= mHeight)
+            break;
+        if (endY > mHeight)
+            endY = mHeight;
+        uint64_t *changed = changedWords(ty); // this tile row's own words, so bands never share a word
+        int unchanged = mTilesX;
+        for (int w = 0; w < mWordsPerRow; ++w)
+            unchanged -= std::popcount(changed[w]);
+        for (int y = startY; y < endY && unchanged > 0; ++y) {
+            const uint8_t *rowA = buf + (size_t)y * bytesPerRow;
+            const uint8_t *rowB = ref + (size_t)y * bytesPerRow;
+            for (int tx = 0; tx < mTilesX; ++tx) {
+                if (testBit(changed, tx))
+                    continue;
+                size_t offset = (size_t)tx * tileBytes;
+                size_t length = (tx == mTilesX - 1) ? lastTileBytes : tileBytes;
+                touched += 2 * length;
+                if (memcmp(rowA + offset, rowB + offset, length) != 0) {
+                    setBit(changed, tx);
+                    unchanged--;
+                }
+            }
+        }
+        if (unchanged < mTilesX)
+            mChangedRow[(size_t)ty] = 1;
+    }
+    mBytesTouched.fetch_add(touched, std::memory_order_relaxed);
+}
+
+// MARK: - Dirty Rects
+
+template <typename RowWords, typename RowActive>
+int TileDiffEngine::buildRects(RowWords rowWords, RowActive rowActive, DirtyRect *rects, int maxRects,
+                               int *outChangedTiles) {
+    int changedTiles = 0;
+    uint64_t visited = 0;
+    std::vector<uint64_t> &bits = mRowBits;
+    bits.resize((size_t)mWordsPerRow);
+
+    // First tile at or after tx whose bit equals `set` (mTilesX if none); padding bits are always clear
+    auto scan = [&](int tx, bool set) {
+        int w = tx >> 6;
+        if (w >= mWordsPerRow)
+            return mTilesX;
+        uint64_t word = (set ? bits[(size_t)w] : ~bits[(size_t)w]) & (~0ULL << (tx & 63));
+        while (word == 0) {
+            if (++w >= mWordsPerRow)
+                return mTilesX;
+            word = set ? bits[(size_t)w] : ~bits[(size_t)w];
+        }
+        return std::min(mTilesX, (w << 6) + std::countr_zero(word));
+    };
+
+    // Horizontal runs per tile row, skipping bands without dirty tiles; the coalescer merges them by cost
+    mCoalescer.begin();
+    for (int ty = 0; ty < mTilesY; ++ty) {
+        if (!rowActive(ty))
+            continue;
+        visited += (uint64_t)mTilesX;
+        rowWords(ty, bits.data());
+        for (int w = 0; w < mWordsPerRow; ++w)
+            changedTiles += std::popcount(bits[(size_t)w]);
+
+        for (int runStart = scan(0, true); runStart < mTilesX;) {
+            int runEnd = scan(runStart, false);
+
+            // Emit this horizontal run, clipped to screen bounds
+            int x = runStart * mTileSize;
+            int w = (runEnd - runStart) * mTileSize;
+            int y = ty * mTileSize;
+            int h = mTileSize;
+            if (x + w > mWidth)
+                w = mWidth - x;
+            if (y + h > mHeight)
+                h = mHeight - y;
+            mCoalescer.addRun(x, y, w, h);
+
+            runStart = scan(runEnd, true);
+        }
+    }
+    mTilesVisited.fetch_add(visited, std::memory_order_relaxed);
+
+    int rectCount = mCoalescer.finish(rects, maxRects);
+    if (outChangedTiles)
+        *outChangedTiles = changedTiles;
+    return rectCount;
+}
+
+int TileDiffEngine::buildDirtyRects(DirtyRect *rects, int maxRects, int *outChangedTiles) {
+    if (mChanged.empty() || !frameChanged()) {
+        if (outChangedTiles)
+            *outChangedTiles = 0;
+        return 0;
+    }
+    refreshHashDiff();
+    const size_t words = (size_t)mWordsPerRow;
+    auto rowWords = [this, words](int ty, uint64_t *out) { memcpy(out, changedWords(ty), words * sizeof(uint64_t)); };
+    auto rowActive = [this](int ty) { return rowChanged(ty); };
+    return buildRects(rowWords, rowActive, rects, maxRects, outChangedTiles);
+}
+
+// Build rects from the pending bitset OR'ed with the current frame's changed bitset
+int TileDiffEngine::buildRectsFromPending(DirtyRect *rects, int maxRects, int *outChangedTiles, bool holdHot) {
+    if (outChangedTiles)
+        *outChangedTiles = 0;
+    std::fill(mHeld.begin(), mHeld.end(), 0);
+    std::fill(mDropped.begin(), mDropped.end(), 0);
+    mHeldTiles = 0;
+    mDroppedTiles = 0;
+    if (mPendingDirty.empty())
+        return 0;
+    bool anyChanged = frameChanged();
+    if (!anyChanged && !hasPendingTiles())
+        return 0;
+
+    refreshHashDiff();
+    const size_t words = (size_t)mWordsPerRow;
+    const uint8_t *pendingRow = mPendingRow.data();
+    const bool holdHotTiles = holdHot && mHotTiles > 0;
+    const bool masked = holdHotTiles || mHoldMaskTiles > 0 || mExcludedTiles > 0;
+    auto rowWords = [this, words, pendingRow, anyChanged, holdHotTiles, masked](int ty, uint64_t *out) {
+        memcpy(out, pendingWords(ty), words * sizeof(uint64_t));
+        if (anyChanged && rowChanged(ty))
+            orWords(out, changedWords(ty), words);
+        if (!masked)
+            return;
+        // Dirty held tiles sit this flush out and clearPending() keeps them pending; excluded ones are dropped
+        const size_t row = (size_t)ty * words;
+        uint64_t *held = mHeld.data() + row;
+        uint64_t *dropped = mDropped.data() + row;
+        for (size_t w = 0; w < words; ++w) {
+            // Tiles the user is touching go out on every flush
+            uint64_t hold = (mHoldMask[row + w] | (holdHotTiles ? mHot[row + w] : 0)) & ~focusWord(ty, (int)w);
+            dropped[w] = out[w] & mExcluded[row + w];
+            held[w] = out[w] & hold & ~mExcluded[row + w];
+            out[w] &= ~(hold | mExcluded[row + w]);
+            mHeldTiles += std::popcount(held[w]);
+            mDroppedTiles += std::popcount(dropped[w]);
+        }
+    };
+    auto rowActive = [this, pendingRow, anyChanged](int ty) {
+        return pendingRow[ty] != 0 || (anyChanged && rowChanged(ty));
+    };
+    return buildRects(rowWords, rowActive, rects, maxRects, outChangedTiles);
+}
+
+// MARK: - Refinement
+
+// Top/bottom bounds come from whole-row compares; left/right bounds are then narrowed per differing row,
+// each row only scanning the columns outside the bounds found so far.
+int TileDiffEngine::refineRects(DirtyRect *rects, int rectCount, const uint8_t *buf, const uint8_t *ref,
+                                size_t bytesPerRow, int maxArea) {
+    int k = 0;
+    for (int i = 0; i < rectCount; ++i) {
+        DirtyRect r = rects[i];
+        if (r.w <= 0 || r.h <= 0)
+            continue;
+        if ((int64_t)r.w * (int64_t)r.h <= (int64_t)maxArea && !refineRect(r, buf, ref, bytesPerRow))
+            continue; // identical, nothing to send
+        rects[k++] = r;
+    }
+    return k;
+}
+
+bool TileDiffEngine::refineRect(DirtyRect &r, const uint8_t *buf, const uint8_t *ref, size_t bytesPerRow) {
+    if (r.w <= 0 || r.h <= 0)
+        return false;
+    const size_t bpp = (size_t)mBytesPerPixel;
+    const size_t rowBytes = (size_t)r.w * bpp;
+    auto rowA = [&](int y) { return buf + (size_t)y * bytesPerRow + (size_t)r.x * bpp; };
+    auto rowB = [&](int y) { return ref + (size_t)y * bytesPerRow + (size_t)r.x * bpp; };
+    auto pixelDiffers = [&](int y, int x) {
+        return memcmp(rowA(y) + (size_t)x * bpp, rowB(y) + (size_t)x * bpp, bpp) != 0;
+    };
+
+    int top = r.y;
+    int endY = r.y + r.h;
+    while (top < endY && memcmp(rowA(top), rowB(top), rowBytes) == 0)
+        top++;
+    uint64_t touched = 2 * (uint64_t)rowBytes * (uint64_t)(top - r.y + (top < endY ? 1 : 0));
+    if (top == endY) {
+        mBytesTouched.fetch_add(touched, std::memory_order_relaxed);
+        return false;
+    }
+
+    int bottom = endY - 1;
+    while (bottom > top && memcmp(rowA(bottom), rowB(bottom), rowBytes) == 0)
+        bottom--;
+    touched += 2 * (uint64_t)rowBytes * (uint64_t)(endY - bottom);
+
+    int left = r.w;  // first differing column, relative to r.x
+    int right = -1; // last differing column, relative to r.x
+    for (int y = top; y <= bottom; ++y) {
+        if (y != top && y != bottom && memcmp(rowA(y), rowB(y), rowBytes) == 0) {
+            touched += 2 * (uint64_t)rowBytes;
+            continue;
+        }
+        int x = 0;
+        while (x < left && !pixelDiffers(y, x))
+            x++;
+        if (x < left)
+            left = x;
+        int scanned = x;
+        x = r.w - 1;
+        while (x > right && x >= left && !pixelDiffers(y, x))
+            x--;
+        if (x > right && x >= left)
+            right = x;
+        scanned += r.w - 1 - x;
+        touched += 2 * (uint64_t)scanned * (uint64_t)bpp;
+        if (left == 0 && right == r.w - 1)
+            break; // cannot grow any further
+    }
+    mBytesTouched.fetch_add(touched, std::memory_order_relaxed);
+    if (right < left)
+        return false; // defensive: the top row always has a differing pixel
+
+    r = DirtyRect{r.x + left, top, right - left + 1, bottom - top + 1};
+    return true;
+}
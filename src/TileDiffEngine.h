@@ -0,0 +1,315 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TileDiffEngine_h
+#define TileDiffEngine_h
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RectCoalescer.h"
+#include "TileHash.h"
+
+/** How tiles are classified as changed. */
+enum class TileDiffMode {
+    Hash = 0, // per-tile hash compared against the previous frame's hashes
+    Compare,  // byte compare against the previously published frame (exact, stops at the first difference)
+    Mask,     // changed tiles are marked by the caller (markChanged), e.g. from source-space detection
+};
+
+/**
+ TileDiffEngine
+ ----------------
+ Tile-based dirty detection over a tightly packed 32-bit framebuffer. The frame
+ is split into tileSize x tileSize tiles; each tile gets a rolling hash per frame
+ which is compared against the previous frame to produce dirty rectangles.
+ In Compare mode the hashes are bypassed: tiles are compared byte-wise against a
+ reference buffer (the front buffer clients currently see).
+
+ Hash pyramid:
+ - Each tile row (band) also gets a fingerprint folded from its tile hashes, and
+   the frame fingerprint is folded from the band fingerprints.
+ - An identical frame fingerprint means nothing changed; unchanged bands skip
+   their per-tile comparisons in accumulatePending() and rect building.
+ - In Compare/Mask mode the bands carry a "has changed tile" flag instead.
+
+ Sparse sampling:
+ - During a defer window, sampleSparse() compares a lattice of pixels against
+   the published frame; a differing sample is a real change, so its tile turns
+   pending right away. The lattice phase rotates per call, so thin changes
+   between lattice points (a caret, anti-aliased text) are found within a few
+   frames instead of only at flush.
+ - Tiles that changed in recent flushes are sampled with a finer stride (down
+   to every pixel), idle tiles with the configured one. Focus tiles (where the
+   user is touching) are always sampled at every pixel.
+
+ Hot regions:
+ - Every flush shifts each tile's dirty flag into a 16-bit activity history.
+   Tiles dirty in most recent flushes (a playing video, a spinner, a progress
+   bar) are hot, as long as they cover at most a quarter of the frame: beyond
+   that (scrolling, dragging a map, a game) nothing is classified hot.
+ - Rect building can hold dirty hot tiles back so the caller can update them
+   at a lower rate; held tiles stay pending until a flush takes them. Focus
+   tiles are never held.
+ - Region masks work the same way for caller-defined areas (a status bar):
+   held regions are updated when the caller stops holding them, excluded
+   regions are dropped and never reported.
+
+ Dirty maps:
+ - Changed and pending tiles are packed bitsets, one run of 64-bit words per
+   tile row (rows never share a word). In Hash mode the changed bits are
+   derived from the hashes on demand.
+ - Pending accumulation ORs the changed words into the pending words; rect
+   building scans (pending | changed) word by word and skips runs of clean
+   tiles with bit scans.
+
+ Ownership & threading:
+ - Owns the current/previous hash arrays and the pending dirty mask.
+ - Not thread-safe. hashTileRows() may be called concurrently for disjoint
+   (firstRow, rowStep) bands since each tile row is written by one band only.
+   The same holds for compareTileRows(), for hashRow() on different tile rows,
+   and for refineRect() on different rects.
+
+ Portability:
+ - Plain C++20, no Foundation/Accelerate dependencies, so it can be built and
+   profiled off-device.
+ - Hash kernel is pluggable (see TileHash.h); defaults to the best one for the CPU.
+ */
+class TileDiffEngine {
+  public:
+    TileDiffEngine() = default;
+
+    /** Select the tile hash kernel. Unsupported kernels fall back to Auto. Switching kernels forces a full update. */
+    void setHashKernel(TileHashKernel kernel);
+
+    /** Select the diff mode. Switching modes forces a full update. */
+    void setDiffMode(TileDiffMode mode);
+    TileDiffMode diffMode() const { return mDiffMode; }
+
+    /** Reconfigure for a new geometry. Resets all state when the tile grid changes
+        (previous hashes are zeroed to force a full update), else only resets current hashes. */
+    void configure(int width, int height, int tileSize, int bytesPerPixel);
+
+    /** Reserve per-tile storage for a geometry configured later (the other orientation), so that configure()
+        does not allocate when switching to it. */
+    void reserve(int width, int height, int tileSize);
+
+    /** Reset current hashes to the hash basis. */
+    void resetCurrentHashes();
+
+    /** Current hashes become previous (call after a flush). */
+    void swapHashes();
+
+    /** Full hash of every tile; resets current hashes first. */
+    void hashFull(const uint8_t *buf, size_t bytesPerRow);
+
+    /** Sparse pass: compare every sx-th pixel of every sy-th row of buf against ref (same geometry and stride) and
+        mark tiles with a differing sample as pending. Tiles already pending are skipped. The lattice phase moves on
+        every call, so every pixel is sampled within sparseCycle() calls; recently changed tiles use a finer
+        lattice. Returns the number of tiles marked. */
+    int sampleSparse(const uint8_t *buf, const uint8_t *ref, size_t bytesPerRow, int sx, int sy);
+
+    /** Tiles intersecting rect (e.g. around the touch point) are sampled at every pixel by sampleSparse() and are
+        never held by buildRectsFromPending(). An empty rect clears the focus. */
+    void setFocusRect(const DirtyRect &rect);
+
+    /** Whether any pending tile intersects rect. */
+    bool hasPendingInRect(const DirtyRect &rect) const;
+
+    /** Calls of sampleSparse() after which every pixel has been sampled at least once. */
+    int sparseCycle() const { return mSparseStrideX * mSparseStrideY; }
+
+    /** Fraction of the frame's pixels sampled by the last sparse pass. */
+    double sparseCoverage() const { return mSparseCoverage; }
+
+    /** Shift the tiles being flushed (pending, changed or held) into the per-tile activity history, which sets
+        each tile's sparse stride and hot classification. Call at flush, before clearPending(). */
+    void updateChangeHistory();
+
+    /** Tiles dirty in at least minFlushes of the last 16 flushes are hot (0 = never), unless more than a quarter of
+        all tiles would be. */
+    void setHotThreshold(int minFlushes);
+
+    /** Hot tiles as of the last updateChangeHistory(). */
+    int hotTiles() const { return mHotTiles; }
+
+    /** Dirty hot tiles left out by the last buildRectsFromPending(); clearPending() keeps them pending. */
+    int heldTiles() const { return mHeldTiles; }
+
+    /** Region masks for the next buildRectsFromPending(), in pixels: tiles touching an excluded rect are never
+        reported and are dropped from pending (see droppedTiles()); tiles touching a held rect are held like hot
+        tiles, except focus tiles. Masks stay set until replaced. */
+    void setRegionMasks(const DirtyRect *excluded, int excludedCount, const DirtyRect *held, int heldCount);
+
+    /** Dirty excluded tiles dropped by the last buildRectsFromPending(). */
+    int droppedTiles() const { return mDroppedTiles; }
+
+    /** Copy the held and dropped tiles from ref into buf (same geometry and stride), so a buffer about to be
+        published keeps the content clients already have there. */
+    void restoreHeldTiles(uint8_t *buf, const uint8_t *ref, size_t bytesPerRow) const;
+
+    /** Forget the held and dropped tiles of the last buildRectsFromPending() (their content goes out after all). */
+    void releaseHeldTiles();
+
+    /** Hash tile rows firstRow, firstRow + rowStep, ... without resetting. Used to split work across threads. */
+    void hashTileRows(const uint8_t *buf, size_t bytesPerRow, int firstRow, int rowStep);
+
+    /** Mask mode: mark every tile intersecting the rect as changed. */
+    void markChanged(const DirtyRect &rect);
+
+    /** Compare/Mask mode: clear the changed-tile mask. */
+    void resetChanged();
+
+    /** Compare mode: compare every tile of buf against ref (same geometry and stride); resets the mask first. */
+    void compareFull(const uint8_t *buf, const uint8_t *ref, size_t bytesPerRow);
+
+    /** Compare tile rows firstRow, firstRow + rowStep, ... without resetting. Used to split work across threads. */
+    void compareTileRows(const uint8_t *buf, const uint8_t *ref, size_t bytesPerRow, int firstRow, int rowStep);
+
+    /** Fold framebuffer row y into its tile row's hashes, for callers that hash while producing the frame.
+        Call resetCurrentHashes() first; rows of one tile row must be fed in order from a single thread. */
+    void hashRow(const uint8_t *row, int y);
+
+    /** Mark changed tiles (hash differs from previous, or compare mismatch) as pending. */
+    void accumulatePending();
+
+    /** Clear the pending dirty mask. */
+    void clearPending();
+
+    /** Whether any tile changed in the current frame (frame fingerprint, or any changed band). */
+    bool frameChanged() const;
+
+    /** Whether any tile is pending. */
+    bool hasPendingTiles() const;
+
+    /** Build dirty rectangles from tile hash diffs (or the changed mask). Returns number of rects written, up to
+        maxRects; runs are coalesced under the rect cost model and reduced to fit, so they cover every dirty tile. */
+    int buildDirtyRects(DirtyRect *rects, int maxRects, int *outChangedTiles);
+
+    /** Build dirty rectangles from the pending mask merged with the current frame's changed tiles, in one pass.
+        outChangedTiles receives the number of tiles covered (pending or changed). With holdHot, dirty hot tiles
+        are left out and held (see heldTiles()); region masks apply on every call (see setRegionMasks()). */
+    int buildRectsFromPending(DirtyRect *rects, int maxRects, int *outChangedTiles = nullptr, bool holdHot = false);
+
+    /** Rect cost model used when coalescing: bytes per rect, estimated encoded bytes per pixel. */
+    void setRectCostModel(double headerBytes, double pixelBytes) { mCoalescer.setCostModel(headerBytes, pixelBytes); }
+
+    /** Merge arbitrary rects under the cost model, reducing to at most maxRects. Returns the new count. */
+    int coalesceRects(DirtyRect *rects, int rectCount, int maxRects) {
+        return mCoalescer.reduce(rects, rectCount, maxRects);
+    }
+
+    /** Shrink each rect of at most maxArea pixels to the bounding box of the pixels where buf differs from ref
+        (same geometry and stride); rects without any difference are dropped, larger rects are kept as-is.
+        Returns the new rect count. */
+    int refineRects(DirtyRect *rects, int rectCount, const uint8_t *buf, const uint8_t *ref, size_t bytesPerRow,
+                    int maxArea);
+
+    /** Shrink one rect to the bounding box of its differing pixels. Returns false if there are none.
+        Only touches the byte counter, so disjoint calls may run concurrently (see refineRects()). */
+    bool refineRect(DirtyRect &rect, const uint8_t *buf, const uint8_t *ref, size_t bytesPerRow);
+
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    int tileSize() const { return mTileSize; }
+    int tilesX() const { return mTilesX; }
+    int tilesY() const { return mTilesY; }
+    size_t tileCount() const { return mTileCount; }
+
+    /** Hash mode: tile hashes of the current frame and of the last flushed one (tileCount() each, row-major). */
+    const uint64_t *currentHashes() const { return mCurrHash.data(); }
+    const uint64_t *previousHashes() const { return mPrevHash.data(); }
+
+    /** Short name of the active hash kernel (for logging). */
+    const char *hashName() const { return mHashOps->name; }
+    TileHashKernel hashKernel() const { return mHashOps->kernel; }
+
+    /** Framebuffer bytes read by hashing/comparing since the last reset (both buffers count in Compare mode). */
+    uint64_t bytesTouched() const { return mBytesTouched.load(std::memory_order_relaxed); }
+    void resetBytesTouched() { mBytesTouched.store(0, std::memory_order_relaxed); }
+
+    /** Tiles inspected by pending accumulation and rect building since the last reset (bands skipped don't count). */
+    uint64_t tilesVisited() const { return mTilesVisited.load(std::memory_order_relaxed); }
+    void resetTilesVisited() { mTilesVisited.store(0, std::memory_order_relaxed); }
+
+  private:
+    template <typename RowWords, typename RowActive>
+    int buildRects(RowWords rowWords, RowActive rowActive, DirtyRect *rects, int maxRects, int *outChangedTiles);
+
+    /** Hash mode: rebuild the changed bitset from current vs previous hashes if they moved since. */
+    void refreshHashDiff();
+
+    uint64_t *changedWords(int ty) { return mChanged.data() + (size_t)ty * (size_t)mWordsPerRow; }
+    uint64_t *pendingWords(int ty) { return mPendingDirty.data() + (size_t)ty * (size_t)mWordsPerRow; }
+
+    /** Sparse lattice stride of a tile along one axis, from its change history. */
+    int sparseStride(int tile, int base) const;
+
+    /** Fold tile row ty's current hashes into its band fingerprint. */
+    void foldRowHash(int ty);
+
+    /** Whether tile row ty has any changed tile (band fingerprint differs, or changed flag). */
+    bool rowChanged(int ty) const;
+
+    /** Bits of word w of tile row ty that fall inside the focus tiles. */
+    uint64_t focusWord(int ty, int w) const;
+
+    int mWidth = 0;
+    int mHeight = 0;
+    int mTileSize = 32;
+    int mBytesPerPixel = 4;
+    int mTilesX = 0;
+    int mTilesY = 0;
+    size_t mTileCount = 0;
+    const TileHashOps *mHashOps = &TileHashResolve(TileHashKernel::Auto);
+    std::vector<uint64_t> mPrevHash;
+    std::vector<uint64_t> mCurrHash;
+    int mWordsPerRow = 0;                // bitset words per tile row
+    std::vector<uint64_t> mPendingDirty; // pending dirty bitset
+    std::vector<uint64_t> mChanged;      // changed bitset (compare mismatch, caller mask, or hash diff)
+    bool mHashDiffStale = true;          // Hash mode: mChanged does not reflect the current hashes yet
+    std::vector<uint64_t> mRowBits;      // rect building scratch: one tile row of dirty words
+    std::vector<uint64_t> mPrevRowHash; // per-tile-row band fingerprints (Hash mode)
+    std::vector<uint64_t> mCurrRowHash;
+    std::vector<uint8_t> mChangedRow; // per-tile-row "has changed tile" flags (Compare/Mask mode)
+    std::vector<uint8_t> mPendingRow; // per-tile-row "has pending tile" flags
+    std::vector<uint16_t> mActivity;  // per tile: dirty flag of each of the last 16 flushes (bit 0 = latest)
+    std::vector<uint64_t> mHot;       // hot bitset (from mActivity)
+    std::vector<uint64_t> mHeld;      // dirty hot/held-region tiles left out of the last rect building
+    std::vector<uint64_t> mDropped;   // dirty excluded tiles left out of the last rect building
+    std::vector<uint64_t> mExcluded;  // region mask: never reported
+    std::vector<uint64_t> mHoldMask;  // region mask: held this flush
+    int mHotMinFlushes = 0;
+    int mHotTiles = 0;
+    int mHeldTiles = 0;
+    int mDroppedTiles = 0;
+    int mExcludedTiles = 0;
+    int mHoldMaskTiles = 0;
+    int mSparseStrideX = 4;
+    int mSparseStrideY = 4;
+    uint32_t mSparsePhase = 0;
+    double mSparseCoverage = 0.0;
+    int mFocusX0 = 0, mFocusY0 = 0, mFocusX1 = -1, mFocusY1 = -1; // focus tile bounds (inclusive; empty if x1 < x0)
+    TileDiffMode mDiffMode = TileDiffMode::Hash;
+    RectCoalescer mCoalescer;
+    std::atomic<uint64_t> mBytesTouched{0};
+    std::atomic<uint64_t> mTilesVisited{0};
+};
+
+#endif /* TileDiffEngine_h */
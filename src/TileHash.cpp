@@ -0,0 +1,462 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "TileHash.h"
+
+#include <cstring>
+#include <strings.h>
+
+#if defined(__aarch64__) || defined(__ARM_FEATURE_CRC32)
+#define TV_HAS_ARM_CRC32 1
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define TV_HAS_NEON 1
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define TV_HAS_X86_SIMD 1
+#define TV_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TV_TARGET_AVX2 __attribute__((target("avx2,sse4.2")))
+#endif
+
+// MARK: - Shared Helpers
+
+// Lane seeds and mixing prime for the vector kernels (xxHash32 primes).
+static const uint32_t kMixPrime = 0x9E3779B1u;
+alignas(32) static const uint32_t kLaneSeeds[16] = {
+    0x9E3779B1u, 0x85EBCA77u, 0xC2B2AE3Du, 0x27D4EB2Fu, 0x165667B1u, 0xD3A2646Cu, 0xFD7046C5u, 0xB55A4F09u,
+    0x7FEB352Du, 0x846CA68Bu, 0x68E31DA4u, 0xB5297A4Du, 0x1B873593u, 0xCC9E2D51u, 0xE6546B64u, 0x5BD1E995u,
+};
+
+static inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// Fold a segment digest into the running tile hash, then mix in the bytes the vector loop left over.
+// The digest only depends on segment data: seeding the lanes from h would let h cancel out when lanes are folded.
+static inline uint64_t tail_mix(uint64_t h, uint64_t digest, const uint8_t *p, size_t n) {
+    const uint64_t prime = 1099511628211ULL;
+    h = (rotl64(h, 29) ^ digest) * prime;
+    while (n >= 4) {
+        uint32_t w;
+        memcpy(&w, p, sizeof(w));
+        h = (h ^ (uint64_t)w) * prime;
+        p += 4;
+        n -= 4;
+    }
+    while (n) {
+        h = (h ^ (uint64_t)*p) * prime;
+        p++;
+        n--;
+    }
+    return h;
+}
+
+// MARK: - Scalar
+
+#if TV_HAS_ARM_CRC32
+static inline uint64_t crc32_update(uint64_t h, const uint8_t *data, size_t len) {
+    uint32_t c = (uint32_t)h;
+    const uint8_t *p = data;
+    size_t n = len;
+    // Process 8-byte chunks
+    while (n >= 8) {
+        uint64_t v;
+        // Unaligned load is acceptable on ARM64; use memcpy to be safe for strict aliasing.
+        memcpy(&v, p, sizeof(v));
+        c = __builtin_arm_crc32d(c, v);
+        p += 8;
+        n -= 8;
+    }
+    if (n >= 4) {
+        uint32_t v32;
+        memcpy(&v32, p, sizeof(v32));
+        c = __builtin_arm_crc32w(c, v32);
+        p += 4;
+        n -= 4;
+    }
+    if (n >= 2) {
+        uint16_t v16;
+        memcpy(&v16, p, sizeof(v16));
+        c = __builtin_arm_crc32h(c, v16);
+        p += 2;
+        n -= 2;
+    }
+    if (n) {
+        c = __builtin_arm_crc32b(c, *p);
+    }
+    return (uint64_t)c;
+}
+#else
+static inline uint64_t fnv1a_basis(void) { return 1469598103934665603ULL; }
+static inline uint64_t fnv1a_update(uint64_t h, const uint8_t *data, size_t len) {
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (uint64_t)data[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+#endif
+
+// Generic hash wrappers: prefer hardware CRC32 when available, else fallback to FNV-1a.
+static inline uint64_t hash_basis(void) {
+#if TV_HAS_ARM_CRC32
+    return 0u; // CRC32 initial accumulator
+#else
+    return fnv1a_basis();
+#endif
+}
+
+static uint64_t hash_update(uint64_t h, const uint8_t *data, size_t len) {
+#if TV_HAS_ARM_CRC32
+    return crc32_update(h, data, len);
+#else
+    // If CRC32 not supported at compile time, fallback to FNV-1a
+    return fnv1a_update(h, data, len);
+#endif
+}
+
+static void scalar_row(uint64_t *hashes, const uint8_t *row, int tiles, size_t tileBytes, size_t lastTileBytes) {
+    for (int tx = 0; tx < tiles; ++tx) {
+        size_t len = (tx == tiles - 1) ? lastTileBytes : tileBytes;
+        hashes[tx] = hash_update(hashes[tx], row + (size_t)tx * tileBytes, len);
+    }
+}
+
+// MARK: - CRC32 (ARM, 4 lanes)
+
+#if TV_HAS_ARM_CRC32
+// Four independent CRC chains hide the crc32 instruction latency. Each chain is
+// bit-identical to crc32_update() over the same segment, so hashes match Scalar.
+static void crc32x4_row(uint64_t *hashes, const uint8_t *row, int tiles, size_t tileBytes, size_t lastTileBytes) {
+    int fullTiles = (lastTileBytes == tileBytes) ? tiles : tiles - 1;
+    int tx = 0;
+    for (; tx + 4 <= fullTiles; tx += 4) {
+        const uint8_t *p0 = row + (size_t)tx * tileBytes;
+        const uint8_t *p1 = p0 + tileBytes;
+        const uint8_t *p2 = p1 + tileBytes;
+        const uint8_t *p3 = p2 + tileBytes;
+        uint32_t c0 = (uint32_t)hashes[tx + 0];
+        uint32_t c1 = (uint32_t)hashes[tx + 1];
+        uint32_t c2 = (uint32_t)hashes[tx + 2];
+        uint32_t c3 = (uint32_t)hashes[tx + 3];
+        size_t i = 0;
+        for (; i + 8 <= tileBytes; i += 8) {
+            uint64_t v0, v1, v2, v3;
+            memcpy(&v0, p0 + i, 8);
+            memcpy(&v1, p1 + i, 8);
+            memcpy(&v2, p2 + i, 8);
+            memcpy(&v3, p3 + i, 8);
+            c0 = __builtin_arm_crc32d(c0, v0);
+            c1 = __builtin_arm_crc32d(c1, v1);
+            c2 = __builtin_arm_crc32d(c2, v2);
+            c3 = __builtin_arm_crc32d(c3, v3);
+        }
+        hashes[tx + 0] = crc32_update(c0, p0 + i, tileBytes - i);
+        hashes[tx + 1] = crc32_update(c1, p1 + i, tileBytes - i);
+        hashes[tx + 2] = crc32_update(c2, p2 + i, tileBytes - i);
+        hashes[tx + 3] = crc32_update(c3, p3 + i, tileBytes - i);
+    }
+    for (; tx < tiles; ++tx) {
+        size_t len = (tx == tiles - 1) ? lastTileBytes : tileBytes;
+        hashes[tx] = crc32_update(hashes[tx], row + (size_t)tx * tileBytes, len);
+    }
+}
+#endif
+
+// MARK: - NEON (arm64)
+
+#if TV_HAS_NEON
+static inline uint32x4_t neon_mix(uint32x4_t acc, const uint8_t *p, uint32x4_t prime) {
+    uint32x4_t x = veorq_u32(acc, vreinterpretq_u32_u8(vld1q_u8(p)));
+    x = vsriq_n_u32(vshlq_n_u32(x, 13), x, 19); // rotl 13
+    return vmulq_u32(x, prime);
+}
+
+static inline uint64_t neon_segment(uint64_t h, const uint8_t *p, size_t n) {
+    const uint32x4_t prime = vdupq_n_u32(kMixPrime);
+    uint32x4_t a0 = vld1q_u32(kLaneSeeds);
+    uint32x4_t a1 = vld1q_u32(kLaneSeeds + 4);
+    while (n >= 32) {
+        a0 = neon_mix(a0, p, prime);
+        a1 = neon_mix(a1, p + 16, prime);
+        p += 32;
+        n -= 32;
+    }
+    if (n >= 16) {
+        a0 = neon_mix(a0, p, prime);
+        p += 16;
+        n -= 16;
+    }
+    uint32x4_t a = veorq_u32(a0, vsriq_n_u32(vshlq_n_u32(a1, 7), a1, 25));
+    uint64x2_t f = vreinterpretq_u64_u32(a);
+    uint64_t digest = vgetq_lane_u64(f, 0) ^ rotl64(vgetq_lane_u64(f, 1), 32);
+    return tail_mix(h, digest, p, n);
+}
+
+static void neon_row(uint64_t *hashes, const uint8_t *row, int tiles, size_t tileBytes, size_t lastTileBytes) {
+    for (int tx = 0; tx < tiles; ++tx) {
+        size_t len = (tx == tiles - 1) ? lastTileBytes : tileBytes;
+        hashes[tx] = neon_segment(hashes[tx], row + (size_t)tx * tileBytes, len);
+    }
+}
+#endif
+
+// MARK: - SSE4.2 / AVX2 (x86-64)
+
+#if TV_HAS_X86_SIMD
+TV_TARGET_SSE42 static inline uint64_t sse42_crc_update(uint64_t h, const uint8_t *p, size_t n) {
+    uint64_t c = (uint32_t)h;
+    while (n >= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        n -= 8;
+    }
+    uint32_t c32 = (uint32_t)c;
+    if (n >= 4) {
+        uint32_t v32;
+        memcpy(&v32, p, sizeof(v32));
+        c32 = _mm_crc32_u32(c32, v32);
+        p += 4;
+        n -= 4;
+    }
+    if (n >= 2) {
+        uint16_t v16;
+        memcpy(&v16, p, sizeof(v16));
+        c32 = _mm_crc32_u16(c32, v16);
+        p += 2;
+        n -= 2;
+    }
+    if (n) {
+        c32 = _mm_crc32_u8(c32, *p);
+    }
+    return (uint64_t)c32;
+}
+
+TV_TARGET_SSE42 static uint64_t sse42_update(uint64_t h, const uint8_t *data, size_t len) {
+    return sse42_crc_update(h, data, len);
+}
+
+// Four interleaved CRC32C chains, same structure as crc32x4_row().
+TV_TARGET_SSE42 static void sse42_row(uint64_t *hashes, const uint8_t *row, int tiles, size_t tileBytes,
+                                      size_t lastTileBytes) {
+    int fullTiles = (lastTileBytes == tileBytes) ? tiles : tiles - 1;
+    int tx = 0;
+    for (; tx + 4 <= fullTiles; tx += 4) {
+        const uint8_t *p0 = row + (size_t)tx * tileBytes;
+        const uint8_t *p1 = p0 + tileBytes;
+        const uint8_t *p2 = p1 + tileBytes;
+        const uint8_t *p3 = p2 + tileBytes;
+        uint64_t c0 = (uint32_t)hashes[tx + 0];
+        uint64_t c1 = (uint32_t)hashes[tx + 1];
+        uint64_t c2 = (uint32_t)hashes[tx + 2];
+        uint64_t c3 = (uint32_t)hashes[tx + 3];
+        size_t i = 0;
+        for (; i + 8 <= tileBytes; i += 8) {
+            uint64_t v0, v1, v2, v3;
+            memcpy(&v0, p0 + i, 8);
+            memcpy(&v1, p1 + i, 8);
+            memcpy(&v2, p2 + i, 8);
+            memcpy(&v3, p3 + i, 8);
+            c0 = _mm_crc32_u64(c0, v0);
+            c1 = _mm_crc32_u64(c1, v1);
+            c2 = _mm_crc32_u64(c2, v2);
+            c3 = _mm_crc32_u64(c3, v3);
+        }
+        hashes[tx + 0] = sse42_crc_update(c0, p0 + i, tileBytes - i);
+        hashes[tx + 1] = sse42_crc_update(c1, p1 + i, tileBytes - i);
+        hashes[tx + 2] = sse42_crc_update(c2, p2 + i, tileBytes - i);
+        hashes[tx + 3] = sse42_crc_update(c3, p3 + i, tileBytes - i);
+    }
+    for (; tx < tiles; ++tx) {
+        size_t len = (tx == tiles - 1) ? lastTileBytes : tileBytes;
+        hashes[tx] = sse42_crc_update(hashes[tx], row + (size_t)tx * tileBytes, len);
+    }
+}
+
+TV_TARGET_AVX2 static inline __m256i avx2_mix(__m256i acc, const uint8_t *p, __m256i prime) {
+    __m256i x = _mm256_xor_si256(acc, _mm256_loadu_si256((const __m256i *)p));
+    x = _mm256_or_si256(_mm256_slli_epi32(x, 13), _mm256_srli_epi32(x, 19)); // rotl 13
+    return _mm256_mullo_epi32(x, prime);
+}
+
+TV_TARGET_AVX2 static inline uint64_t avx2_segment(uint64_t h, const uint8_t *p, size_t n) {
+    const __m256i prime = _mm256_set1_epi32((int)kMixPrime);
+    __m256i a0 = _mm256_load_si256((const __m256i *)kLaneSeeds);
+    __m256i a1 = _mm256_load_si256((const __m256i *)(kLaneSeeds + 8));
+    while (n >= 64) {
+        a0 = avx2_mix(a0, p, prime);
+        a1 = avx2_mix(a1, p + 32, prime);
+        p += 64;
+        n -= 64;
+    }
+    if (n >= 32) {
+        a0 = avx2_mix(a0, p, prime);
+        p += 32;
+        n -= 32;
+    }
+    __m256i a = _mm256_xor_si256(a0, _mm256_or_si256(_mm256_slli_epi32(a1, 7), _mm256_srli_epi32(a1, 25)));
+    __m128i f = _mm_xor_si128(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+    uint64_t digest = (uint64_t)_mm_cvtsi128_si64(f) ^ rotl64((uint64_t)_mm_extract_epi64(f, 1), 32);
+    return tail_mix(h, digest, p, n);
+}
+
+TV_TARGET_AVX2 static void avx2_row(uint64_t *hashes, const uint8_t *row, int tiles, size_t tileBytes,
+                                    size_t lastTileBytes) {
+    for (int tx = 0; tx < tiles; ++tx) {
+        size_t len = (tx == tiles - 1) ? lastTileBytes : tileBytes;
+        hashes[tx] = avx2_segment(hashes[tx], row + (size_t)tx * tileBytes, len);
+    }
+}
+
+static bool x86_supports(TileHashKernel kernel) {
+    static int sSSE42 = -1;
+    static int sAVX2 = -1;
+    if (sSSE42 < 0) {
+        __builtin_cpu_init();
+        sSSE42 = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+        sAVX2 = (sSSE42 && __builtin_cpu_supports("avx2")) ? 1 : 0;
+    }
+    if (kernel == TileHashKernel::SSE42)
+        return sSSE42 == 1;
+    if (kernel == TileHashKernel::AVX2)
+        return sAVX2 == 1;
+    return false;
+}
+#endif
+
+// MARK: - Dispatch
+
+static const TileHashOps kScalarOps = {TileHashKernel::Scalar, "scalar", hash_basis(), scalar_row, hash_update};
+#if TV_HAS_ARM_CRC32
+static const TileHashOps kCRC32Ops = {TileHashKernel::CRC32, "crc32", 0, crc32x4_row, hash_update};
+#endif
+#if TV_HAS_NEON
+static const TileHashOps kNEONOps = {TileHashKernel::NEON, "neon", 0, neon_row, hash_update};
+#endif
+#if TV_HAS_X86_SIMD
+static const TileHashOps kSSE42Ops = {TileHashKernel::SSE42, "sse42", 0, sse42_row, sse42_update};
+static const TileHashOps kAVX2Ops = {TileHashKernel::AVX2, "avx2", 0, avx2_row, sse42_update};
+#endif
+
+bool TileHashKernelSupported(TileHashKernel kernel) {
+    switch (kernel) {
+    case TileHashKernel::Auto:
+    case TileHashKernel::Scalar:
+        return true;
+    case TileHashKernel::CRC32:
+#if TV_HAS_ARM_CRC32
+        return true;
+#else
+        return false;
+#endif
+    case TileHashKernel::NEON:
+#if TV_HAS_NEON
+        return true;
+#else
+        return false;
+#endif
+    case TileHashKernel::SSE42:
+    case TileHashKernel::AVX2:
+#if TV_HAS_X86_SIMD
+        return x86_supports(kernel);
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+const TileHashOps &TileHashResolve(TileHashKernel kernel) {
+    if (kernel != TileHashKernel::Auto && !TileHashKernelSupported(kernel))
+        kernel = TileHashKernel::Auto;
+
+    switch (kernel) {
+#if TV_HAS_ARM_CRC32
+    case TileHashKernel::CRC32:
+        return kCRC32Ops;
+#endif
+#if TV_HAS_NEON
+    case TileHashKernel::NEON:
+        return kNEONOps;
+#endif
+#if TV_HAS_X86_SIMD
+    case TileHashKernel::SSE42:
+        return kSSE42Ops;
+    case TileHashKernel::AVX2:
+        return kAVX2Ops;
+#endif
+    case TileHashKernel::Auto:
+        // Prefer interleaved hardware CRC (on ARM it yields the same hash values as Scalar). With 32px tiles
+        // the row segments are too short for the AVX2 lane fold to pay off, so it stays opt-in.
+#if TV_HAS_ARM_CRC32
+        return kCRC32Ops;
+#elif TV_HAS_X86_SIMD
+        if (x86_supports(TileHashKernel::SSE42))
+            return kSSE42Ops;
+        if (x86_supports(TileHashKernel::AVX2))
+            return kAVX2Ops;
+        return kScalarOps;
+#else
+        return kScalarOps;
+#endif
+    default:
+        return kScalarOps;
+    }
+}
+
+bool TileHashKernelFromName(const char *name, TileHashKernel *outKernel) {
+    static const struct {
+        const char *name;
+        TileHashKernel kernel;
+    } kNames[] = {
+        {"auto", TileHashKernel::Auto}, {"scalar", TileHashKernel::Scalar}, {"crc32", TileHashKernel::CRC32},
+        {"neon", TileHashKernel::NEON}, {"sse42", TileHashKernel::SSE42},   {"avx2", TileHashKernel::AVX2},
+    };
+    if (!name)
+        return false;
+    for (const auto &entry : kNames) {
+        if (strcasecmp(name, entry.name) == 0) {
+            if (outKernel)
+                *outKernel = entry.kernel;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *TileHashKernelName(TileHashKernel kernel) {
+    switch (kernel) {
+    case TileHashKernel::Auto:
+        return "auto";
+    case TileHashKernel::Scalar:
+        return "scalar";
+    case TileHashKernel::CRC32:
+        return "crc32";
+    case TileHashKernel::NEON:
+        return "neon";
+    case TileHashKernel::SSE42:
+        return "sse42";
+    case TileHashKernel::AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
@@ -0,0 +1,74 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TileHash_h
+#define TileHash_h
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ Tile hashing kernels used by TileDiffEngine.
+
+ Every kernel hashes one framebuffer row across a run of adjacent tiles, folding
+ each tile's row segment into that tile's running 64-bit hash. Hash values are
+ only comparable between frames hashed with the same kernel.
+
+ - Scalar: serial CRC32 (ARM) or byte-wise FNV-1a, one tile at a time.
+ - CRC32:  4 interleaved hardware CRC32 chains (4 tiles in flight), ARM only.
+ - NEON:   vector multiply/rotate mixing, 2 x 4 lanes of 32 bits per tile, arm64 only.
+ - SSE42:  4 interleaved CRC32C chains via SSE4.2 `crc32`, x86-64 only.
+ - AVX2:   vector multiply/rotate mixing, 2 x 8 lanes of 32 bits per tile, x86-64 only.
+
+ Kernel availability is resolved at runtime (CPU feature checks on x86-64).
+ */
+enum class TileHashKernel {
+    Auto = 0,
+    Scalar,
+    CRC32,
+    NEON,
+    SSE42,
+    AVX2,
+};
+
+/** Fold one row into `tiles` tile hashes. All tiles are tileBytes wide except the last (lastTileBytes). */
+typedef void (*TileHashRowFn)(uint64_t *hashes, const uint8_t *row, int tiles, size_t tileBytes, size_t lastTileBytes);
+
+/** Fold an arbitrary byte range into a single hash (used by sparse sampling). */
+typedef uint64_t (*TileHashUpdateFn)(uint64_t h, const uint8_t *data, size_t len);
+
+typedef struct {
+    TileHashKernel kernel;
+    const char *name;
+    uint64_t basis;
+    TileHashRowFn hashRow;
+    TileHashUpdateFn update;
+} TileHashOps;
+
+/** Whether the kernel can run on this CPU. Auto is always supported. */
+bool TileHashKernelSupported(TileHashKernel kernel);
+
+/** Resolve a kernel to its implementation. Auto (or an unsupported kernel) resolves to the best available one. */
+const TileHashOps &TileHashResolve(TileHashKernel kernel);
+
+/** Parse a kernel name (auto|scalar|crc32|neon|sse42|avx2, case-insensitive). Returns false if unknown. */
+bool TileHashKernelFromName(const char *name, TileHashKernel *outKernel);
+
+/** Canonical kernel name. */
+const char *TileHashKernelName(TileHashKernel kernel);
+
+#endif /* TileHash_h */
@@ -0,0 +1,80 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "TileSizeTuner.h"
+
+// MARK: - Policy
+
+static const double kSmoothing = 0.125;         // EMA weight of the newest flush
+static const int kMinSamples = 8;               // flushes observed before any decision
+static const int kStreakToRetile = 8;           // consecutive agreeing flushes required
+static const double kFinerMaxFill = 0.25;       // changed pixels / dirty tile area below this -> finer
+static const double kFinerMaxChanged = 5.0;     // ...but only for small updates (% of frame)
+static const double kCoarserMinChanged = 40.0;  // large updates (% of frame) -> coarser
+static const double kCoarserRectShare = 0.5;    // or rect count above this share of the limit -> coarser
+
+void TileSizeTuner::configure(int minTileSize, int maxTileSize, int maxRects) {
+    mMinTile = minTileSize;
+    mMaxTile = maxTileSize < minTileSize ? minTileSize : maxTileSize;
+    mMaxRects = maxRects > 0 ? maxRects : 1;
+    reset();
+}
+
+void TileSizeTuner::reset() {
+    mSamples = 0;
+    mStreak = 0;
+    mFill = 1.0;
+    mRects = 0.0;
+    mChangedPct = 0.0;
+}
+
+int TileSizeTuner::observe(int tileSize, int rectCount, uint64_t tileArea, uint64_t pixelArea, int changedPct) {
+    if (tileArea == 0)
+        return tileSize;
+
+    double fill = (double)pixelArea / (double)tileArea;
+    if (fill > 1.0)
+        fill = 1.0;
+    if (mSamples == 0) {
+        mFill = fill;
+        mRects = rectCount;
+        mChangedPct = changedPct;
+    } else {
+        mFill += (fill - mFill) * kSmoothing;
+        mRects += ((double)rectCount - mRects) * kSmoothing;
+        mChangedPct += ((double)changedPct - mChangedPct) * kSmoothing;
+    }
+    if (++mSamples < kMinSamples)
+        return tileSize;
+
+    int direction = 0;
+    if (mChangedPct >= kCoarserMinChanged || mRects >= kCoarserRectShare * (double)mMaxRects)
+        direction = tileSize * 2 <= mMaxTile ? 1 : 0;
+    else if (mFill < kFinerMaxFill && mChangedPct < kFinerMaxChanged)
+        direction = tileSize / 2 >= mMinTile ? -1 : 0;
+
+    if (direction == 0 || (mStreak != 0 && (mStreak > 0) != (direction > 0))) {
+        mStreak = direction;
+        return tileSize;
+    }
+    mStreak += direction;
+    if (mStreak < kStreakToRetile && mStreak > -kStreakToRetile)
+        return tileSize;
+
+    reset();
+    return direction > 0 ? tileSize * 2 : tileSize / 2;
+}
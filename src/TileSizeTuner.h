@@ -0,0 +1,68 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TileSizeTuner_h
+#define TileSizeTuner_h
+
+#include <cstdint>
+
+/**
+ TileSizeTuner
+ ----------------
+ Picks the dirty-detection tile size from observed change patterns (-t auto).
+
+ Fed once per flush with the dirty area at tile granularity, the area that
+ actually changed (after rect refinement), the rect count and the changed
+ percentage. Smoothed statistics drive the choice:
+ - Low fill (changed pixels cover a small part of the dirty tiles) with small
+   updates, e.g. text editing: halve the tile size.
+ - Large updates or rect counts near the limit, e.g. full-screen animation:
+   double the tile size.
+
+ A decision must hold for several flushes in a row, and the statistics restart
+ after every change, so the size does not oscillate. The caller applies the
+ suggestion at a safe point (no pending dirty tiles).
+ */
+class TileSizeTuner {
+  public:
+    TileSizeTuner() = default;
+
+    /** Tile size range (powers of two between them) and the rect limit used by the caller. */
+    void configure(int minTileSize, int maxTileSize, int maxRects);
+
+    /** Forget all statistics (after a retile, resize or rotation). */
+    void reset();
+
+    /** Observe one flush made with tileSize. Returns the suggested tile size (tileSize if unchanged). */
+    int observe(int tileSize, int rectCount, uint64_t tileArea, uint64_t pixelArea, int changedPct);
+
+    double fill() const { return mFill; }
+    double rects() const { return mRects; }
+    double changedPct() const { return mChangedPct; }
+
+  private:
+    int mMinTile = 16;
+    int mMaxTile = 64;
+    int mMaxRects = 256;
+    int mSamples = 0;
+    int mStreak = 0; // consecutive flushes agreeing on the same direction (+ coarser, - finer)
+    double mFill = 1.0;
+    double mRects = 0.0;
+    double mChangedPct = 0.0;
+};
+
+#endif /* TileSizeTuner_h */
@@ -0,0 +1,211 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#if defined(__APPLE__)
+#include <pthread.h>
+#include <pthread/qos.h>
+#endif
+
+struct WorkerPool::Batch {
+    ChunkFn fn;
+    std::atomic<int> remaining{0};
+};
+
+static const int kSpinRounds = 64; // idle polls (with yield) before a worker blocks
+
+// MARK: - Lifecycle
+
+WorkerPool::WorkerPool(int workers) {
+    if (workers <= 0) {
+        int cpus = (int)std::thread::hardware_concurrency();
+        workers = std::max(1, cpus - 1);
+    }
+    mLanes.reserve((size_t)workers + 1);
+    for (int i = 0; i <= workers; ++i)
+        mLanes.push_back(std::make_unique<Lane>());
+    mStatsSince = std::chrono::steady_clock::now();
+    mThreads.reserve((size_t)workers);
+    for (int i = 1; i <= workers; ++i)
+        mThreads.emplace_back([this, i] { workerMain(i); });
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mWakeMutex);
+        mStop = true;
+    }
+    mWakeCv.notify_all();
+    for (auto &t : mThreads)
+        t.join();
+}
+
+// MARK: - Batches
+
+WorkerPool::BatchRef WorkerPool::submit(int chunks, ChunkFn fn) {
+    auto batch = std::make_shared<Batch>();
+    batch->fn = std::move(fn);
+    if (chunks <= 0)
+        return batch;
+    batch->remaining.store(chunks, std::memory_order_relaxed);
+
+    // Contiguous blocks per lane: lane l gets chunks [l * chunks / lanes, (l + 1) * chunks / lanes)
+    const int lanes = laneCount();
+    for (int l = 0; l < lanes; ++l) {
+        int begin = (int)((int64_t)l * chunks / lanes);
+        int end = (int)((int64_t)(l + 1) * chunks / lanes);
+        if (begin == end)
+            continue;
+        Lane &lane = *mLanes[(size_t)l];
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        for (int c = begin; c < end; ++c)
+            lane.queue.push_back(Task{batch, c});
+    }
+    {
+        std::lock_guard<std::mutex> lock(mWakeMutex);
+        mQueued.fetch_add(chunks, std::memory_order_release);
+    }
+    mWakeCv.notify_all();
+    return batch;
+}
+
+void WorkerPool::wait(const BatchRef &batch) {
+    if (!batch)
+        return;
+    Task task;
+    while (!done(batch)) {
+        if (popOwn(0, task) || steal(0, task)) {
+            run(0, task);
+            continue;
+        }
+        // Nothing left to help with: the remaining chunks are running on workers
+        std::unique_lock<std::mutex> lock(mDoneMutex);
+        mDoneCv.wait(lock, [&] { return done(batch); });
+    }
+}
+
+void WorkerPool::parallelFor(int chunks, ChunkFn fn) {
+    if (chunks <= 0)
+        return;
+    if (chunks == 1 || mThreads.empty()) {
+        for (int c = 0; c < chunks; ++c)
+            fn(c);
+        return;
+    }
+    wait(submit(chunks, std::move(fn)));
+}
+
+bool WorkerPool::done(const BatchRef &batch) { return !batch || batch->remaining.load(std::memory_order_acquire) <= 0; }
+
+// MARK: - Queues
+
+bool WorkerPool::popOwn(int lane, Task &task) {
+    Lane &own = *mLanes[(size_t)lane];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.queue.empty())
+        return false;
+    task = std::move(own.queue.front());
+    own.queue.pop_front();
+    mQueued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool WorkerPool::steal(int lane, Task &task) {
+    const int lanes = laneCount();
+    for (int i = 1; i < lanes; ++i) {
+        Lane &victim = *mLanes[(size_t)((lane + i) % lanes)];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.queue.empty())
+            continue;
+        task = std::move(victim.queue.back());
+        victim.queue.pop_back();
+        mQueued.fetch_sub(1, std::memory_order_relaxed);
+        mLanes[(size_t)lane]->steals.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void WorkerPool::run(int lane, Task &task) {
+    auto t0 = std::chrono::steady_clock::now();
+    task.batch->fn(task.chunk);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+
+    Lane &stats = *mLanes[(size_t)lane];
+    stats.busyNs.fetch_add((uint64_t)ns, std::memory_order_relaxed);
+    stats.chunks.fetch_add(1, std::memory_order_relaxed);
+
+    if (task.batch->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(mDoneMutex);
+        mDoneCv.notify_all();
+    }
+    task.batch.reset();
+}
+
+// MARK: - Workers
+
+void WorkerPool::workerMain(int lane) {
+#if defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+    char name[32];
+    snprintf(name, sizeof(name), "tvnc.worker.%d", lane);
+    pthread_setname_np(name);
+#endif
+
+    Task task;
+    int idle = 0;
+    for (;;) {
+        if (popOwn(lane, task) || steal(lane, task)) {
+            run(lane, task);
+            idle = 0;
+            continue;
+        }
+        if (++idle < kSpinRounds) {
+            std::this_thread::yield();
+            continue;
+        }
+        idle = 0;
+        std::unique_lock<std::mutex> lock(mWakeMutex);
+        mWakeCv.wait(lock, [&] { return mStop || mQueued.load(std::memory_order_acquire) > 0; });
+        if (mStop && mQueued.load(std::memory_order_acquire) <= 0)
+            return;
+    }
+}
+
+// MARK: - Stats
+
+std::vector<WorkerPool::LaneStats> WorkerPool::takeStats() {
+    auto now = std::chrono::steady_clock::now();
+    double wallNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(now - mStatsSince).count();
+    mStatsSince = now;
+
+    std::vector<LaneStats> out;
+    out.reserve(mLanes.size());
+    for (auto &lane : mLanes) {
+        uint64_t busy = lane->busyNs.exchange(0, std::memory_order_relaxed);
+        LaneStats s;
+        s.utilization = wallNs > 0.0 ? std::min(1.0, (double)busy / wallNs) : 0.0;
+        s.chunks = lane->chunks.exchange(0, std::memory_order_relaxed);
+        s.steals = lane->steals.exchange(0, std::memory_order_relaxed);
+        out.push_back(s);
+    }
+    return out;
+}
@@ -0,0 +1,134 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef WorkerPool_h
+#define WorkerPool_h
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ WorkerPool
+ ----------------
+ Long-lived worker threads for the frame pipeline (hashing, compare, copy,
+ rotation, rect refinement), replacing a dispatch group per stage and frame.
+
+ Scheduling:
+ - A batch is a number of chunks (typically one tile row each) run by one
+   function. Chunks are split into contiguous blocks, one per lane; the calling
+   thread is lane 0 and helps while it waits.
+ - The split is deterministic, so a lane keeps seeing the same part of the
+   frame from one frame to the next.
+ - Each lane owns a queue: the owner pops from the front, idle lanes steal
+   from the back of the others, so uneven chunks (e.g. rotation of a band next
+   to an unchanged band) even out without a central queue.
+ - submit() returns immediately so independent stages can overlap; wait()
+   blocks until one batch is done.
+
+ Threading:
+ - submit(), wait() and parallelFor() must be called from a single thread
+   (the frame handler). Chunk functions run concurrently and must only touch
+   disjoint data.
+ - Workers run at user-interactive QoS on Apple platforms.
+
+ Stats:
+ - Busy time, chunks and steals per lane; takeStats() returns utilization
+   since the previous call.
+ */
+class WorkerPool {
+  public:
+    typedef std::function<void(int chunk)> ChunkFn;
+
+    struct Batch;
+    typedef std::shared_ptr<Batch> BatchRef;
+
+    typedef struct {
+        double utilization; // busy time / wall time since the previous takeStats()
+        uint64_t chunks;
+        uint64_t steals;
+    } LaneStats;
+
+    /** workers background threads (0 = one per CPU beyond the caller's). */
+    explicit WorkerPool(int workers = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    /** Background threads. */
+    int workerCount() const { return (int)mThreads.size(); }
+
+    /** Lanes taking part in a batch: the workers plus the calling thread. */
+    int laneCount() const { return (int)mLanes.size(); }
+
+    /** Run fn(0..chunks-1) and return when all chunks are done; the caller runs chunks too. */
+    void parallelFor(int chunks, ChunkFn fn);
+
+    /** Queue fn(0..chunks-1) and return immediately. The batch must be waited before its data goes away. */
+    BatchRef submit(int chunks, ChunkFn fn);
+
+    /** Help with queued chunks until the batch is done. */
+    void wait(const BatchRef &batch);
+
+    /** Whether every chunk of the batch has run. */
+    static bool done(const BatchRef &batch);
+
+    /** Per-lane statistics since the previous call (lane 0 is the calling thread), then reset them. */
+    std::vector<LaneStats> takeStats();
+
+  private:
+    struct Task {
+        BatchRef batch;
+        int chunk;
+    };
+
+    struct Lane {
+        std::mutex mutex;
+        std::deque<Task> queue;
+        std::atomic<uint64_t> busyNs{0};
+        std::atomic<uint64_t> chunks{0};
+        std::atomic<uint64_t> steals{0};
+    };
+
+    void workerMain(int lane);
+    bool popOwn(int lane, Task &task);
+    bool steal(int lane, Task &task);
+    void run(int lane, Task &task);
+
+    std::vector<std::unique_ptr<Lane>> mLanes;
+    std::vector<std::thread> mThreads;
+    std::atomic<int> mQueued{0};
+
+    std::mutex mWakeMutex;
+    std::condition_variable mWakeCv;
+    bool mStop = false;
+
+    std::mutex mDoneMutex;
+    std::condition_variable mDoneCv;
+
+    std::chrono::steady_clock::time_point mStatsSince;
+};
+
+#endif /* WorkerPool_h */
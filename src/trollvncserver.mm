@@ -22,12 +22,14 @@
 #import <Accelerate/Accelerate.h>
 #import <Foundation/Foundation.h>
 
+#import <algorithm>
 #import <arpa/inet.h>
 #import <atomic>
 #import <climits>
 #import <cstdio>
 #import <cstdlib>
 #import <cstring>
+#import <deque>
 #import <errno.h>
 #import <fcntl.h>
 #import <mach-o/dyld.h>
@@ -35,6 +37,7 @@
 #import <pthread.h>
 #import <rfb/keysym.h>
 #import <rfb/rfb.h>
+#import <rfb/rfbregion.h>
 #import <string>
 #import <sys/socket.h>
 #import <sys/sysctl.h>
@@ -44,12 +47,21 @@
 #import "BulletinManager.h"
 #import "ClipboardManager.h"
 #import "Control.h"
+#import "DamageMapper.h"
+#import "DuplicateTileFinder.h"
 #import "FBSOrientationObserver.h"
+#import "FrameResampler.h"
 #import "IOKitSPI.h"
+#import "IOSurfaceSPI.h"
 #import "Logging.h"
+#import "MotionEstimator.h"
 #import "PSAssistiveTouchSettingsDetail.h"
 #import "STHIDEventGenerator.h"
 #import "ScreenCapturer.h"
+#import "ScrollDetector.h"
+#import "TileDiffEngine.h"
+#import "TileSizeTuner.h"
+#import "WorkerPool.h"
 
 #define LocalizedString(key, comment, bundle, table)                                                                   \
     (NSLocalizedStringFromTableInBundle((key), (table), (bundle), (comment)) ?: (key))
@@ -69,8 +81,18 @@ static BOOL gViewOnly = NO;
 static double gKeepAliveSec = 0.0; // 15..86400
 static BOOL gClipboardEnabled = YES;
 static BOOL gIsDaemonMode = NO; // set when launched with -daemon
+static BOOL gCalibrateMode = NO; // set when launched with -calibrate: calibrate, save and exit
+static BOOL gAutoCalibrate = NO; // -daemon: calibrate at launch until a calibration is saved for this output size
+static NSString *gCalibratedFor = nil; // output size ("WxH") the saved calibration was made for
 
 static double gScale = 1.0; // 0 < scale <= 1.0, 1.0 = no scaling
+// Downscale quality (-S)
+typedef NS_ENUM(NSInteger, TVScaleQuality) {
+    TVScaleQualityFast = 0,     // box filter
+    TVScaleQualityBalanced = 1, // bilinear; box when the scale is an integer divisor
+    TVScaleQualityHigh = 2,     // vImage Lanczos; rotated frames: area averaging in one pass
+};
+static TVScaleQuality gScaleQuality = TVScaleQualityHigh;
 // Preferred frame rate range (0 = unspecified)
 static int gFpsMin = 0;
 static int gFpsPref = 0;
@@ -78,9 +100,36 @@ static int gFpsMax = 0;
 static double gDeferWindowSec = 0.015;      // Coalescing window; 0 disables deferral
 static int gMaxInflightUpdates = 2;         // Max concurrent client encodes; drop frames if >= this
 static int gTileSize = 32;                  // Tile size for dirty detection (pixels)
+static BOOL gTileSizeAdaptive = NO;         // -t auto: retile at runtime from observed change patterns
 static int gFullscreenThresholdPercent = 0; // If changed tiles exceed this %, update full screen
 static int gMaxRectsLimit = 256;            // Max rects before falling back to bbox/fullscreen
-static BOOL gAsyncSwapEnabled = NO;         // Enable non-blocking swap (may cause tearing)
+static BOOL gAsyncSwapEnabled = NO;         // -a / AsyncSwap: deprecated and ignored, only logged
+static BOOL gZeroCopyEnabled = NO;          // Publish captured surfaces as the framebuffer when not transformed
+
+// Dirty detection tuning (advanced)
+static TileHashKernel gHashKernel = TileHashKernel::Auto; // tile hash kernel (auto = best for this CPU)
+static TileDiffMode gDiffMode = TileDiffMode::Hash;       // hash tiles, or compare against the front buffer
+static BOOL gSourceSpaceDirty = NO; // detect damage on the captured source; rotate/scale only damaged regions
+static int gRefineMaxArea = 16384;  // shrink rects up to this many pixels to the exact changed box (0 = off)
+static int gRectHeaderBytes = 64;   // rect coalescing: estimated per-rect wire overhead (header + encoder framing)
+static int gWorkerThreads = 0;      // frame pipeline worker threads (0 = one per CPU beyond the capture thread)
+static BOOL gScrollDetect = YES;    // send scrolled content as CopyRect instead of re-encoding it
+static BOOL gMotionSearch = YES;    // send translated UI regions (sheets, cards, keyboard) as CopyRect
+static BOOL gDedupTiles = YES;      // send dirty tiles already on screen elsewhere as CopyRect (hash diff only)
+static int gHotRegionFps = 0;       // update rate of regions that change every frame (video, spinners); 0 = no limit
+
+// Region masks (-Z): noisy areas (status bar clock, battery, signal bars) kept out of updates or throttled.
+// Regions are given on the portrait capture and mapped to the output for the current orientation and scale.
+typedef struct {
+    DirtyRect src;           // portrait source pixels (statusBar: only h is used, 0 = default height)
+    BOOL statusBar;          // top band of the screen as shown to clients, whatever the orientation
+    double periodSec;        // 0 = excluded; else minimum interval between updates, or slot length (cadence)
+    BOOL cadence;            // update only once per wall-clock slot of periodSec, instead of periodSec apart
+    CFAbsoluteTime lastSent; // last flush that sent pixels of this region
+} TVRegionMask;
+static const int cMaxRegionMasks = 8;
+static TVRegionMask gRegionMasks[cMaxRegionMasks];
+static int gRegionMaskCount = 0;
 
 // Wheel scroll coalescing state (async, non-blocking)
 static double gWheelStepPx = 48.0;        // base pixels per wheel tick (lower = slower)
@@ -96,6 +145,11 @@ static double gWheelDurMin = 0.05;        // duration clamp min
 static double gWheelDurMax = 0.14;        // duration clamp max
 static BOOL gWheelNaturalDir = NO;        // natural scroll direction (invert delta)
 
+// Input-guided focus: where a client last touched or dragged, in framebuffer (output) space.
+// Pointer events already use framebuffer coordinates, so no mapping back from device space is needed.
+static std::atomic<uint32_t> gFocusPoint(0); // x | y << 16
+static std::atomic<double> gFocusTime(0.0);  // CFAbsoluteTime of the last touch or drag (0 = none)
+
 // Modifier mapping scheme: 0 = standard (Alt->Option, Meta/Super->Command), 1 = Alt-as-Command
 static int gModMapScheme = 0;
 static BOOL gAutoAssistEnabled = NO;
@@ -259,16 +313,27 @@ static void printUsageAndExit(const char *prog) {
 
     fprintf(stderr, "Display/Perf:\n");
     fprintf(stderr, "  -s scale   Output scale 0<s<=1 (default: %.2f)\n", gScale);
+    fprintf(stderr, "  -S tier    Downscale quality: fast (box) | balanced (bilinear) | hq (Lanczos; default)\n");
     fprintf(stderr, "  -F spec    Frame rate: fps | min-max | min:pref:max\n");
     fprintf(stderr, "  -d sec     Defer window (0..0.5, default: %.3f)\n", gDeferWindowSec);
     fprintf(stderr, "  -Q n       Max in-flight encodes (0=never drop, default: %d)\n\n", gMaxInflightUpdates);
 
     fprintf(stderr, "Dirty detection:\n");
-    fprintf(stderr, "  -t size    Tile size (8..128, default: %d)\n", gTileSize);
+    fprintf(stderr, "  -t size    Tile size (8..128, or auto to adapt at runtime; default: %d)\n", gTileSize);
     fprintf(stderr, "  -P pct     Fullscreen fallback threshold (0..100; 0=disable dirty detection, default: %d)\n",
             gFullscreenThresholdPercent);
-    fprintf(stderr, "  -R max     Max dirty rects before bbox (default: %d)\n", gMaxRectsLimit);
-    fprintf(stderr, "  -a         Non-blocking swap (may cause tearing)\n\n");
+    fprintf(stderr, "  -R max     Max dirty rects per update (default: %d)\n", gMaxRectsLimit);
+    fprintf(stderr, "  -a         Deprecated, ignored (frames are always published without locking clients)\n");
+    fprintf(stderr, "  -z         Zero-copy: publish unscaled portrait frames straight from the capture\n");
+    fprintf(stderr, "  -calibrate Time tile sizes, hash kernels and worker counts on this device, save the fastest\n");
+    fprintf(stderr,
+            "  -X k=v,.. Dirty tuning keys: hash=auto|scalar|crc32|neon|sse42|avx2, diff=hash|compare,\n"
+            "            space=output|source, refine=<max px area, 0=off>, rectcost=<bytes per rect>,\n"
+            "            workers=<threads, 0=auto>, scroll=on|off, motion=on|off, dedup=on|off,\n"
+            "            hotfps=<fps for constantly changing regions, 0=no limit>\n");
+    fprintf(stderr,
+            "  -Z r=m,.. Region masks: r = statusbar[:h] or x:y:w:h (portrait source px); m = off (never update),\n"
+            "            <n>hz (at most n updates/s) or <n>s (once per n-second slot), e.g. statusbar=60s\n\n");
 
     fprintf(stderr, "Scroll/Input:\n");
     fprintf(stderr, "  -W px      Wheel step in pixels (0=disable, default: %.0f)\n", gWheelStepPx);
@@ -291,7 +356,7 @@ static void printUsageAndExit(const char *prog) {
     fprintf(stderr, "Accessibility:\n");
     fprintf(stderr, "  -O on|off  Observe iOS interface orientation and sync (default: on)\n");
     fprintf(stderr, "  -E on|off  Enable AssistiveTouch auto-activation (default: off)\n");
-    fprintf(stderr, "  -U on|off  Enable server-side cursor X (default: off)\n\n");
+    fprintf(stderr, "  -U on|off  Enable server-side cursor X, locks all clients per frame (default: off)\n\n");
 
     fprintf(stderr, "Notifications:\n");
     fprintf(stderr, "  -i on|off  Single notification when first client connects (default: on)\n");
@@ -391,6 +456,159 @@ static void parseWheelOptions(const char *spec) {
     free(dup);
 }
 
+static const char *scaleQualityName(TVScaleQuality quality) {
+    switch (quality) {
+    case TVScaleQualityFast:
+        return "fast";
+    case TVScaleQualityBalanced:
+        return "balanced";
+    default:
+        return "hq";
+    }
+}
+
+static BOOL parseScaleQuality(const char *spec, TVScaleQuality *outQuality) {
+    if (!spec)
+        return NO;
+    if (strcmp(spec, "fast") == 0)
+        *outQuality = TVScaleQualityFast;
+    else if (strcmp(spec, "balanced") == 0)
+        *outQuality = TVScaleQualityBalanced;
+    else if (strcmp(spec, "hq") == 0)
+        *outQuality = TVScaleQualityHigh;
+    else
+        return NO;
+    return YES;
+}
+
+static void parseDirtyOptions(const char *spec) {
+    if (!spec)
+        return;
+    char *dup = strdup(spec);
+    if (!dup)
+        return;
+    char *saveptr = NULL;
+    for (char *tok = strtok_r(dup, ",", &saveptr); tok; tok = strtok_r(NULL, ",", &saveptr)) {
+        char *eq = strchr(tok, '=');
+        if (!eq)
+            continue;
+        *eq = '\0';
+        const char *key = tok;
+        const char *val = eq + 1;
+        if (strcmp(key, "hash") == 0) {
+            TileHashKernel kernel;
+            if (!TileHashKernelFromName(val, &kernel)) {
+                TVLog(@"Dirty tuning: unknown hash kernel '%s' (ignored)", val);
+            } else if (!TileHashKernelSupported(kernel)) {
+                TVLog(@"Dirty tuning: hash kernel '%s' not supported on this CPU (using auto)", val);
+                gHashKernel = TileHashKernel::Auto;
+            } else {
+                gHashKernel = kernel;
+            }
+            TVLog(@"Dirty tuning: hash=%s", TileHashKernelName(gHashKernel));
+        } else if (strcmp(key, "diff") == 0) {
+            if (strcmp(val, "hash") == 0)
+                gDiffMode = TileDiffMode::Hash;
+            else if (strcmp(val, "compare") == 0)
+                gDiffMode = TileDiffMode::Compare;
+            TVLog(@"Dirty tuning: diff=%s", gDiffMode == TileDiffMode::Compare ? "compare" : "hash");
+        } else if (strcmp(key, "space") == 0) {
+            if (strcmp(val, "output") == 0)
+                gSourceSpaceDirty = NO;
+            else if (strcmp(val, "source") == 0)
+                gSourceSpaceDirty = YES;
+            TVLog(@"Dirty tuning: space=%s", gSourceSpaceDirty ? "source" : "output");
+        } else if (strcmp(key, "refine") == 0) {
+            int area = atoi(val);
+            gRefineMaxArea = area < 0 ? 0 : area;
+            TVLog(@"Dirty tuning: refine=%d", gRefineMaxArea);
+        } else if (strcmp(key, "rectcost") == 0) {
+            int bytes = atoi(val);
+            gRectHeaderBytes = bytes < 0 ? 0 : bytes;
+            TVLog(@"Dirty tuning: rectcost=%d", gRectHeaderBytes);
+        } else if (strcmp(key, "workers") == 0) {
+            int threads = atoi(val);
+            gWorkerThreads = MAX(0, MIN(16, threads));
+            TVLog(@"Dirty tuning: workers=%d", gWorkerThreads);
+        } else if (strcmp(key, "scroll") == 0) {
+            if (strcmp(val, "on") == 0 || strcmp(val, "1") == 0)
+                gScrollDetect = YES;
+            else if (strcmp(val, "off") == 0 || strcmp(val, "0") == 0)
+                gScrollDetect = NO;
+            TVLog(@"Dirty tuning: scroll=%s", gScrollDetect ? "on" : "off");
+        } else if (strcmp(key, "motion") == 0) {
+            if (strcmp(val, "on") == 0 || strcmp(val, "1") == 0)
+                gMotionSearch = YES;
+            else if (strcmp(val, "off") == 0 || strcmp(val, "0") == 0)
+                gMotionSearch = NO;
+            TVLog(@"Dirty tuning: motion=%s", gMotionSearch ? "on" : "off");
+        } else if (strcmp(key, "dedup") == 0) {
+            if (strcmp(val, "on") == 0 || strcmp(val, "1") == 0)
+                gDedupTiles = YES;
+            else if (strcmp(val, "off") == 0 || strcmp(val, "0") == 0)
+                gDedupTiles = NO;
+            TVLog(@"Dirty tuning: dedup=%s", gDedupTiles ? "on" : "off");
+        } else if (strcmp(key, "hotfps") == 0) {
+            int fps = atoi(val);
+            gHotRegionFps = MAX(0, MIN(120, fps));
+            TVLog(@"Dirty tuning: hotfps=%d", gHotRegionFps);
+        }
+    }
+    free(dup);
+}
+
+// Region mask entries: region=mode, comma separated (see -Z). Invalid entries are logged and skipped.
+static void parseRegionOptions(const char *spec) {
+    if (!spec)
+        return;
+    char *dup = strdup(spec);
+    if (!dup)
+        return;
+    gRegionMaskCount = 0;
+    char *saveptr = NULL;
+    for (char *tok = strtok_r(dup, ",", &saveptr); tok; tok = strtok_r(NULL, ",", &saveptr)) {
+        char *eq = strchr(tok, '=');
+        if (!eq)
+            continue;
+        *eq = '\0';
+        const char *key = tok;
+        const char *val = eq + 1;
+        if (gRegionMaskCount >= cMaxRegionMasks) {
+            TVLog(@"Region mask: more than %d regions, '%s' ignored", cMaxRegionMasks, key);
+            continue;
+        }
+
+        TVRegionMask mask = {};
+        int x = 0, y = 0, w = 0, h = 0;
+        if (strcmp(key, "statusbar") == 0 || sscanf(key, "statusbar:%d", &h) == 1) {
+            mask.statusBar = YES;
+            mask.src = DirtyRect{0, 0, 0, MAX(0, h)};
+        } else if (sscanf(key, "%d:%d:%d:%d", &x, &y, &w, &h) == 4 && x >= 0 && y >= 0 && w > 0 && h > 0) {
+            mask.src = DirtyRect{x, y, w, h};
+        } else {
+            TVLog(@"Region mask: invalid region '%s' (ignored)", key);
+            continue;
+        }
+
+        char *end = NULL;
+        double v = strtod(val, &end);
+        if (strcmp(val, "off") == 0) {
+            mask.periodSec = 0.0;
+        } else if (end != val && v > 0.0 && strcasecmp(end, "hz") == 0) {
+            mask.periodSec = 1.0 / v;
+        } else if (end != val && v > 0.0 && strcmp(end, "s") == 0) {
+            mask.periodSec = v;
+            mask.cadence = YES;
+        } else {
+            TVLog(@"Region mask: invalid mode '%s' for '%s' (ignored)", val, key);
+            continue;
+        }
+        gRegionMasks[gRegionMaskCount++] = mask;
+        TVLog(@"Region mask: %s=%s", key, val);
+    }
+    free(dup);
+}
+
 static void parseDaemonOptions(void) {
     NSDictionary *prefs = nil;
 
@@ -461,6 +679,13 @@ static void parseDaemonOptions(void) {
         gScale = v;
     }
 
+    NSString *scaleQuality = [prefs objectForKey:@"ScaleQuality"];
+    if ([scaleQuality isKindOfClass:[NSString class]] && scaleQuality.length > 0 &&
+        !parseScaleQuality(scaleQuality.UTF8String, &gScaleQuality)) {
+        TVLog(@"-daemon: invalid ScaleQuality=%@; using hq", scaleQuality);
+        gScaleQuality = TVScaleQualityHigh;
+    }
+
     NSNumber *deferN = [prefs objectForKey:@"DeferWindowSec"];
     if ([deferN isKindOfClass:[NSNumber class]]) {
         double v = deferN.doubleValue;
@@ -590,6 +815,11 @@ static void parseDaemonOptions(void) {
     NSNumber *asyncSwapN = [prefs objectForKey:@"AsyncSwap"];
     if ([asyncSwapN isKindOfClass:[NSNumber class]])
         gAsyncSwapEnabled = asyncSwapN.boolValue;
+    if (gAsyncSwapEnabled)
+        TVLog(@"AsyncSwap is deprecated and ignored: frames are always published without locking clients");
+    NSNumber *zeroCopyN = [prefs objectForKey:@"ZeroCopy"];
+    if ([zeroCopyN isKindOfClass:[NSNumber class]])
+        gZeroCopyEnabled = zeroCopyN.boolValue;
     NSNumber *keyLogN = [prefs objectForKey:@"KeyLogging"];
     if ([keyLogN isKindOfClass:[NSNumber class]])
         gKeyEventLogging = keyLogN.boolValue;
@@ -599,6 +829,12 @@ static void parseDaemonOptions(void) {
     NSNumber *bonjourN = [prefs objectForKey:@"BonjourEnabled"];
     if ([bonjourN isKindOfClass:[NSNumber class]])
         gBonjourEnabled = bonjourN.boolValue;
+    NSNumber *adaptiveTileN = [prefs objectForKey:@"AdaptiveTileSize"];
+    if ([adaptiveTileN isKindOfClass:[NSNumber class]])
+        gTileSizeAdaptive = adaptiveTileN.boolValue;
+    NSNumber *autoCalibrateN = [prefs objectForKey:@"AutoCalibrate"];
+    if ([autoCalibrateN isKindOfClass:[NSNumber class]])
+        gAutoCalibrate = autoCalibrateN.boolValue;
     NSNumber *fileN = [prefs objectForKey:@"FileTransferEnabled"];
     if ([fileN isKindOfClass:[NSNumber class]])
         gFileTransferEnabled = fileN.boolValue;
@@ -683,7 +919,23 @@ static void parseDaemonOptions(void) {
         parseWheelOptions(wheelTuning.UTF8String);
     }
 
+    // Dirty detection tuning (advanced)
+    NSString *dirtyTuning = [prefs objectForKey:@"DirtyTuning"];
+    if ([dirtyTuning isKindOfClass:[NSString class]] && dirtyTuning.length > 0) {
+        parseDirtyOptions(dirtyTuning.UTF8String);
+    }
+
+    // Region masks (advanced)
+    NSString *regionMasks = [prefs objectForKey:@"RegionMasks"];
+    if ([regionMasks isKindOfClass:[NSString class]] && regionMasks.length > 0) {
+        parseRegionOptions(regionMasks.UTF8String);
+    }
+
     // HTTP dir override and SSL (require absolute paths)
+    NSString *calibratedFor = [prefs objectForKey:@"CalibratedFor"];
+    if ([calibratedFor isKindOfClass:[NSString class]])
+        gCalibratedFor = calibratedFor;
+
     NSString *httpDir = [prefs objectForKey:@"HttpDir"];
     if ([httpDir isKindOfClass:[NSString class]] && httpDir.length > 0) {
         if (![httpDir hasPrefix:@"/"]) {
@@ -844,10 +1096,19 @@ static void parseDaemonOptions(void) {
     // Core feature flags
     [cfg appendFormat:@"viewOnly=%@ clip=%@ keepAlive=%.0fs ", gViewOnly ? @"YES" : @"NO",
                       gClipboardEnabled ? @"YES" : @"NO", gKeepAliveSec];
-    [cfg appendFormat:@"scale=%.2f fps=%d:%d:%d defer=%.3f ", gScale, gFpsMin, gFpsPref, gFpsMax, gDeferWindowSec];
-    [cfg appendFormat:@"inflight=%d tile=%d full%%=%d rects=%d ", gMaxInflightUpdates, gTileSize,
-                      gFullscreenThresholdPercent, gMaxRectsLimit];
-    [cfg appendFormat:@"async=%@ cursor=%@ orient=%@ keylog=%@ randomTouch=%@ ", gAsyncSwapEnabled ? @"YES" : @"NO",
+    [cfg appendFormat:@"scale=%.2f quality=%s fps=%d:%d:%d defer=%.3f ", gScale, scaleQualityName(gScaleQuality),
+                      gFpsMin, gFpsPref, gFpsMax, gDeferWindowSec];
+    [cfg appendFormat:@"inflight=%d tile=%d%s full%%=%d rects=%d hash=%s diff=%s ", gMaxInflightUpdates, gTileSize,
+                      gTileSizeAdaptive ? "(auto)" : "", gFullscreenThresholdPercent, gMaxRectsLimit,
+                      TileHashKernelName(gHashKernel),
+                      gDiffMode == TileDiffMode::Compare ? "compare" : "hash"];
+    [cfg appendFormat:@"space=%s refine=%d rectcost=%d workers=%d scroll=%s motion=%s dedup=%s hotfps=%d ",
+                      gSourceSpaceDirty ? "source" : "output", gRefineMaxArea, gRectHeaderBytes, gWorkerThreads,
+                      gScrollDetect ? "on" : "off", gMotionSearch ? "on" : "off", gDedupTiles ? "on" : "off",
+                      gHotRegionFps];
+    [cfg appendFormat:@"regionMasks=%d ", gRegionMaskCount];
+    [cfg appendFormat:@"async=%@ zeroCopy=%@ cursor=%@ orient=%@ keylog=%@ randomTouch=%@ ",
+                      gAsyncSwapEnabled ? @"YES" : @"NO", gZeroCopyEnabled ? @"YES" : @"NO",
                       gCursorEnabled ? @"YES" : @"NO", gOrientationSyncEnabled ? @"YES" : @"NO",
                       gKeyEventLogging ? @"YES" : @"NO", gRandomizeTouchEnabled ? @"YES" : @"NO"];
 
@@ -1042,6 +1303,12 @@ static void parseCLI(int argc, const char *argv[]) {
             continue; // skip adding this arg
         }
 
+        if (strcmp(arg, "-calibrate") == 0) {
+            gCalibrateMode = YES;
+            TVLog(@"CLI: Calibration mode (-calibrate)");
+            continue; // skip adding this arg
+        }
+
         __filtered.push_back(arg);
     }
 
@@ -1056,7 +1323,7 @@ static void parseCLI(int argc, const char *argv[]) {
 #pragma clang diagnostic pop
 
     int opt;
-    const char *optstr = "p:n:vA:c:C:s:F:d:Q:t:P:R:aW:w:NM:KU:O:rI:i:H:D:e:k:B:T:Vh";
+    const char *optstr = "p:n:vA:c:C:s:S:F:d:Q:t:P:R:azX:Z:W:w:NM:KU:O:rI:i:H:D:e:k:B:T:Vh";
     optind = 1;
     while ((opt = getopt(__argc2, __argv2.data(), optstr)) != -1) {
         switch (opt) {
@@ -1124,6 +1391,14 @@ static void parseCLI(int argc, const char *argv[]) {
             TVLog(@"CLI: Output scale factor set to %.3f", gScale);
             break;
         }
+        case 'S': {
+            if (!parseScaleQuality(optarg, &gScaleQuality)) {
+                TVPrintError("Invalid -S tier: %s (expected fast|balanced|hq)", optarg ? optarg : "");
+                exit(EXIT_FAILURE);
+            }
+            TVLog(@"CLI: Downscale quality set to %s", scaleQualityName(gScaleQuality));
+            break;
+        }
         case 'F': {
             // Accept formats: "fps", "min-max", "min:pref:max"
             const char *spec = optarg ? optarg : "";
@@ -1212,6 +1487,11 @@ static void parseCLI(int argc, const char *argv[]) {
             break;
         }
         case 't': {
+            if (strcmp(optarg, "auto") == 0) {
+                gTileSizeAdaptive = YES;
+                TVLog(@"CLI: Tile size set to auto (adaptive)");
+                break;
+            }
             long ts = strtol(optarg, NULL, 10);
             if (ts < 8 || ts > 128) {
                 TVPrintError("Invalid tile size: %s (expected 8..128)", optarg);
@@ -1243,7 +1523,20 @@ static void parseCLI(int argc, const char *argv[]) {
         }
         case 'a': {
             gAsyncSwapEnabled = YES;
-            TVLog(@"CLI: Non-blocking swap enabled (-a)");
+            TVLog(@"CLI: -a is deprecated and ignored: frames are always published without locking clients");
+            break;
+        }
+        case 'z': {
+            gZeroCopyEnabled = YES;
+            TVLog(@"CLI: Zero-copy framebuffer enabled (-z)");
+            break;
+        }
+        case 'X': {
+            parseDirtyOptions(optarg);
+            break;
+        }
+        case 'Z': {
+            parseRegionOptions(optarg);
             break;
         }
         case 'W': {
@@ -1492,433 +1785,668 @@ static void (^gFrameHandler)(CMSampleBufferRef) = nil;
 
 static int gWidth = 0;
 static int gHeight = 0;
-static int gSrcWidth = 0;      // capture source width
-static int gSrcHeight = 0;     // capture source height
-static size_t gFBSize = 0;     // in bytes
-static int gBytesPerPixel = 4; // ARGB/BGRA 32-bit
+static int gSrcWidth = 0;          // capture source width
+static int gSrcHeight = 0;         // capture source height
+static size_t gFBSize = 0;         // in bytes
+static size_t gFBCapacity = 0;     // bytes of each heap framebuffer: enough for the output of either orientation
+static size_t gFBBytesPerRow = 0;  // row stride of the front and back buffers
+static int gBytesPerPixel = 4;     // ARGB/BGRA 32-bit
 
 static void *gFrontBuffer = NULL; // Exposed to VNC clients via gScreen->frameBuffer
-static void *gBackBuffer = NULL;  // We render into this and then swap
-
-// Hash algorithm selection (auto: prefer CRC32 on ARM with hardware support)
-#if DEBUG
-#if defined(__aarch64__) || defined(__ARM_FEATURE_CRC32)
-static const BOOL cUseCRC32Hash = YES;
-#else
-static const BOOL cUseCRC32Hash = NO;
-#endif
-#endif
+static void *gBackBuffer = NULL;  // We render into this and then publish it (NULL until a free buffer is found)
+
+// Frame publication removes the global stall, not tearing. The back buffer becomes the front buffer with one pointer
+// store, without locking clients unless publishBackBuffer has to, and each publication starts a new generation. All
+// clients share gScreen->frameBuffer and libvncserver reads it rect by rect, so an update that overlaps a publication
+// may send some rects of the old frame and some of the new one. The new frame's rects are marked modified after the
+// store, so the next update sends them again. A frame per update would take a screen per client, which libvncserver
+// only supports as a scaled screen, rescaling pointer input through floating point.
+// What publication does guarantee is that no buffer is written while an update may still read it: displayHook pins
+// the generation current when the update starts, a replaced front buffer is retired with the generation that replaced
+// it, and it is reused once every pinned generation has reached that one. At most cPublishBuffers heap buffers exist;
+// when all are front, back or still read, the frame is dropped and captured again once an update finishes. They are
+// all allocated at launch with room for either orientation, so neither frames nor rotations allocate.
+static const int cPublishBuffers = 3;       // front, back, and one still read by updates in progress
+static const int cReaderSlotsPerBlock = 64; // pin slots added at a time when every client slot is taken
 
 typedef struct {
-    int x, y, w, h;
-} DirtyRect;
-
-#if defined(__aarch64__) || defined(__ARM_FEATURE_CRC32)
-NS_INLINE uint64_t crc32_update(uint64_t h, const uint8_t *data, size_t len) {
-    uint32_t c = (uint32_t)h;
-    const uint8_t *p = data;
-    size_t n = len;
-    // Process 8-byte chunks
-    while (n >= 8) {
-        uint64_t v;
-        // Unaligned load is acceptable on ARM64; use memcpy to be safe for strict aliasing.
-        memcpy(&v, p, sizeof(v));
-        c = __builtin_arm_crc32d(c, v);
-        p += 8;
-        n -= 8;
-    }
-    if (n >= 4) {
-        uint32_t v32;
-        memcpy(&v32, p, sizeof(v32));
-        c = __builtin_arm_crc32w(c, v32);
-        p += 4;
-        n -= 4;
-    }
-    if (n >= 2) {
-        uint16_t v16;
-        memcpy(&v16, p, sizeof(v16));
-        c = __builtin_arm_crc32h(c, v16);
-        p += 2;
-        n -= 2;
-    }
-    if (n) {
-        c = __builtin_arm_crc32b(c, *p);
-    }
-    return (uint64_t)c;
+    void *pixels;
+    CVPixelBufferRef surface; // -z capture (NULL: heap buffer)
+    uint64_t retiredAt;       // generation that replaced it as the front buffer
+} TVRetiredBuffer;
+
+// Pin slots of connected clients. Blocks are appended without locking when all are taken, and never freed, so the
+// capture thread may walk them while clients come and go.
+typedef struct TVReaderSlots {
+    std::atomic<rfbClientPtr> clients[cReaderSlotsPerBlock]; // client owning each pin slot
+    std::atomic<uint64_t> pins[cReaderSlotsPerBlock];        // generation pinned by the update in progress (0: none)
+    std::atomic<struct TVReaderSlots *> next;                // further slots (NULL: none yet)
+} TVReaderSlots;
+
+static std::atomic<uint64_t> gPublishGen(1);         // generation of the front buffer
+static TVReaderSlots gReaderSlots;                   // first block of pin slots
+static std::vector<TVRetiredBuffer> gRetiredBuffers; // replaced front buffers, oldest first
+static std::vector<void *> gFreeBuffers;             // heap buffers of gFBCapacity bytes nobody reads
+static int gHeapBuffers = 0;                         // heap buffers allocated at launch
+static BOOL gBackIsPrevious = NO; // the back buffer held the front buffer of the previous generation
+static uint64_t gPublishDrops = 0; // frames dropped because every buffer was in use
+static std::atomic<bool> gPublishRetry(false); // a frame was dropped: the next unpin asks the capturer for another
+
+// Zero-copy (-z): unscaled, unrotated captures become the back buffer instead of being copied into it
+static BOOL gZeroCopy = NO;                   // -z applies to this geometry (output is the capture size)
+static size_t gZeroCopyBytesPerRow = 0;       // capture surface stride, used by framebuffers of the capture size
+static CVPixelBufferRef gFrontSurface = NULL; // capture backing gFrontBuffer (NULL: heap buffer)
+static CVPixelBufferRef gBackSurface = NULL;  // capture backing gBackBuffer (NULL: heap buffer)
+static const NSUInteger cZeroCopySurfaces = cPublishBuffers + 1; // capture ring: the published ones plus one
+
+// Row stride of framebuffers of this size: the capture's under -z, so captures and heap buffers interchange
+NS_INLINE size_t framebufferBytesPerRow(int width, int height) {
+    if (gZeroCopy && width == gSrcWidth && height == gSrcHeight)
+        return gZeroCopyBytesPerRow;
+    return (size_t)width * (size_t)gBytesPerPixel;
 }
-#else
-NS_INLINE uint64_t fnv1a_basis(void) { return 1469598103934665603ULL; }
-NS_INLINE uint64_t fnv1a_update(uint64_t h, const uint8_t *data, size_t len) {
-    const uint64_t FNV_PRIME = 1099511628211ULL;
-    for (size_t i = 0; i < len; ++i) {
-        h ^= (uint64_t)data[i];
-        h *= FNV_PRIME;
+
+// A buffer nobody reads any more: heap buffers go to the free list, and captures are unpinned so the capturer may
+// reuse them.
+static void recycleFramebuffer(void *buffer, CVPixelBufferRef surface) {
+    if (surface) {
+        IOSurfaceDecrementUseCount(CVPixelBufferGetIOSurface(surface));
+        CVPixelBufferUnlockBaseAddress(surface, 0);
+        CVPixelBufferRelease(surface);
+    } else if (buffer) {
+        gFreeBuffers.push_back(buffer);
     }
-    return h;
 }
-#endif
 
-// Generic hash wrappers: prefer hardware CRC32 when enabled and available, else fallback to FNV-1a.
-NS_INLINE uint64_t hash_basis(void) {
-#if defined(__aarch64__) || defined(__ARM_FEATURE_CRC32)
-    return 0u; // CRC32 initial accumulator
-#else
-    return fnv1a_basis();
-#endif
+// Retired buffers older than every pinned generation are read by no update any more.
+static void reclaimRetiredBuffers(void) {
+    if (gRetiredBuffers.empty())
+        return;
+    uint64_t oldestPin = UINT64_MAX;
+    for (TVReaderSlots *slots = &gReaderSlots; slots; slots = slots->next.load()) {
+        for (int i = 0; i < cReaderSlotsPerBlock; ++i) {
+            uint64_t pin = slots->pins[i].load();
+            if (pin != 0 && pin < oldestPin)
+                oldestPin = pin;
+        }
+    }
+    size_t kept = 0;
+    for (const TVRetiredBuffer &b : gRetiredBuffers) {
+        if (oldestPin < b.retiredAt)
+            gRetiredBuffers[kept++] = b; // an update that started before it was replaced may still read it
+        else
+            recycleFramebuffer(b.pixels, b.surface);
+    }
+    gRetiredBuffers.resize(kept);
 }
 
-NS_INLINE uint64_t hash_update(uint64_t h, const uint8_t *data, size_t len) {
-#if defined(__aarch64__) || defined(__ARM_FEATURE_CRC32)
-    return crc32_update(h, data, len);
-#else
-    // If CRC32 not supported at compile time, fallback to FNV-1a
-    return fnv1a_update(h, data, len);
-#endif
+// Allocate the cPublishBuffers heap buffers of gFBCapacity bytes into the free list (at launch).
+static BOOL reserveFramebuffers(void) {
+    while (gHeapBuffers < cPublishBuffers) {
+        void *buffer = calloc(1, gFBCapacity);
+        if (!buffer)
+            return NO;
+        gFreeBuffers.push_back(buffer);
+        gHeapBuffers++;
+    }
+    return YES;
 }
 
-#pragma mark - Display Tiling
-
-static int gTilesX = 0;
-static int gTilesY = 0;
-static size_t gTileCount = 0;
-static uint64_t *gPrevHash = NULL;
-static uint64_t *gCurrHash = NULL;
-static uint8_t *gPendingDirty = NULL; // per-tile pending dirty mask
-static BOOL gHasPending = NO;
+// A heap buffer nobody reads, or NULL when every one is still in use.
+static void *takeFreeBuffer(void) {
+    reclaimRetiredBuffers();
+    if (gFreeBuffers.empty())
+        return NULL;
+    void *buffer = gFreeBuffers.back(); // most recently released: likely the previous front buffer
+    gFreeBuffers.pop_back();
+    return buffer;
+}
 
-static void initializeTilingOrReset(void) {
-    int tilesX = (gWidth + gTileSize - 1) / gTileSize;
-    int tilesY = (gHeight + gTileSize - 1) / gTileSize;
-    size_t tileCount = (size_t)tilesX * (size_t)tilesY;
+// takeFreeBuffer() for a frame that cannot wait: when every buffer is still in use, the next unpin has the capturer
+// deliver another frame, since the screen may have gone static by then. Looks again after arming that, in case the
+// last update finished in between.
+static void *takeFreeBufferOrRetry(void) {
+    void *buffer = takeFreeBuffer();
+    if (buffer)
+        return buffer;
+    gPublishRetry.store(true);
+    buffer = takeFreeBuffer();
+    if (buffer)
+        gPublishRetry.store(false);
+    return buffer;
+}
 
-    if (tilesX != gTilesX || tilesY != gTilesY || tileCount != gTileCount || !gPrevHash || !gCurrHash) {
-        free(gPrevHash);
-        free(gCurrHash);
+// Make sure there is a back buffer to render into. Returns NO when every buffer is still in use.
+NS_INLINE BOOL acquireBackBuffer(void) {
+    if (!gBackBuffer)
+        gBackBuffer = takeFreeBuffer();
+    return gBackBuffer != NULL;
+}
 
-        if (gPendingDirty) {
-            free(gPendingDirty);
-            gPendingDirty = NULL;
+// Pin slot of cl, or NULL when it has none.
+static std::atomic<uint64_t> *readerSlotFind(rfbClientPtr cl) {
+    for (TVReaderSlots *slots = &gReaderSlots; slots; slots = slots->next.load()) {
+        for (int i = 0; i < cReaderSlotsPerBlock; ++i) {
+            if (slots->clients[i].load(std::memory_order_relaxed) == cl)
+                return &slots->pins[i];
         }
+    }
+    return NULL;
+}
 
-        gPrevHash = (uint64_t *)malloc(tileCount * sizeof(uint64_t));
-        gCurrHash = (uint64_t *)malloc(tileCount * sizeof(uint64_t));
-        gPendingDirty = (uint8_t *)malloc(tileCount);
-
-        if (!gPrevHash || !gCurrHash) {
-            TVPrintError("Out of memory for tile hashes");
-            exit(EXIT_FAILURE);
+// Take a free pin slot for cl, appending a block when every slot is taken.
+static std::atomic<uint64_t> *readerSlotClaim(rfbClientPtr cl) {
+    TVReaderSlots *slots = &gReaderSlots;
+    for (;;) {
+        for (int i = 0; i < cReaderSlotsPerBlock; ++i) {
+            rfbClientPtr none = NULL;
+            if (slots->clients[i].compare_exchange_strong(none, cl))
+                return &slots->pins[i];
         }
-
-        for (size_t i = 0; i < tileCount; ++i) {
-            gPrevHash[i] = 0; // force full update first frame
-            gCurrHash[i] = hash_basis();
+        TVReaderSlots *next = slots->next.load();
+        if (!next) {
+            TVReaderSlots *grown = new TVReaderSlots();
+            if (slots->next.compare_exchange_strong(next, grown))
+                next = grown;
+            else
+                delete grown; // another client appended a block first: next is that one
         }
+        slots = next;
+    }
+}
 
-        gTilesX = tilesX;
-        gTilesY = tilesY;
-        gTileCount = tileCount;
-
-        if (gPendingDirty)
-            memset(gPendingDirty, 0, gTileCount);
-    } else {
-        for (size_t i = 0; i < gTileCount; ++i) {
-            gCurrHash[i] = hash_basis();
+static void readerSlotRelease(rfbClientPtr cl) {
+    for (TVReaderSlots *slots = &gReaderSlots; slots; slots = slots->next.load()) {
+        for (int i = 0; i < cReaderSlotsPerBlock; ++i) {
+            if (slots->clients[i].load() == cl) {
+                slots->pins[i].store(0);
+                slots->clients[i].store(NULL);
+                return;
+            }
         }
     }
 }
 
-NS_INLINE void swapTileHashes(void) {
-    uint64_t *tmp = gPrevHash;
-    gPrevHash = gCurrHash;
-    gCurrHash = tmp;
+// Pin the published generation for the update cl is about to send (displayHook), and unpin it once sent.
+static void readerPin(rfbClientPtr cl) {
+    std::atomic<uint64_t> *pin = readerSlotFind(cl);
+    if (!pin)
+        pin = readerSlotClaim(cl); // newClientHook claims one; only reached if it did not
+    pin->store(gPublishGen.load());
+    // The pin must be visible before the update reads gScreen->frameBuffer
+    std::atomic_thread_fence(std::memory_order_seq_cst);
 }
 
-NS_INLINE void resetCurrTileHashes(void) {
-    if (!gCurrHash || gTileCount == 0)
-        return;
-    uint64_t basis = hash_basis();
-    for (size_t i = 0; i < gTileCount; ++i) {
-        gCurrHash[i] = basis;
-    }
+static void readerUnpin(rfbClientPtr cl) {
+    std::atomic<uint64_t> *pin = readerSlotFind(cl);
+    if (pin)
+        pin->store(0);
 }
 
-// Accumulate pending dirty tiles for time-based coalescing
-NS_INLINE void accumulatePendingDirty(void) {
-    if (!gPendingDirty)
-        return;
+// -z: the capture becomes the back buffer. It stays locked and pinned (IOSurface use count) while it is the back or
+// front buffer, so the capturer writes later frames into other surfaces of its ring. Returns NO to copy instead.
+static BOOL adoptCaptureAsBackBuffer(CVPixelBufferRef pb) {
+    IOSurfaceRef surface = CVPixelBufferGetIOSurface(pb);
+    if (!surface || CVPixelBufferLockBaseAddress(pb, 0) != kCVReturnSuccess)
+        return NO;
+    CVPixelBufferRetain(pb);
+    IOSurfaceIncrementUseCount(surface);
+    recycleFramebuffer(gBackBuffer, gBackSurface); // never published: nobody reads it
+    gBackBuffer = CVPixelBufferGetBaseAddress(pb);
+    gBackSurface = pb;
+    return YES;
+}
 
-    for (size_t i = 0; i < gTileCount; ++i) {
-        if (gCurrHash[i] != gPrevHash[i])
-            gPendingDirty[i] = 1;
-    }
+#pragma mark - Display Tiling
+
+static TileDiffEngine gTileDiff; // tile hashes and pending dirty mask
+static BOOL gHasPending = NO;
+
+// Source-space damage (-X space=source)
+static TileDiffEngine gSrcTileDiff;  // tile hashes of the portrait capture, frame to frame
+static int gSrcTileSize = 32;        // source tile size, fixed per geometry (not retiled with -t auto)
+static BOOL gBackBufferInSync = NO; // back buffer holds the complete latest frame (partial renders allowed)
+
+// Adaptive tiling (-t auto)
+static TileSizeTuner gTileTuner;
+static const int cAdaptiveTileMin = 16; // finest tile size picked by -t auto
+static const int cAdaptiveTileMax = 64; // coarsest tile size picked by -t auto
+
+static const double cRectPixelBytes = 1.0; // rect coalescing: estimated encoded bytes per pixel
+static const int cHotMinFlushes = 12;      // hot region: tile dirty in at least this many of the last 16 flushes
+
+NS_INLINE void initializeTilingOrReset(void) {
+    gTileDiff.setHashKernel(gHashKernel);
+    gTileDiff.setDiffMode(gSourceSpaceDirty ? TileDiffMode::Mask : gDiffMode);
+    gTileDiff.configure(gWidth, gHeight, gTileSize, gBytesPerPixel);
+    gTileDiff.setRectCostModel((double)gRectHeaderBytes, cRectPixelBytes);
+    // Held tiles are restored from the front buffer; source-space damage would not redraw them later
+    gTileDiff.setHotThreshold(gHotRegionFps > 0 && !gSourceSpaceDirty ? cHotMinFlushes : 0);
+    gSrcTileDiff.setHashKernel(gHashKernel);
+    gSrcTileSize = MAX(8, MIN(256, (int)lround((double)gTileSize / (gScale > 0.0 ? gScale : 1.0))));
+    gBackBufferInSync = NO;
+    gTileTuner.configure(cAdaptiveTileMin, cAdaptiveTileMax, gMaxRectsLimit);
 }
 
-NS_INLINE void hashTiledFromBuffer(const uint8_t *buf, int width, int height, size_t bpr) {
-    resetCurrTileHashes();
-    for (int y = 0; y < height; ++y) {
-        int ty = y / gTileSize;
-        for (int tx = 0; tx < gTilesX; ++tx) {
-            int startX = tx * gTileSize;
-            if (startX >= width)
-                break;
-            int endX = startX + gTileSize;
-            if (endX > width)
-                endX = width;
-            size_t offset = (size_t)startX * (size_t)gBytesPerPixel;
-            size_t length = (size_t)(endX - startX) * (size_t)gBytesPerPixel;
-            size_t tileIndex = (size_t)ty * (size_t)gTilesX + (size_t)tx;
-            gCurrHash[tileIndex] = hash_update(gCurrHash[tileIndex], buf + (size_t)y * bpr + offset, length);
-        }
-    }
-}
-
-// Sparse sampling hash: sample a subset of pixels per tile to reduce bandwidth.
-NS_INLINE void hashTiledFromBufferSparse(const uint8_t *buf, int width, int height, size_t bpr, int sx, int sy) {
-    if (sx < 1)
-        sx = 1;
-    if (sy < 1)
-        sy = 1;
-    resetCurrTileHashes();
-    for (int y = 0; y < height; y += sy) {
-        int ty = y / gTileSize;
-        for (int tx = 0; tx < gTilesX; ++tx) {
-            int startX = tx * gTileSize;
-            if (startX >= width)
-                break;
-            int endX = startX + gTileSize;
-            if (endX > width)
-                endX = width;
-            size_t tileIndex = (size_t)ty * (size_t)gTilesX + (size_t)tx;
-            for (int x = startX; x < endX; x += sx) {
-                const uint8_t *p = buf + (size_t)y * bpr + (size_t)x * (size_t)gBytesPerPixel;
-                gCurrHash[tileIndex] = hash_update(gCurrHash[tileIndex], p, (size_t)gBytesPerPixel);
-            }
-            // Ensure last column contributes even if not aligned to stride
-            int lastX = endX - 1;
-            if (lastX >= startX && ((endX - startX - 1) % sx) != 0) {
-                const uint8_t *p = buf + (size_t)y * bpr + (size_t)lastX * (size_t)gBytesPerPixel;
-                gCurrHash[tileIndex] = hash_update(gCurrHash[tileIndex], p, (size_t)gBytesPerPixel);
-            }
-        }
-    }
-    // Also sample the last row if height-1 isn't covered by the stride
-    int lastY = height - 1;
-    if (lastY >= 0 && ((height - 1) % sy) != 0) {
-        int ty = lastY / gTileSize;
-        for (int tx = 0; tx < gTilesX; ++tx) {
-            int startX = tx * gTileSize;
-            if (startX >= width)
-                break;
-            int endX = startX + gTileSize;
-            if (endX > width)
-                endX = width;
-            size_t tileIndex = (size_t)ty * (size_t)gTilesX + (size_t)tx;
-            for (int x = startX; x < endX; x += sx) {
-                const uint8_t *p = buf + (size_t)lastY * bpr + (size_t)x * (size_t)gBytesPerPixel;
-                gCurrHash[tileIndex] = hash_update(gCurrHash[tileIndex], p, (size_t)gBytesPerPixel);
-            }
-            int lastX = endX - 1;
-            if (lastX >= startX && ((endX - startX - 1) % sx) != 0) {
-                const uint8_t *p = buf + (size_t)lastY * bpr + (size_t)lastX * (size_t)gBytesPerPixel;
-                gCurrHash[tileIndex] = hash_update(gCurrHash[tileIndex], p, (size_t)gBytesPerPixel);
-            }
-        }
-    }
+static WorkerPool *gWorkerPool = NULL;       // frame pipeline workers, created on first use
+static WorkerPool::BatchRef gBackBufferSync; // front -> back rect copy still running after a swap (-X space=source)
+static const int cPoolBandRows = 64;         // rows per pool chunk when bands need not align with tile rows
+static const int cParallelRefineMinRects = 4; // refine on the pool from this many rects
+static const double cWorkerStatsIntervalSec = 5.0; // verbose worker utilization log interval
+
+// Long-lived workers for banded frame work; the capture thread takes part as lane 0.
+NS_INLINE WorkerPool *workerPool(void) {
+    if (!gWorkerPool)
+        gWorkerPool = new WorkerPool(gWorkerThreads);
+    return gWorkerPool;
 }
 
-// Parallel full hash over tiles: split by tile rows to reduce wall clock at flush.
-NS_INLINE void hashTiledFromBufferParallel(const uint8_t *buf, int width, int height, size_t bpr, int threads) {
+// Parallelism hint for banded tile work: pool lanes (workers + the capture thread).
+NS_INLINE int tileWorkerThreads(void) { return workerPool()->laneCount(); }
+
+// Wait for the front -> back copy queued by the previous flush before touching either buffer.
+NS_INLINE void waitBackBufferSync(void) {
+    if (!gBackBufferSync)
+        return;
+    workerPool()->wait(gBackBufferSync);
+    gBackBufferSync.reset();
+}
+
+// Parallel full hash over tiles: one pool chunk per tile row to reduce wall clock at flush.
+NS_INLINE void hashTiledFromBufferParallel(TileDiffEngine *engine, const uint8_t *buf, size_t bpr, int threads) {
     if (threads <= 1) {
-        hashTiledFromBuffer(buf, width, height, bpr);
+        engine->hashFull(buf, bpr);
         return;
     }
-    resetCurrTileHashes();
-    // Split by tile row bands
-    int tilesY = gTilesY;
-    if (tilesY <= 0)
+    engine->resetCurrentHashes();
+    const int tilesY = engine->tilesY();
+    // Each tile row is hashed by a single chunk, no race across chunks.
+    workerPool()->parallelFor(tilesY, [=](int ty) { engine->hashTileRows(buf, bpr, ty, tilesY); });
+}
+
+// Parallel tile compare of back against front, same chunking as the parallel hash.
+NS_INLINE void compareTiledFromBuffersParallel(const uint8_t *buf, const uint8_t *ref, size_t bpr, int threads) {
+    if (threads <= 1) {
+        gTileDiff.compareFull(buf, ref, bpr);
         return;
-    int bands = threads;
-    if (bands > tilesY)
-        bands = tilesY;
-    dispatch_group_t grp = dispatch_group_create();
-    for (int band = 0; band < bands; ++band) {
-        dispatch_group_async(grp, dispatch_get_global_queue(QOS_CLASS_USER_INTERACTIVE, 0), ^{
-            for (int ty = band; ty < tilesY; ty += bands) {
-                int startY = ty * gTileSize;
-                int endY = startY + gTileSize;
-                if (startY >= height)
-                    break;
-                if (endY > height)
-                    endY = height;
-                for (int y = startY; y < endY; ++y) {
-                    for (int tx = 0; tx < gTilesX; ++tx) {
-                        int startX = tx * gTileSize;
-                        if (startX >= width)
-                            break;
-                        int endX = startX + gTileSize;
-                        if (endX > width)
-                            endX = width;
-                        size_t offset = (size_t)startX * (size_t)gBytesPerPixel;
-                        size_t length = (size_t)(endX - startX) * (size_t)gBytesPerPixel;
-                        size_t tileIndex = (size_t)ty * (size_t)gTilesX + (size_t)tx;
-                        // Each tileIndex is updated by a single band (fixed ty), no race across bands.
-                        gCurrHash[tileIndex] =
-                            hash_update(gCurrHash[tileIndex], buf + (size_t)y * bpr + offset, length);
-                    }
-                }
-            }
-        });
     }
-    dispatch_group_wait(grp, DISPATCH_TIME_FOREVER);
+    gTileDiff.resetChanged();
+    const int tilesY = gTileDiff.tilesY();
+    workerPool()->parallelFor(tilesY, [=](int ty) { gTileDiff.compareTileRows(buf, ref, bpr, ty, tilesY); });
 }
 
-// Build dirty rectangles from tile hash diffs. Returns number of rects written, up to maxRects.
-static int buildDirtyRects(DirtyRect *rects, int maxRects, int *outChangedTiles) {
-    int rectCount = 0;
-    int changedTiles = 0;
+// Log per-lane pool utilization every few seconds (verbose only).
+static void logWorkerPoolUtilization(void) {
+    if (!tvncVerboseLoggingEnabled || !gWorkerPool)
+        return;
+    static CFAbsoluteTime sLastLog = 0;
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    if (now - sLastLog < cWorkerStatsIntervalSec)
+        return;
+    sLastLog = now;
+    std::vector<WorkerPool::LaneStats> stats = gWorkerPool->takeStats();
+    NSMutableString *lanes = [NSMutableString string];
+    for (size_t i = 0; i < stats.size(); ++i)
+        [lanes appendFormat:@" %zu:%.1f%%/%llu/%llu", i, stats[i].utilization * 100.0,
+                            (unsigned long long)stats[i].chunks, (unsigned long long)stats[i].steals];
+    TVLogVerbose(@"worker pool (lane:busy/chunks/steals):%@", lanes);
+}
 
-    // First pass: horizontal merge per tile row
-    for (int ty = 0; ty < gTilesY; ++ty) {
-        int tx = 0;
-        while (tx < gTilesX) {
-            size_t idx = (size_t)ty * (size_t)gTilesX + (size_t)tx;
-            int changed = (gCurrHash[idx] != gPrevHash[idx]);
-            if (!changed) {
-                tx++;
-                continue;
-            }
+// Hot regions (-X hotfps): held tile updates and skipped flushes since the last log
+static uint64_t gHotHeldTiles = 0;
+static uint64_t gHotSkippedFlushes = 0;
 
-            // Start of a run
-            int runStart = tx;
-            changedTiles++;
-            tx++;
-            while (tx < gTilesX) {
-                size_t idx2 = (size_t)ty * (size_t)gTilesX + (size_t)tx;
-                if (gCurrHash[idx2] != gPrevHash[idx2]) {
-                    changedTiles++;
-                    tx++;
-                } else
-                    break;
-            }
+static void logHotRegionStats(void) {
+    if (!tvncVerboseLoggingEnabled || gHotRegionFps <= 0)
+        return;
+    static CFAbsoluteTime sLastLog = 0;
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    if (now - sLastLog < cWorkerStatsIntervalSec)
+        return;
+    sLastLog = now;
+    int hot = gTileDiff.hotTiles();
+    size_t total = gTileDiff.tileCount();
+    TVLogVerbose(@"hot regions: %d tiles (%.1f%%) limited to %d fps, %llu tile updates held, %llu flushes skipped", hot,
+                 total > 0 ? hot * 100.0 / (double)total : 0.0, gHotRegionFps, (unsigned long long)gHotHeldTiles,
+                 (unsigned long long)gHotSkippedFlushes);
+    gHotHeldTiles = 0;
+    gHotSkippedFlushes = 0;
+}
 
-            // Emit rect for this horizontal run
-            if (rectCount < maxRects) {
-                int x = runStart * gTileSize;
-                int w = (tx - runStart) * gTileSize;
-                int y = ty * gTileSize;
-                int h = gTileSize;
-                // Clip to screen bounds
-                if (x + w > gWidth)
-                    w = gWidth - x;
-                if (y + h > gHeight)
-                    h = gHeight - y;
-                rects[rectCount++] = (DirtyRect){x, y, w, h};
-            } else {
-                // Too many rects; caller may fallback to fullscreen
-                if (outChangedTiles)
-                    *outChangedTiles = changedTiles;
-                return rectCount;
-            }
-        }
+// Region masks (-Z): the status bar preset's default height, as a fraction of the long side of the capture
+static const double cStatusBarHeightRatio = 0.06;
+
+// A region mask in output space, for this orientation and output scale.
+NS_INLINE DirtyRect regionMaskOutputRect(const TVRegionMask *mask, int rotQ) {
+    int srcW = gSrcWidth, srcH = gSrcHeight;
+    int rotW = (rotQ % 2 == 0) ? srcW : srcH;
+    int rotH = (rotQ % 2 == 0) ? srcH : srcW;
+    if (rotW <= 0 || rotH <= 0)
+        return DirtyRect{0, 0, 0, 0};
+    DirtyRect r;
+    if (mask->statusBar) {
+        int h = mask->src.h > 0 ? mask->src.h : (int)lround(MAX(srcW, srcH) * cStatusBarHeightRatio);
+        r = DirtyRect{0, 0, rotW, h};
+    } else {
+        r = DamageMapper::rotateRect(mask->src, srcW, srcH, rotQ);
     }
+    // Rotated space -> output (scale, or pad/crop), rounded outwards
+    double sx = (double)gWidth / (double)rotW, sy = (double)gHeight / (double)rotH;
+    int x0 = MAX(0, (int)floor(r.x * sx)), y0 = MAX(0, (int)floor(r.y * sy));
+    int x1 = MIN(gWidth, (int)ceil((r.x + r.w) * sx)), y1 = MIN(gHeight, (int)ceil((r.y + r.h) * sy));
+    return DirtyRect{x0, y0, MAX(0, x1 - x0), MAX(0, y1 - y0)};
+}
 
-    // Optional vertical merge: merge rects with same x,w and contiguous vertically
-    // Simple O(n^2) merge for small rect counts
-    for (int i = 0; i < rectCount; ++i) {
-        for (int j = i + 1; j < rectCount; ++j) {
-            if (rects[j].w == 0 || rects[j].h == 0)
-                continue;
-            if (rects[i].x == rects[j].x && rects[i].w == rects[j].w) {
-                if (rects[i].y + rects[i].h == rects[j].y) {
-                    rects[i].h += rects[j].h;
-                    rects[j].w = rects[j].h = 0; // mark removed
-                } else if (rects[j].y + rects[j].h == rects[i].y) {
-                    rects[j].h += rects[i].h;
-                    rects[i].w = rects[i].h = 0;
-                }
-            }
+// Whether a throttled region may be updated now.
+NS_INLINE BOOL regionMaskOpen(const TVRegionMask *mask, CFAbsoluteTime now) {
+    if (mask->cadence)
+        return floor(now / mask->periodSec) != floor(mask->lastSent / mask->periodSec);
+    return now - mask->lastSent >= mask->periodSec;
+}
+
+// Hand this flush's region masks to the engine: excluded regions, and throttled ones outside their slot.
+// outRects receives each region's output rect (gRegionMaskCount entries).
+static void applyRegionMasks(int rotQ, CFAbsoluteTime now, DirtyRect *outRects) {
+    DirtyRect excluded[cMaxRegionMasks], held[cMaxRegionMasks];
+    int excludedCount = 0, heldCount = 0;
+    for (int i = 0; i < gRegionMaskCount; ++i) {
+        const TVRegionMask *mask = &gRegionMasks[i];
+        outRects[i] = regionMaskOutputRect(mask, rotQ);
+        if (mask->periodSec <= 0.0)
+            excluded[excludedCount++] = outRects[i];
+        else if (!regionMaskOpen(mask, now))
+            held[heldCount++] = outRects[i];
+    }
+    gTileDiff.setRegionMasks(excluded, excludedCount, held, heldCount);
+}
+
+// Throttled regions whose pixels go out with this flush start a new interval.
+static void markRegionMasksSent(const DirtyRect *maskRects, const DirtyRect *rects, int rectCount, BOOL fullScreen,
+                                CFAbsoluteTime now) {
+    for (int i = 0; i < gRegionMaskCount; ++i) {
+        TVRegionMask *mask = &gRegionMasks[i];
+        if (mask->periodSec <= 0.0 || !regionMaskOpen(mask, now))
+            continue;
+        const DirtyRect &m = maskRects[i];
+        BOOL sent = fullScreen;
+        for (int k = 0; k < rectCount && !sent; ++k) {
+            const DirtyRect &r = rects[k];
+            sent = r.x < m.x + m.w && m.x < r.x + r.w && r.y < m.y + m.h && m.y < r.y + r.h;
         }
+        if (sent)
+            mask->lastSent = now;
     }
+}
+
+// Adaptive tiling (-t auto): switch the output tile grid right after a flush, when nothing is pending.
+// Hash mode re-seeds the baseline from the front buffer (what clients have), so retiling sends nothing by itself.
+static void retileAdaptive(int tileSize) {
+    TVLog(@"Adaptive tiling: %d -> %d (fill=%.2f, rects=%.1f, changed=%.1f%%)", gTileSize, tileSize,
+          gTileTuner.fill(), gTileTuner.rects(), gTileTuner.changedPct());
+    gTileSize = tileSize;
+    gTileDiff.configure(gWidth, gHeight, gTileSize, gBytesPerPixel);
+    gTileDiff.clearPending();
+    gTileDiff.resetChanged();
+    gHasPending = NO;
+    if (gTileDiff.diffMode() == TileDiffMode::Hash) {
+        hashTiledFromBufferParallel(&gTileDiff, (const uint8_t *)gFrontBuffer, gFBBytesPerRow, tileWorkerThreads());
+        gTileDiff.swapHashes();
+    }
+}
 
-    // Compact removed entries
+NS_INLINE uint64_t rectsArea(const DirtyRect *rects, int rectCount) {
+    uint64_t area = 0;
+    for (int i = 0; i < rectCount; ++i)
+        area += (uint64_t)MAX(rects[i].w, 0) * (uint64_t)MAX(rects[i].h, 0);
+    return area;
+}
+
+// TileDiffEngine::refineRects on the pool: one chunk per rect, compacted in order afterwards.
+static int refineRectsParallel(DirtyRect *rects, int rectCount, int maxArea) {
+    const uint8_t *back = (const uint8_t *)gBackBuffer;
+    const uint8_t *front = (const uint8_t *)gFrontBuffer;
+    const size_t bpr = gFBBytesPerRow;
+    if (rectCount < cParallelRefineMinRects)
+        return gTileDiff.refineRects(rects, rectCount, back, front, bpr, maxArea);
+
+    static std::vector<uint8_t> sKeep;
+    sKeep.assign((size_t)rectCount, 0);
+    uint8_t *keep = sKeep.data();
+    workerPool()->parallelFor(rectCount, [=](int i) {
+        DirtyRect &r = rects[i];
+        if (r.w <= 0 || r.h <= 0)
+            return;
+        keep[i] = (int64_t)r.w * (int64_t)r.h > (int64_t)maxArea || gTileDiff.refineRect(r, back, front, bpr);
+    });
     int k = 0;
     for (int i = 0; i < rectCount; ++i) {
-        if (rects[i].w > 0 && rects[i].h > 0)
+        if (keep[i])
             rects[k++] = rects[i];
     }
+    return k;
+}
 
-    rectCount = k;
-    if (outChangedTiles)
-        *outChangedTiles = changedTiles;
-    return rectCount;
+NS_INLINE void markRectsModified(DirtyRect *rects, int rectCount) {
+    for (int i = 0; i < rectCount; ++i) {
+        rfbMarkRectAsModified(gScreen, rects[i].x, rects[i].y, rects[i].x + rects[i].w, rects[i].y + rects[i].h);
+    }
 }
 
-// Build rects from pending mask by temporarily mapping to hashes
-static int buildRectsFromPending(DirtyRect *rects, int maxRects) {
-    if (!gPendingDirty)
-        return 0;
+// After a publish that handed back the previous frame, bring the back buffer up to date with what was published.
+// Runs on the pool while the capture thread returns to the run loop; waitBackBufferSync() joins it.
+NS_INLINE void copyRectsFromFrontToBack(DirtyRect *rects, int rectCount) {
+    if (rectCount <= 0)
+        return;
+    std::vector<DirtyRect> jobs(rects, rects + rectCount);
+    uint8_t *back = (uint8_t *)gBackBuffer;
+    const uint8_t *front = (const uint8_t *)gFrontBuffer;
+    const size_t fbBPR = gFBBytesPerRow;
+    const size_t bpp = (size_t)gBytesPerPixel;
+    gBackBufferSync = workerPool()->submit(rectCount, [=](int i) {
+        const DirtyRect &r = jobs[(size_t)i];
+        size_t rowBytes = (size_t)r.w * bpp;
+        for (int y = r.y; y < r.y + r.h; ++y)
+            memcpy(back + (size_t)y * fbBPR + (size_t)r.x * bpp, front + (size_t)y * fbBPR + (size_t)r.x * bpp,
+                   rowBytes);
+    });
+}
 
-    // Temporarily mark curr!=prev for pending tiles
-    // Save originals
-    // For efficiency, we only synthesize gCurrHash markers without touching buffers
-    size_t changed = 0;
-    for (size_t i = 0; i < gTileCount; ++i) {
-        if (gPendingDirty[i]) {
-            if (gCurrHash[i] == gPrevHash[i])
-                gCurrHash[i] ^= 0x1ULL;
-            changed++;
-        }
-    }
+#pragma mark - Session Resume
+
+// Reconnecting viewers present the generation they last fully received and get the union of the regions flushed
+// since then instead of a full frame. Pseudo-encodings sent by the client in SetEncodings:
+//   cResumeEncoding                opt in: the server reports a token after updates that leave nothing pending
+//   cResumeEpochBase | epoch       token from the previous session: server epoch (16 bits)
+//   cResumeGenHiBase | bits 16..31 token from the previous session: generation, high half
+//   cResumeGenLoBase | bits 0..15  token from the previous session: generation, low half
+// Token message (server -> client): U8 cResumeTokenMsgType, U8 padding, U16 epoch, U32 generation (big-endian).
+// The first FramebufferUpdateRequest of a resumed session must be incremental, or it asks for the full frame.
+static const int cResumeEncoding = 0x54565201;     // 'TVR\1'
+static const int cResumeEpochBase = 0x54570000;    // 'TW' | epoch
+static const int cResumeGenHiBase = 0x54580000;    // 'TX' | generation >> 16
+static const int cResumeGenLoBase = 0x54590000;    // 'TY' | generation & 0xFFFF
+static const uint8_t cResumeTokenMsgType = 0x54;   // server message type of the token report
+static const size_t cResumeHistoryFlushes = 256;   // flushes remembered
+static const size_t cResumeHistoryRects = 8192;    // rects remembered over all flushes
+
+typedef struct {
+    uint32_t generation;
+    BOOL fullScreen;
+    std::vector<DirtyRect> rects;
+} TVResumeFlush;
 
-    int dummyTiles = 0;
-    int cnt = buildDirtyRects(rects, maxRects, &dummyTiles);
+typedef struct {
+    BOOL tokens;            // client opted in to token reports
+    BOOL updateSent;        // an update went out already: too late to resume
+    BOOL haveEpoch, haveHi, haveLo;
+    uint16_t epoch;         // presented token
+    uint32_t generation;    // presented token
+    uint32_t lastReported;  // generation of the last token report
+} TVResumeClient;
+
+static pthread_mutex_t gResumeLock = PTHREAD_MUTEX_INITIALIZER; // guards gResumeHistory, gResumeHistoryRects
+static std::deque<TVResumeFlush> gResumeHistory;                // oldest first
+static size_t gResumeHistoryRects = 0;
+static std::atomic<uint32_t> gFrameGeneration(0); // last generation whose marks were made
+static uint16_t gResumeEpoch = 0;                 // random per server start; tokens of other runs do not match
+
+static rfbProtocolExtension gResumeExtension;
+
+// Remember the rects of the flush about to be published as generation gFrameGeneration + 1. Called before the
+// marks, so a resume in between already includes them; resumeCommitFlush() publishes the generation afterwards.
+static void resumeRecordFlush(const DirtyRect *rects, int rectCount, BOOL fullScreen) {
+    pthread_mutex_lock(&gResumeLock);
+    if (gResumeHistory.size() >= cResumeHistoryFlushes) {
+        gResumeHistoryRects -= gResumeHistory.front().rects.size();
+        gResumeHistory.pop_front();
+    }
+    TVResumeFlush flush;
+    flush.generation = gFrameGeneration.load(std::memory_order_relaxed) + 1;
+    flush.fullScreen = fullScreen || (size_t)rectCount > cResumeHistoryRects;
+    if (!flush.fullScreen && rectCount > 0)
+        flush.rects.assign(rects, rects + rectCount);
+    gResumeHistoryRects += flush.rects.size();
+    gResumeHistory.push_back(std::move(flush));
+    while (gResumeHistoryRects > cResumeHistoryRects && gResumeHistory.size() > 1) {
+        gResumeHistoryRects -= gResumeHistory.front().rects.size();
+        gResumeHistory.pop_front();
+    }
+    pthread_mutex_unlock(&gResumeLock);
+}
 
-    // Restore hashes for tiles we toggled
-    for (size_t i = 0; i < gTileCount; ++i) {
-        if (gPendingDirty[i]) {
-            if (gCurrHash[i] == gPrevHash[i])
-                gCurrHash[i] ^= 0x1ULL; // unlikely path
-            else if ((gCurrHash[i] ^ 0x1ULL) == gPrevHash[i])
-                gCurrHash[i] ^= 0x1ULL;
+NS_INLINE void resumeCommitFlush(void) { gFrameGeneration.fetch_add(1, std::memory_order_release); }
+
+// Region flushed after generation, or NULL when the history no longer reaches back that far. Caller holds
+// gResumeLock.
+static sraRegion *resumeDamageSinceLocked(uint32_t generation) {
+    const uint32_t current = gFrameGeneration.load(std::memory_order_acquire);
+    if (generation > current)
+        return NULL;
+    if (generation == current && (gResumeHistory.empty() || gResumeHistory.back().generation <= current))
+        return sraRgnCreate();
+    if (gResumeHistory.empty() || gResumeHistory.front().generation > generation + 1)
+        return NULL;
+    sraRegion *region = sraRgnCreate();
+    for (const TVResumeFlush &flush : gResumeHistory) {
+        if (flush.generation <= generation)
+            continue;
+        if (flush.fullScreen) {
+            sraRgnDestroy(region);
+            return NULL;
+        }
+        for (const DirtyRect &r : flush.rects) {
+            sraRegion *rect = sraRgnCreateRect(r.x, r.y, r.x + r.w, r.y + r.h);
+            sraRgnOr(region, rect);
+            sraRgnDestroy(rect);
         }
     }
-
-    (void)changed;
-    return cnt;
+    return region;
 }
 
-NS_INLINE void markRectsModified(DirtyRect *rects, int rectCount) {
-    for (int i = 0; i < rectCount; ++i) {
-        rfbMarkRectAsModified(gScreen, rects[i].x, rects[i].y, rects[i].x + rects[i].w, rects[i].y + rects[i].h);
+// Replace the initial full-frame damage of a client that presented a complete token with the delta.
+static void resumeApplyToken(rfbClientPtr cl, TVResumeClient *rc) {
+    if (!rc->haveEpoch || !rc->haveHi || !rc->haveLo || rc->updateSent)
+        return;
+    rc->haveEpoch = rc->haveHi = rc->haveLo = NO;
+    if (rc->epoch != gResumeEpoch) {
+        TVLog(@"Resume: token from another server session; sending full frame");
+        return;
     }
+    pthread_mutex_lock(&gResumeLock);
+    sraRegion *delta = resumeDamageSinceLocked(rc->generation);
+    if (delta) {
+        pthread_mutex_lock(&cl->updateMutex);
+        sraRgnDestroy(cl->modifiedRegion);
+        cl->modifiedRegion = delta;
+        pthread_mutex_unlock(&cl->updateMutex);
+    }
+    pthread_mutex_unlock(&gResumeLock);
+    if (delta)
+        TVLog(@"Resume: generation %u -> %u, sending changed regions only", rc->generation,
+              gFrameGeneration.load(std::memory_order_relaxed));
+    else
+        TVLog(@"Resume: history does not reach generation %u; sending full frame", rc->generation);
 }
 
-NS_INLINE void copyRectsFromBackToFront(DirtyRect *rects, int rectCount) {
-    size_t fbBPR = (size_t)gWidth * (size_t)gBytesPerPixel;
-    for (int i = 0; i < rectCount; ++i) {
-        int x = rects[i].x, y = rects[i].y, w = rects[i].w, h = rects[i].h;
-        size_t rowBytes = (size_t)w * (size_t)gBytesPerPixel;
-        for (int r = 0; r < h; ++r) {
-            uint8_t *dst = (uint8_t *)gFrontBuffer + (size_t)(y + r) * fbBPR + (size_t)x * gBytesPerPixel;
-            uint8_t *src = (uint8_t *)gBackBuffer + (size_t)(y + r) * fbBPR + (size_t)x * gBytesPerPixel;
-            memcpy(dst, src, rowBytes);
-        }
+static rfbBool resumeNewClient(rfbClientPtr cl, void **data) {
+    (void)cl;
+    *data = calloc(1, sizeof(TVResumeClient));
+    return *data != NULL;
+}
+
+// Enabled for every client, so every pseudo-encoding unknown to libvncserver passes through here.
+static rfbBool resumeEnablePseudoEncoding(rfbClientPtr cl, void **data, int encoding) {
+    TVResumeClient *rc = (TVResumeClient *)*data;
+    if (!rc || encoding == 0)
+        return FALSE;
+    const int family = encoding & (int)0xFFFF0000;
+    const uint32_t value = (uint32_t)encoding & 0xFFFF;
+    if (encoding == cResumeEncoding) {
+        rc->tokens = YES;
+    } else if (family == cResumeEpochBase) {
+        rc->epoch = (uint16_t)value;
+        rc->haveEpoch = YES;
+    } else if (family == cResumeGenHiBase) {
+        rc->generation = (rc->generation & 0xFFFF) | value << 16;
+        rc->haveHi = YES;
+    } else if (family == cResumeGenLoBase) {
+        rc->generation = (rc->generation & 0xFFFF0000) | value;
+        rc->haveLo = YES;
+    } else {
+        return FALSE;
     }
+    resumeApplyToken(cl, rc);
+    return TRUE;
+}
+
+static void resumeClose(rfbClientPtr cl, void *data) {
+    (void)cl;
+    free(data);
+}
+
+// After an update that left nothing pending the client holds at least generation g: report it as its token.
+// g is read before the check, since the marks of a generation precede its commit.
+static void resumeReportToken(rfbClientPtr cl) {
+    TVResumeClient *rc = (TVResumeClient *)rfbGetExtensionClientData(cl, &gResumeExtension);
+    if (!rc || !rc->tokens)
+        return;
+    const uint32_t generation = gFrameGeneration.load(std::memory_order_acquire);
+    if (generation == rc->lastReported)
+        return;
+    pthread_mutex_lock(&cl->updateMutex);
+    BOOL settled = sraRgnEmpty(cl->modifiedRegion) && sraRgnEmpty(cl->copyRegion);
+    pthread_mutex_unlock(&cl->updateMutex);
+    if (!settled)
+        return;
+    uint8_t msg[8] = {cResumeTokenMsgType, 0, (uint8_t)(gResumeEpoch >> 8), (uint8_t)gResumeEpoch};
+    msg[4] = (uint8_t)(generation >> 24);
+    msg[5] = (uint8_t)(generation >> 16);
+    msg[6] = (uint8_t)(generation >> 8);
+    msg[7] = (uint8_t)generation;
+    if (rfbWriteExact(cl, (const char *)msg, (int)sizeof(msg)) == 1)
+        rc->lastReported = generation;
 }
 
 #pragma mark - Display Hooks
 
 static std::atomic<int> gInflight(0);
 
-// Track encode life-cycle to provide backpressure via inflight counter
+// Track encode life-cycle to provide backpressure via inflight counter, and pin the frames the update may read
 static void displayHook(rfbClientPtr cl) {
-    (void)cl;
+    readerPin(cl);
+    TVResumeClient *rc = (TVResumeClient *)rfbGetExtensionClientData(cl, &gResumeExtension);
+    if (rc)
+        rc->updateSent = YES;
     gInflight.fetch_add(1, std::memory_order_relaxed);
 }
 
 static void displayFinishedHook(rfbClientPtr cl, int result) {
-    (void)cl;
-    (void)result;
+    if (result)
+        resumeReportToken(cl);
+    readerUnpin(cl);
+    // A dropped frame is otherwise lost when the screen goes static: capture it again now that a buffer may be free
+    if (gPublishRetry.load() && gPublishRetry.exchange(false))
+        [[ScreenCapturer sharedCapturer] forceNextFrameUpdate];
     gInflight.fetch_sub(1, std::memory_order_relaxed);
 }
 
@@ -1935,15 +2463,21 @@ static int setDesktopSizeHook(int width, int height, int numScreens, rfbExtDeskt
 #pragma mark - Display Tiling Constants
 
 // Hashing performance controls
-static const int cHashStrideX = 4;              // sparse sampling stride X (>=1; 1 = full scan)
-static const int cHashStrideY = 4;              // sparse sampling stride Y (>=1; 1 = full scan)
-static const BOOL cSparseHashDuringDefer = YES; // use sparse hashing while within defer window
+static const int cHashStrideX = 4;              // sparse sampling stride X for idle tiles (>=1; 1 = full scan)
+static const int cHashStrideY = 4;              // sparse sampling stride Y for idle tiles (>=1; 1 = full scan)
+static const BOOL cSparseHashDuringDefer = YES; // sample sparsely against the published frame within defer window
+static const int cFocusRadiusPx = 96;           // touch neighbourhood sampled at every pixel and flushed early
+static const double cFocusHoldSec = 0.5;        // focus stays this long after the last touch or drag
 // Skip vImage scaling when src/dst size difference is small; copy with pad/crop instead
 static const int cNoScalePadThresholdPx = 8; // if both |dW| and |dH| <= this, do pad/crop copy
 
 // Flush-time hashing optimization
 static const BOOL cParallelHashOnFlush = YES; // use parallel hashing at flush to reduce wall time
 
+// Source-space damage: fall back to a full rotate/scale when damage is widespread
+static const int cSourcePartialMaxPercent = 40; // max % of changed source tiles for a partial render
+static const int cSourcePartialMaxRects = 64;   // max source rects for a partial render
+
 #pragma mark - Frame Handlers
 
 static std::atomic<int> gRotationQuad(0); // 0=0°, 1=90°, 2=180°, 3=270° (clockwise)
@@ -1951,6 +2485,9 @@ static void *gRotateScratch = NULL;       // rotation scratch (for 90°/270°)
 static size_t gRotateScratchSize = 0;     // bytes
 static void *gScaleTemp = NULL;           // vImage scale temp buffer
 static size_t gScaleTempSize = 0;         // bytes
+static FrameResampler gResampler;         // downscale (fused with rotation) unless vImage scales (-S hq)
+static double gScaleMsTotal = 0.0;        // full-frame scale (or rotate + scale) time since the last stats log
+static int gScaleFrames = 0;              // frames in gScaleMsTotal
 
 // Align width up to a multiple of 4 (helps encoders/clients). Preserve aspect by adjusting height.
 NS_INLINE void alignDimensions(int rawW, int rawH, int *alignedW, int *alignedH) {
@@ -1968,89 +2505,92 @@ NS_INLINE void alignDimensions(int rawW, int rawH, int *alignedW, int *alignedH)
     *alignedH = hAdj;
 }
 
-// Resize framebuffer according to rotation (0/180 keep WxH from src, 90/270 swap), then apply scale
-NS_INLINE void maybeResizeFramebufferForRotation(int rotQ) {
-    // Source capture size (portrait-orientated)
-    int srcW = gSrcWidth;
-    int srcH = gSrcHeight;
-    if (srcW <= 0 || srcH <= 0)
+// Output size for a rotation: 0/180 keep WxH from src, 90/270 swap, then scale and align (width multiple of 4)
+NS_INLINE void outputSizeForRotation(int rotQ, int *outW, int *outH) {
+    int rotW = (rotQ % 2 == 0) ? gSrcWidth : gSrcHeight;
+    int rotH = (rotQ % 2 == 0) ? gSrcHeight : gSrcWidth;
+    int outWraw = (gScale > 0.0 && gScale < 1.0) ? MAX(1, (int)floor((double)rotW * gScale)) : rotW;
+    int outHraw = (gScale > 0.0 && gScale < 1.0) ? MAX(1, (int)floor((double)rotH * gScale)) : rotH;
+    alignDimensions(outWraw, outHraw, outW, outH);
+}
+
+// Heap framebuffers hold the output of either orientation (when orientation sync may rotate it), so a quarter turn
+// keeps reusing the same buffers.
+static size_t framebufferCapacity(void) {
+    size_t capacity = 0;
+    for (int rotQ = 0; rotQ < (gOrientationSyncEnabled ? 2 : 1); ++rotQ) {
+        int w = 0, h = 0;
+        outputSizeForRotation(rotQ, &w, &h);
+        capacity = MAX(capacity, framebufferBytesPerRow(w, h) * (size_t)h);
+    }
+    return capacity;
+}
+
+// Rotation to first frame: when the orientation update arrived, and its latency once the frame is published
+static std::atomic<CFAbsoluteTime> gRotationRequestedAt(0.0); // 0: no rotation in progress
+static CFTimeInterval gRotationResizeMs = 0.0;                  // maybeResize time of the rotation in progress
+
+static void logRotationLatency(int rotQ) {
+    CFAbsoluteTime requestedAt = gRotationRequestedAt.exchange(0.0);
+    if (requestedAt <= 0.0)
         return;
+    TVLogVerbose(@"rotation to first frame: %.3f ms (rotQ=%d, %dx%d, resize %.3f ms, heap buffers=%d)",
+                 (CFAbsoluteTimeGetCurrent() - requestedAt) * 1000.0, rotQ, gWidth, gHeight, gRotationResizeMs,
+                 gHeapBuffers);
+    gRotationResizeMs = 0.0;
+}
 
-    // Rotate at source dimension stage
-    int rotW = (rotQ % 2 == 0) ? srcW : srcH;
-    int rotH = (rotQ % 2 == 0) ? srcH : srcW;
+// Switch the output geometry according to rotation. Framebuffers and scratch buffers are sized for both orientations
+// up front, so this neither allocates nor clears: the frame about to be rendered into the back buffer is published
+// with the new size (publishBackBuffer). Returns NO when it has to wait for a free buffer.
+NS_INLINE BOOL maybeResizeFramebufferForRotation(int rotQ) {
+    if (gSrcWidth <= 0 || gSrcHeight <= 0)
+        return YES;
 
-    // Apply output scaling then align width to multiple of 4 (adjust height to preserve aspect)
-    int outWraw = (gScale > 0.0 && gScale < 1.0) ? MAX(1, (int)floor((double)rotW * gScale)) : rotW;
-    int outHraw = (gScale > 0.0 && gScale < 1.0) ? MAX(1, (int)floor((double)rotH * gScale)) : rotH;
     int outW = 0, outH = 0;
-    alignDimensions(outWraw, outHraw, &outW, &outH);
-
+    outputSizeForRotation(rotQ, &outW, &outH);
     if (outW == gWidth && outH == gHeight)
-        return; // no change
-
-    // Allocate new double buffers
-    size_t newFBSize = (size_t)outW * (size_t)outH * (size_t)gBytesPerPixel;
-    void *newFront = calloc(1, newFBSize);
-    void *newBack = calloc(1, newFBSize);
-    if (!newFront || !newBack) {
-        if (newFront)
-            free(newFront);
-        if (newBack)
-            free(newBack);
-        TVPrintError("Failed to allocate required frame buffers");
-        exit(EXIT_FAILURE);
-    }
+        return YES; // no change
 
-    // Swap buffers into screen & notify clients
-    gWidth = outW;
-    gHeight = outH;
-    gFBSize = newFBSize;
+    CFAbsoluteTime tResize0 = CFAbsoluteTimeGetCurrent();
 
-    if (gScreen) {
-        // Update server with new framebuffer
-        rfbNewFramebuffer(gScreen, (char *)newFront, gWidth, gHeight, 8, 3, gBytesPerPixel);
-        // Restore BGRA little-endian channel layout (R shift=16, G=8, B=0)
-        int bps = 8;
-        gScreen->serverFormat.redShift = bps * 2;   // 16
-        gScreen->serverFormat.greenShift = bps * 1; // 8
-        gScreen->serverFormat.blueShift = 0;        // 0
-        gScreen->paddedWidthInBytes = gWidth * gBytesPerPixel;
+    // A capture adopted as the back buffer (-z) has the capture's geometry: render into a heap buffer instead
+    if (gBackSurface) {
+        void *buffer = takeFreeBufferOrRetry();
+        if (!buffer)
+            return NO;
+        recycleFramebuffer(gBackBuffer, gBackSurface); // never published
+        gBackBuffer = buffer;
+        gBackSurface = NULL;
     }
 
-    // Free old buffers and store new pointers
-    if (gFrontBuffer)
-        free(gFrontBuffer);
-    if (gBackBuffer)
-        free(gBackBuffer);
-    gFrontBuffer = newFront;
-    gBackBuffer = newBack;
-
-    // Keep gScreen->frameBuffer in sync (rfbNewFramebuffer already did, but ensure local)
-    if (gScreen)
-        gScreen->frameBuffer = (char *)gFrontBuffer;
+    gWidth = outW;
+    gHeight = outH;
+    gFBBytesPerRow = framebufferBytesPerRow(outW, outH);
+    gFBSize = gFBBytesPerRow * (size_t)outH;
 
     // Re-init tiling/hash state for new geometry
     initializeTilingOrReset();
     // Clear pending dirty flags to avoid carrying over old-geometry state into the new geometry
-    if (gPendingDirty)
-        memset(gPendingDirty, 0, gTileCount);
+    gTileDiff.clearPending();
 
     gHasPending = NO;
+    gRotationResizeMs = (CFAbsoluteTimeGetCurrent() - tResize0) * 1000.0;
     TVLog(@"Resize: framebuffer changed to %dx%d (rotQ=%d, scale=%.3f)", gWidth, gHeight, rotQ, gScale);
+    return YES;
 }
 
-// Ensure scratch buffer for rotation is available and large enough
+// Ensure scratch buffer for rotation is available and large enough (contents are overwritten by each rotation)
 NS_INLINE int ensureRotateScratch(size_t w, size_t h) {
     size_t need = w * h * (size_t)gBytesPerPixel;
     if (need == 0)
         return -1;
     if (gRotateScratchSize >= need && gRotateScratch)
         return 0;
-    void *nbuf = realloc(gRotateScratch, need);
-    memset(nbuf, 0, need);
+    void *nbuf = malloc(need);
     if (!nbuf)
         return -1;
+    free(gRotateScratch);
     gRotateScratch = nbuf;
     gRotateScratchSize = need;
     return 0;
@@ -2073,108 +2613,505 @@ NS_INLINE int ensureScaleTemp(size_t srcW, size_t srcH, size_t dstW, size_t dstH
         return 0;
     if (gScaleTempSize >= nbytes && gScaleTemp)
         return 0;
-    void *nbuf = realloc(gScaleTemp, nbytes);
-    memset(nbuf, 0, nbytes);
+    void *nbuf = malloc(nbytes);
     if (!nbuf)
         return -1;
+    free(gScaleTemp);
     gScaleTemp = nbuf;
     gScaleTempSize = nbytes;
     return 0;
 }
 
-// Row-by-row copy to convert a possibly-strided captured buffer into a tightly packed VNC buffer.
+// Size the rotation scratch and the vImage scale temp for the largest frame of both orientations, so the first
+// frame after a rotation allocates nothing.
+static void prepareTransformScratch(void) {
+    for (int rotQ = 0; rotQ < (gOrientationSyncEnabled ? 2 : 1); ++rotQ) {
+        int rotW = (rotQ % 2 == 0) ? gSrcWidth : gSrcHeight;
+        int rotH = (rotQ % 2 == 0) ? gSrcHeight : gSrcWidth;
+        int outW = 0, outH = 0;
+        outputSizeForRotation(rotQ, &outW, &outH);
+        if (rotQ != 0 && ensureRotateScratch((size_t)rotW, (size_t)rotH) != 0)
+            TVLog(@"Failed to preallocate the rotation scratch (%dx%d)", rotW, rotH);
+        // vImage scales (-S hq) unrotated frames and the damaged regions of partial renders
+        if (gScaleQuality == TVScaleQualityHigh && (outW != rotW || outH != rotH) &&
+            ensureScaleTemp((size_t)rotW, (size_t)rotH, (size_t)outW, (size_t)outH, kvImageHighQualityResampling) != 0)
+            TVLog(@"Failed to preallocate the scale temp buffer (%dx%d -> %dx%d)", rotW, rotH, outW, outH);
+    }
+}
+
+NS_INLINE uint8_t rotationConstantForQuad(int rotQ) {
+    switch (rotQ & 3) {
+    case 1:
+        return kRotate90DegreesClockwise;
+    case 2:
+        return kRotate180DegreesClockwise;
+    case 3:
+        return kRotate270DegreesClockwise;
+    default:
+        return kRotate0DegreesClockwise;
+    }
+}
+
+// Whether a rotated stage of this size reaches the back buffer by copy or pad/crop (no vImage scaling).
+// Mirrors the branch selection in handleFramebuffer.
+NS_INLINE BOOL stageCopiesUnscaled(int stageW, int stageH) {
+    int dW = gWidth - stageW;
+    int dH = gHeight - stageH;
+    if (dW == 0 && dH == 0 && gScale == 1.0)
+        return YES;
+    return cNoScalePadThresholdPx > 0 && abs(dW) <= cNoScalePadThresholdPx && abs(dH) <= cNoScalePadThresholdPx;
+}
+
+// Banded vImageRotate90 on the pool: each chunk rotates the source strip that lands on one band of dst rows.
+// With hashTiles (dst is the back buffer), bands are tile rows, hashed while still in cache. Returns the first error.
+static vImage_Error rotateParallel(const vImage_Buffer *src, const vImage_Buffer *dst, int rotQ, BOOL hashTiles) {
+    const int bandRows = hashTiles ? gTileDiff.tileSize() : cPoolBandRows;
+    const int rows = (int)dst->height;
+    const int bands = (rows + bandRows - 1) / bandRows;
+    const uint8_t rotConst = rotationConstantForQuad(rotQ);
+    const size_t bpp = (size_t)gBytesPerPixel;
+    if (hashTiles)
+        gTileDiff.resetCurrentHashes();
+
+    std::atomic<vImage_Error> firstErr(kvImageNoError);
+    workerPool()->parallelFor(bands, [&](int band) {
+        int y0 = band * bandRows;
+        int y1 = MIN(rows, y0 + bandRows);
+        DirtyRect strip = DamageMapper::unrotateRect(DirtyRect{0, y0, (int)dst->width, y1 - y0}, (int)src->width,
+                                                     (int)src->height, rotQ);
+        vImage_Buffer sb = {.data = (uint8_t *)src->data + (size_t)strip.y * src->rowBytes + (size_t)strip.x * bpp,
+                            .height = (vImagePixelCount)strip.h,
+                            .width = (vImagePixelCount)strip.w,
+                            .rowBytes = src->rowBytes};
+        vImage_Buffer db = {.data = (uint8_t *)dst->data + (size_t)y0 * dst->rowBytes,
+                            .height = (vImagePixelCount)(y1 - y0),
+                            .width = dst->width,
+                            .rowBytes = dst->rowBytes};
+        uint8_t bg[4] = {0, 0, 0, 0};
+        // The pool already splits the frame; keep vImage from spawning its own threads per band
+        vImage_Error err = vImageRotate90_ARGB8888(&sb, &db, rotConst, bg, kvImageDoNotTile);
+        if (err != kvImageNoError) {
+            vImage_Error none = kvImageNoError;
+            firstErr.compare_exchange_strong(none, err);
+            return;
+        }
+        if (hashTiles) {
+            for (int y = y0; y < y1; ++y)
+                gTileDiff.hashRow((const uint8_t *)db.data + (size_t)(y - y0) * db.rowBytes, y);
+        }
+    });
+    return firstErr.load();
+}
+
+// -S: FrameResampler filter for scaled output of this rotated-space size. Returns NO when vImage scales instead
+// (hq without rotation); rotated hq frames are area-averaged in one pass rather than rotated, then scaled.
+static BOOL scaleFilterForStage(int rotW, int rotH, BOOL rotated, ResampleFilter *outFilter) {
+    switch (gScaleQuality) {
+    case TVScaleQualityFast:
+        *outFilter = ResampleFilter::Box;
+        return YES;
+    case TVScaleQualityBalanced:
+        // An integer divisor makes the box filter exact, and sharper than bilinear beyond 2:1
+        *outFilter = (rotW % gWidth == 0 && rotH % gHeight == 0) ? ResampleFilter::Box : ResampleFilter::Bilinear;
+        return YES;
+    default:
+        *outFilter = ResampleFilter::Area;
+        return rotated;
+    }
+}
+
+NS_INLINE const char *resampleFilterName(ResampleFilter filter) {
+    switch (filter) {
+    case ResampleFilter::Box:
+        return "box";
+    case ResampleFilter::Bilinear:
+        return "bilinear";
+    default:
+        return "area";
+    }
+}
+
+static void logScaleStats(void) {
+    if (!tvncVerboseLoggingEnabled || gScaleFrames == 0)
+        return;
+    static CFAbsoluteTime sLastLog = 0;
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    if (now - sLastLog < cWorkerStatsIntervalSec)
+        return;
+    sLastLog = now;
+    TVLogVerbose(@"scale: %.2f ms/frame over %d frames (-S %s) -> %dx%d", gScaleMsTotal / gScaleFrames, gScaleFrames,
+                 scaleQualityName(gScaleQuality), gWidth, gHeight);
+    gScaleMsTotal = 0.0;
+    gScaleFrames = 0;
+}
+
+// Downscale (fused with rotation) on the pool: bands of output rows resampled straight from the capture into the
+// back buffer, skipping any full-resolution rotated copy. With hashTiles, bands are tile rows, hashed while still in
+// cache.
+static void resampleParallel(const uint8_t *src, size_t srcBPR, int srcW, int srcH, int rotQ, ResampleFilter filter,
+                             BOOL hashTiles, int threads) {
+    gResampler.configure(srcW, srcH, rotQ, gWidth, gHeight, filter);
+    uint8_t *back = (uint8_t *)gBackBuffer;
+    const size_t backBPR = gFBBytesPerRow;
+    const int bandRows = hashTiles ? gTileDiff.tileSize() : cPoolBandRows;
+    const int bands = (gHeight + bandRows - 1) / bandRows;
+    if (hashTiles)
+        gTileDiff.resetCurrentHashes();
+    auto renderBand = [=](int band) {
+        int y0 = band * bandRows;
+        int y1 = MIN(gHeight, y0 + bandRows);
+        gResampler.renderRows(src, srcBPR, back, backBPR, y0, y1);
+        if (hashTiles) {
+            for (int y = y0; y < y1; ++y)
+                gTileDiff.hashRow(back + (size_t)y * backBPR, y);
+        }
+    };
+    if (threads <= 1) {
+        for (int band = 0; band < bands; ++band)
+            renderBand(band);
+        return;
+    }
+    workerPool()->parallelFor(bands, renderBand);
+}
+
+static void *gDamageScratch = NULL;  // scaled output of one damaged region
+static size_t gDamageScratchSize = 0; // bytes
+
+// Rotate/scale one damaged region of the locked capture into the back buffer. Returns NO on failure.
+static BOOL renderDamageJob(const DamageJob *job, const uint8_t *base, size_t srcBPR, int rotQ, BOOL scaled,
+                            BOOL resampled) {
+    const size_t bpp = (size_t)gBytesPerPixel;
+    const size_t backBPR = gFBBytesPerRow;
+    uint8_t *back = (uint8_t *)gBackBuffer;
+    const DirtyRect *rot = &job->rotRender;
+    const DirtyRect *in = &job->dstInterior;
+
+    if (resampled) {
+        // Same kernel as full frames (configured by the caller), so the region matches a full render exactly
+        gResampler.render(base, srcBPR, back, backBPR, *in);
+        return YES;
+    }
+
+    vImage_Buffer stage = {.data = (void *)(base + (size_t)job->srcRect.y * srcBPR + (size_t)job->srcRect.x * bpp),
+                           .height = (vImagePixelCount)job->srcRect.h,
+                           .width = (vImagePixelCount)job->srcRect.w,
+                           .rowBytes = srcBPR};
+    if ((rotQ & 3) != 0) {
+        if (ensureRotateScratch((size_t)rot->w, (size_t)rot->h) != 0)
+            return NO;
+        vImage_Buffer rotBuf = {.data = gRotateScratch,
+                                .height = (vImagePixelCount)rot->h,
+                                .width = (vImagePixelCount)rot->w,
+                                .rowBytes = (size_t)rot->w * bpp};
+        uint8_t bg[4] = {0, 0, 0, 0};
+        if (vImageRotate90_ARGB8888(&stage, &rotBuf, rotationConstantForQuad(rotQ), bg, kvImageNoFlags) !=
+            kvImageNoError)
+            return NO;
+        stage = rotBuf;
+    }
+
+    if (!scaled) {
+        // 1:1 copy, then replicate into the right/bottom padding like copyPadOrCropToTight
+        const size_t copyBytes = (size_t)rot->w * bpp;
+        for (int r = 0; r < rot->h; ++r) {
+            uint8_t *drow = back + (size_t)(rot->y + r) * backBPR + (size_t)rot->x * bpp;
+            memcpy(drow, (const uint8_t *)stage.data + (size_t)r * stage.rowBytes, copyBytes);
+            const uint8_t *lastPx = drow + copyBytes - bpp;
+            for (int x = rot->x + rot->w; x < in->x + in->w; ++x)
+                memcpy(back + (size_t)(rot->y + r) * backBPR + (size_t)x * bpp, lastPx, bpp);
+        }
+        int lastRowY = rot->y + rot->h - 1;
+        const uint8_t *lastRow = back + (size_t)lastRowY * backBPR + (size_t)in->x * bpp;
+        for (int y = lastRowY + 1; y < in->y + in->h; ++y)
+            memcpy(back + (size_t)y * backBPR + (size_t)in->x * bpp, lastRow, (size_t)in->w * bpp);
+        return YES;
+    }
+
+    // Scale the whole render region (interior + halo), then keep the interior only
+    const DirtyRect *rend = &job->dstRender;
+    const size_t tmpBPR = (size_t)rend->w * bpp;
+    size_t need = tmpBPR * (size_t)rend->h;
+    if (gDamageScratchSize < need || !gDamageScratch) {
+        void *nbuf = realloc(gDamageScratch, need);
+        if (!nbuf)
+            return NO;
+        gDamageScratch = nbuf;
+        gDamageScratchSize = need;
+    }
+    vImage_Buffer tmp = {.data = gDamageScratch,
+                         .height = (vImagePixelCount)rend->h,
+                         .width = (vImagePixelCount)rend->w,
+                         .rowBytes = tmpBPR};
+    if (ensureScaleTemp(stage.width, stage.height, tmp.width, tmp.height, kvImageHighQualityResampling) != 0)
+        return NO;
+    if (vImageScale_ARGB8888(&stage, &tmp, gScaleTemp, kvImageHighQualityResampling) != kvImageNoError)
+        return NO;
+    for (int r = 0; r < in->h; ++r) {
+        const uint8_t *srow =
+            (const uint8_t *)gDamageScratch + (size_t)(in->y - rend->y + r) * tmpBPR + (size_t)(in->x - rend->x) * bpp;
+        memcpy(back + (size_t)(in->y + r) * backBPR + (size_t)in->x * bpp, srow, (size_t)in->w * bpp);
+    }
+    return YES;
+}
+
+// Source-space damage (-X space=source): hash the portrait capture against the previous one and mark the output
+// tiles it maps to. While the back buffer holds the complete previous frame and damage is small, rotate/scale only
+// the damaged regions into it. Returns NO when the caller has to render the full frame.
+static BOOL renderSourceDamage(const uint8_t *base, size_t srcBPR, int srcW, int srcH, int rotQ) {
+    gSrcTileDiff.configure(srcW, srcH, gSrcTileSize, gBytesPerPixel);
+    hashTiledFromBufferParallel(&gSrcTileDiff, base, srcBPR, cParallelHashOnFlush ? tileWorkerThreads() : 1);
+
+    // Rects are merged down to the limit when needed, so the list always covers the damage
+    DirtyRect srcRects[cSourcePartialMaxRects];
+    int changedTiles = 0;
+    int rectCount = gSrcTileDiff.buildDirtyRects(srcRects, cSourcePartialMaxRects, &changedTiles);
+    gSrcTileDiff.swapHashes();
+
+    gTileDiff.resetChanged();
+    if (!gBackBufferInSync) {
+        // Back buffer content is unknown (first frame, rotation, failed render): everything changed
+        gTileDiff.markChanged(DirtyRect{0, 0, gWidth, gHeight});
+        return NO;
+    }
+
+    size_t totalTiles = gSrcTileDiff.tileCount();
+    BOOL partial = rectCount < cSourcePartialMaxRects && totalTiles > 0 &&
+                   (size_t)changedTiles * 100 < totalTiles * (size_t)cSourcePartialMaxPercent;
+
+    int rotW = (rotQ % 2 == 0) ? srcW : srcH;
+    int rotH = (rotQ % 2 == 0) ? srcH : srcW;
+    BOOL scaled = !stageCopiesUnscaled(rotW, rotH);
+    // Resampling halo in rotated-space pixels: Lanczos5 support at the downscale factor. FrameResampler filters
+    // read at most one pixel beyond the footprint of each output pixel.
+    ResampleFilter filter = ResampleFilter::Area;
+    const BOOL resampled = scaled && scaleFilterForStage(rotW, rotH, (rotQ & 3) != 0, &filter);
+    double factor = MAX(1.0, MAX((double)rotW / (double)gWidth, (double)rotH / (double)gHeight));
+    int halo = resampled ? 2 : scaled ? (int)ceil(5.0 * factor) + 1 : 0;
+    if (resampled)
+        gResampler.configure(srcW, srcH, rotQ, gWidth, gHeight, filter);
+
+    DamageMapper mapper;
+    mapper.configure(srcW, srcH, rotQ, gWidth, gHeight, scaled, halo);
+    for (int i = 0; i < rectCount; ++i) {
+        DamageJob job;
+        if (!mapper.map(srcRects[i], &job))
+            continue;
+        if (partial && !renderDamageJob(&job, base, srcBPR, rotQ, scaled, resampled))
+            partial = NO; // fall back to a full render, keep marking
+        gTileDiff.markChanged(job.dstInterior);
+    }
+
+    TVLogVerbose(@"source damage: %d rects, %d/%zu tiles -> %@", rectCount, changedTiles, totalTiles,
+                 partial ? @"partial" : @"full render");
+    if (!partial)
+        gBackBufferInSync = NO; // until the full render lands
+    return partial;
+}
+
+// Row-by-row copy to convert a possibly-strided captured buffer into a VNC buffer (tightly packed, or at the
+// capture stride under -z).
 NS_INLINE void copyWithStrideTight(uint8_t *dstTight, const uint8_t *src, int width, int height,
                                    size_t srcBytesPerRow) {
-    size_t dstBPR = (size_t)width * gBytesPerPixel;
+    size_t dstBPR = gFBBytesPerRow;
+    size_t rowBytes = (size_t)width * gBytesPerPixel;
     for (int y = 0; y < height; ++y) {
-        memcpy(dstTight + (size_t)y * dstBPR, src + (size_t)y * srcBytesPerRow, dstBPR);
+        memcpy(dstTight + (size_t)y * dstBPR, src + (size_t)y * srcBytesPerRow, rowBytes);
     }
 }
 
+// Fused copy + tile hash: each row is hashed right after it is copied, while it is still in cache,
+// so dirty detection does not read the back buffer again. One pool chunk per tile row like the parallel hash.
+NS_INLINE void copyWithStrideTightHashed(uint8_t *dstTight, const uint8_t *src, int width, int height,
+                                         size_t srcBytesPerRow, int threads) {
+    const size_t dstBPR = gFBBytesPerRow;
+    const size_t rowBytes = (size_t)width * gBytesPerPixel;
+    const int tileSize = gTileDiff.tileSize();
+    const int tilesY = gTileDiff.tilesY();
+    gTileDiff.resetCurrentHashes();
+    auto copyTileRow = [=](int ty) {
+        int endY = MIN((ty + 1) * tileSize, height);
+        for (int y = ty * tileSize; y < endY; ++y) {
+            uint8_t *drow = dstTight + (size_t)y * dstBPR;
+            memcpy(drow, src + (size_t)y * srcBytesPerRow, rowBytes);
+            gTileDiff.hashRow(drow, y);
+        }
+    };
+    if (threads <= 1) {
+        for (int ty = 0; ty < tilesY; ++ty)
+            copyTileRow(ty);
+        return;
+    }
+    workerPool()->parallelFor(tilesY, copyTileRow);
+}
+
 // Copy with small pad/crop to avoid expensive scaling when sizes are close.
 // Strategy:
 // - Copy overlap region at (0,0) with width=min(srcW,dstW), height=min(srcH,dstH)
 // - If dst wider, horizontally replicate the last pixel in each row to fill the right pad.
 // - If dst taller, vertically replicate the last valid row to fill the bottom pad.
+// - If hashTiles, fold each finished row into the tile hashes (fused copy + hash).
+// Bands of rows run on the pool (tile rows when hashing); padding rows are rebuilt from the source,
+// so no band reads another band's output.
 NS_INLINE void copyPadOrCropToTight(uint8_t *dstTight, int dstW, int dstH, const uint8_t *src, int srcW, int srcH,
-                                    size_t srcBytesPerRow) {
+                                    size_t srcBytesPerRow, BOOL hashTiles, int threads) {
     const int bpp = gBytesPerPixel;
-    const size_t dstBPR = (size_t)dstW * (size_t)bpp;
+    const size_t dstBPR = gFBBytesPerRow;
     const int overlapW = srcW < dstW ? srcW : dstW;
     const int overlapH = srcH < dstH ? srcH : dstH;
+    if (overlapW <= 0 || overlapH <= 0)
+        return;
 
-    // 1) Copy overlap region row-by-row
-    if (overlapW > 0 && overlapH > 0) {
-        const size_t copyBytes = (size_t)overlapW * (size_t)bpp;
-        for (int y = 0; y < overlapH; ++y) {
+    const size_t copyBytes = (size_t)overlapW * (size_t)bpp;
+    const int bandRows = hashTiles ? gTileDiff.tileSize() : cPoolBandRows;
+    const int bands = (dstH + bandRows - 1) / bandRows;
+    auto copyBand = [=](int band) {
+        int endY = MIN((band + 1) * bandRows, dstH);
+        for (int y = band * bandRows; y < endY; ++y) {
             uint8_t *drow = dstTight + (size_t)y * dstBPR;
-            const uint8_t *srow = src + (size_t)y * srcBytesPerRow;
+            // 1) Copy the overlap; 3) rows below it replicate the last valid row
+            const uint8_t *srow = src + (size_t)MIN(y, overlapH - 1) * srcBytesPerRow;
             memcpy(drow, srow, copyBytes);
             // 2) Right pad by replicating last pixel if needed
             if (dstW > overlapW) {
-                const uint8_t *lastPx = (overlapW > 0) ? (drow + ((size_t)overlapW - 1) * (size_t)bpp) : drow;
+                const uint8_t *lastPx = drow + ((size_t)overlapW - 1) * (size_t)bpp;
                 for (int x = overlapW; x < dstW; ++x) {
                     memcpy(drow + (size_t)x * (size_t)bpp, lastPx, (size_t)bpp);
                 }
             }
+            if (hashTiles)
+                gTileDiff.hashRow(drow, y);
         }
+    };
+    if (threads <= 1) {
+        for (int band = 0; band < bands; ++band)
+            copyBand(band);
+        return;
     }
-
-    // 3) Bottom pad by replicating last valid row if needed
-    if (dstH > overlapH) {
-        uint8_t *lastRow = (overlapH > 0) ? (dstTight + (size_t)(overlapH - 1) * dstBPR) : dstTight;
-        for (int y = overlapH; y < dstH; ++y) {
-            uint8_t *drow = dstTight + (size_t)y * dstBPR;
-            memcpy(drow, lastRow, dstBPR);
-        }
-    }
+    workerPool()->parallelFor(bands, copyBand);
 }
 
-NS_INLINE void swapBuffers(void) {
-    void *tmp = gFrontBuffer;
-    gFrontBuffer = gBackBuffer;
-    gBackBuffer = tmp;
-    gScreen->frameBuffer = (char *)gFrontBuffer;
+// Neighbourhood of the last touch or drag, if recent enough. Returns NO when there is no focus.
+NS_INLINE BOOL pointerFocusRect(DirtyRect *out) {
+    double t = gFocusTime.load(std::memory_order_relaxed);
+    if (t <= 0.0 || CFAbsoluteTimeGetCurrent() - t > cFocusHoldSec)
+        return NO;
+    uint32_t p = gFocusPoint.load(std::memory_order_relaxed);
+    int x = (int)(p & 0xFFFF), y = (int)(p >> 16);
+    int x0 = MAX(0, x - cFocusRadiusPx), y0 = MAX(0, y - cFocusRadiusPx);
+    int x1 = MIN(gWidth, x + cFocusRadiusPx + 1), y1 = MIN(gHeight, y + cFocusRadiusPx + 1);
+    if (x1 <= x0 || y1 <= y0)
+        return NO;
+    *out = DirtyRect{x0, y0, x1 - x0, y1 - y0};
+    return YES;
 }
 
-// Try to acquire all clients' sendMutex without blocking.
-// Returns 1 on success and fills locked[] with acquired mutexes (count in *lockedCount),
-// otherwise returns 0 and releases any partial locks.
-static int tryLockAllClients(pthread_mutex_t **locked, size_t *lockedCount, size_t capacity) {
-    *lockedCount = 0;
-    rfbClientIteratorPtr it = rfbGetClientIterator(gScreen);
-    rfbClientPtr cl;
-
-    int ok = 1;
-    while ((cl = rfbClientIteratorNext(it))) {
-        if (*lockedCount >= capacity) {
-            ok = 0;
-            break;
-        }
-        pthread_mutex_t *m = &cl->sendMutex;
-        if (pthread_mutex_trylock(m) == 0) {
-            locked[(*lockedCount)++] = m;
-        } else {
-            ok = 0;
-            break;
-        }
-    }
-
-    rfbReleaseClientIterator(it);
+// Scroll detection (-X scroll=on), motion search (-X motion=on) and duplicate tiles (-X dedup=on)
+static ScrollDetector gScrollDetector;
+static MotionEstimator gMotionEstimator;
+static DuplicateTileFinder gDuplicateTiles;
+static uint64_t gScrollBytesSaved = 0;         // raw pixel bytes sent as CopyRect instead of encoded (verbose log)
+static const int cScrollMinChangedPct = 10;    // only look for scrolling in updates at least this large
+static const int cScrollMinLines = 16;         // shortest moved run, in lines
+static const int cScrollMinVotes = 8;          // lines that must agree on the offset
+static const int cMaxMoves = 16;               // moved rects per update (one shared offset)
+static const double cMotionBudgetSec = 0.002;  // motion search time per flush without a defer window
+static const double cMotionBudgetMinSec = 0.0005;
+static const double cMotionBudgetMaxSec = 0.004;
+
+// Time the motion search may take at a flush: a quarter of the defer window (clamped), so a deferred flush is
+// held back by a fraction of the window at most.
+NS_INLINE MotionEstimator::Deadline motionSearchDeadline(void) {
+    double budget = cMotionBudgetSec;
+    if (gDeferWindowSec > 0)
+        budget = MAX(cMotionBudgetMinSec, MIN(cMotionBudgetMaxSec, gDeferWindowSec * 0.25));
+    return std::chrono::steady_clock::now() +
+           std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(budget));
+}
 
-    if (!ok) {
-        // release any that were acquired
-        for (size_t i = 0; i < *lockedCount; ++i) {
-            pthread_mutex_unlock(locked[i]);
-        }
-        *lockedCount = 0;
+// Look for content of the published frame (front) that moved inside the dirty area of the new frame (back):
+// whole-line scrolling first, then a 2D block search for translated regions, then dirty tiles that exist
+// elsewhere on screen. On a hit, rects become the dirty area left after the moves (at most maxRects).
+// Returns the move count (up to cMaxMoves).
+static int detectMoves(DirtyRect *rects, int *rectCount, int maxRects, int rotQ, int changedPct, DirtyRect *moves,
+                       int *outDx, int *outDy) {
+    int x0 = gWidth, y0 = gHeight, x1 = 0, y1 = 0;
+    for (int i = 0; i < *rectCount; ++i) {
+        x0 = MIN(x0, rects[i].x);
+        y0 = MIN(y0, rects[i].y);
+        x1 = MAX(x1, rects[i].x + rects[i].w);
+        y1 = MAX(y1, rects[i].y + rects[i].h);
+    }
+    if (x1 <= x0 || y1 <= y0)
         return 0;
-    }
+    DirtyRect region = {x0, y0, x1 - x0, y1 - y0};
+
+    // Content scrolls vertically in UI space. The output is upright when orientation sync applies the UI rotation;
+    // without it the UI may lie sideways in the portrait capture, so the other axis is tried as well.
+    const uint8_t *back = (const uint8_t *)gBackBuffer;
+    const uint8_t *front = (const uint8_t *)gFrontBuffer;
+    const size_t bpr = gFBBytesPerRow;
+    int moveCount = 0;
+    const char *kind = "scroll";
+    if (gScrollDetect && changedPct >= cScrollMinChangedPct) {
+        BOOL horizontal = (((gRotationQuad.load(std::memory_order_relaxed) & 3) - rotQ) & 1) != 0;
+        gScrollDetector.configure(cScrollMinLines, cScrollMinVotes);
+        moveCount = gScrollDetector.detect(back, front, bpr, gBytesPerPixel, region, horizontal, moves, cMaxMoves,
+                                           outDx, outDy);
+        if (moveCount == 0 && !gOrientationSyncEnabled)
+            moveCount = gScrollDetector.detect(back, front, bpr, gBytesPerPixel, region, !horizontal, moves,
+                                               cMaxMoves, outDx, outDy);
+    }
+    if (moveCount == 0 && gMotionSearch) {
+        gMotionEstimator.configure(gWidth, gHeight, gTileDiff.tileSize(), gBytesPerPixel);
+        moveCount = gMotionEstimator.search(back, front, bpr, rects, *rectCount, motionSearchDeadline(), moves,
+                                            cMaxMoves, outDx, outDy);
+        kind = "motion";
+        TVLogVerbose(@"motion: %llu probes, %d moves", (unsigned long long)gMotionEstimator.lastProbes(), moveCount);
+    }
+    if (moveCount == 0 && gDedupTiles && gTileDiff.diffMode() == TileDiffMode::Hash) {
+        int tiles = 0;
+        gDuplicateTiles.configure(gWidth, gHeight, gTileDiff.tileSize(), gBytesPerPixel);
+        moveCount = gDuplicateTiles.find(gTileDiff.currentHashes(), gTileDiff.previousHashes(), back, front, bpr,
+                                         rects, *rectCount, moves, cMaxMoves, outDx, outDy, &tiles);
+        kind = "dedup";
+        TVLogVerbose(@"dedup: %d tiles deduplicated", tiles);
+    }
+    if (moveCount == 0)
+        return 0;
+
+    static std::vector<DirtyRect> sRemainder;
+    sRemainder.resize((size_t)maxRects);
+    int remaining = ScrollDetector::subtractRects(rects, *rectCount, moves, moveCount, sRemainder.data(), maxRects);
+    if (remaining < 0)
+        return 0; // too fragmented to be worth it
+    memcpy(rects, sRemainder.data(), (size_t)remaining * sizeof(DirtyRect));
+    *rectCount = remaining;
+    gMotionEstimator.remember(*outDx, *outDy);
+
+    uint64_t moved = rectsArea(moves, moveCount);
+    gScrollBytesSaved += moved * (uint64_t)gBytesPerPixel;
+    TVLogVerbose(@"%s: %d moves by (%d,%d), %llu px copied, %d rects left (saved %llu bytes raw so far)", kind,
+                 moveCount, *outDx, *outDy, (unsigned long long)moved, remaining,
+                 (unsigned long long)gScrollBytesSaved);
+    return moveCount;
+}
 
-    return 1;
+// Tell clients to copy moved content (destination rects; source is offset by -dx,-dy). Call before marking the rest,
+// with clients locked (publishBackBuffer).
+NS_INLINE void scheduleScrollMoves(const DirtyRect *moves, int moveCount, int dx, int dy) {
+    if (moveCount <= 0)
+        return;
+    sraRegionPtr region = sraRgnCreate();
+    for (int i = 0; i < moveCount; ++i) {
+        sraRegionPtr r = sraRgnCreateRect(moves[i].x, moves[i].y, moves[i].x + moves[i].w, moves[i].y + moves[i].h);
+        sraRgnOr(region, r);
+        sraRgnDestroy(r);
+    }
+    rfbScheduleCopyRegion(gScreen, region, dx, dy);
+    sraRgnDestroy(region);
 }
 
-// Blocking lock helpers (original behavior): lock all clients, then unlock all.
+// Blocking lock helpers: lock all clients, then unlock all.
 NS_INLINE void lockAllClientsBlocking(void) {
     rfbClientIteratorPtr it = rfbGetClientIterator(gScreen);
     rfbClientPtr cl;
@@ -2193,6 +3130,51 @@ NS_INLINE void unlockAllClientsBlocking(void) {
     rfbReleaseClientIterator(it);
 }
 
+// Publish the back buffer as the new generation and mark what changed: the whole screen when rects is NULL, else
+// rects plus moves sent as CopyRect (destination rects; source is offset by -dx,-dy). The replaced front buffer is
+// retired until no update reads it. A new back buffer is taken right away when one is free (gBackIsPrevious when it
+// is the buffer just replaced).
+// Clients are locked in two cases. With the server-drawn cursor (-U on), libvncserver draws the cursor into the
+// framebuffer and restores it after each update, so the pointer only changes between updates there. With moves, an
+// update sent between the pointer store and the copy scheduling could send new pixels in the move source from its
+// older pending region, and the CopyRect after it would copy them on: moves are scheduled before any update starts.
+static void publishBackBuffer(DirtyRect *rects, int rectCount, const DirtyRect *moves, int moveCount, int dx, int dy) {
+    const BOOL resize = gScreen->width != gWidth || gScreen->height != gHeight;
+    const BOOL lockClients = !resize && (gCursorEnabled || moveCount > 0);
+    if (lockClients)
+        lockAllClientsBlocking();
+    TVRetiredBuffer old = {gFrontBuffer, gFrontSurface, 0};
+    gFrontBuffer = gBackBuffer;
+    gFrontSurface = gBackSurface;
+    if (resize) {
+        // First frame of a rotation: rfbNewFramebuffer locks every client itself and tells them the new size
+        rfbNewFramebuffer(gScreen, (char *)gFrontBuffer, gWidth, gHeight, 8, 3, gBytesPerPixel);
+        // Restore BGRA little-endian channel layout (R shift=16, G=8, B=0)
+        int bps = 8;
+        gScreen->serverFormat.redShift = bps * 2;   // 16
+        gScreen->serverFormat.greenShift = bps * 1; // 8
+        gScreen->serverFormat.blueShift = 0;        // 0
+        gScreen->paddedWidthInBytes = (int)gFBBytesPerRow;
+    } else {
+        // Client threads read the pointer while it changes: a single release store, never a torn pointer
+        __atomic_store_n(&gScreen->frameBuffer, (char *)gFrontBuffer, __ATOMIC_RELEASE);
+    }
+    old.retiredAt = gPublishGen.fetch_add(1) + 1;
+    if (rects && !resize) {
+        scheduleScrollMoves(moves, moveCount, dx, dy);
+        markRectsModified(rects, rectCount);
+    } else {
+        rfbMarkRectAsModified(gScreen, 0, 0, gWidth, gHeight);
+    }
+    if (lockClients)
+        unlockAllClientsBlocking();
+
+    gBackBuffer = NULL;
+    gBackSurface = NULL;
+    gRetiredBuffers.push_back(old);
+    gBackIsPrevious = acquireBackBuffer() && gBackBuffer == old.pixels;
+}
+
 static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
 
 #if DEBUG
@@ -2214,6 +3196,20 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
         return;
     }
 
+    // The previous flush may still be bringing the back buffer up to date on the pool
+    waitBackBufferSync();
+
+    // Publication never waits for readers: with every buffer still read by updates in progress, skip this frame.
+    // Its changes are not hashed yet, so the next frame picks them up; the next unpin makes sure one comes.
+    if (!gBackBuffer)
+        gBackBuffer = takeFreeBufferOrRetry();
+    if (!gBackBuffer) {
+        gPublishDrops++;
+        TVLogVerbose(@"drop frame: all %d frame buffers are still read by updates in progress (drops=%llu)",
+                     cPublishBuffers, (unsigned long long)gPublishDrops);
+        return;
+    }
+
 #if DEBUG
     CFAbsoluteTime __tv_tLock0 = CFAbsoluteTimeGetCurrent();
 #endif
@@ -2238,7 +3234,12 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
     CFAbsoluteTime __tv_tResize0 = CFAbsoluteTimeGetCurrent();
 #endif
 
-    maybeResizeFramebufferForRotation(rotQ);
+    if (!maybeResizeFramebufferForRotation(rotQ)) {
+        CVPixelBufferUnlockBaseAddress(pb, kCVPixelBufferLock_ReadOnly);
+        gPublishDrops++;
+        TVLogVerbose(@"drop frame: rotation waits for a frame buffer (drops=%llu)", (unsigned long long)gPublishDrops);
+        return;
+    }
 
 #if DEBUG
     CFAbsoluteTime __tv_tResize1 = CFAbsoluteTimeGetCurrent();
@@ -2265,58 +3266,103 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
     // Copy/Rotate/Scale into back buffer. ScreenCapturer is always portrait-oriented.
     // We rotate by UI orientation then scale to server size.
     BOOL dirtyDisabled = (gFullscreenThresholdPercent == 0);
+    const BOOL sourceSpace = gSourceSpaceDirty && !dirtyDisabled;
+    const BOOL compareMode = !sourceSpace && (gDiffMode == TileDiffMode::Compare);
+
+    // In hash mode, hash tiles while copying into the back buffer when no scaling is involved:
+    // one streaming pass over the frame instead of copy + defer hash + flush hash.
+    const BOOL fuseHash = !dirtyDisabled && !sourceSpace && !compareMode;
+    BOOL hashedWhileCopying = NO;
+    gTileDiff.resetBytesTouched();
+    gTileDiff.resetTilesVisited();
 
     static int sLastRotQ = -1;
     bool rotationChanged = (sLastRotQ == -1) ? false : ((rotQ & 3) != (sLastRotQ & 3));
-    bool needsRotate = (rotQ != 0);
+
+    // Source-space damage: detect on the capture, then rotate/scale only the damaged regions when possible
+    BOOL renderedPartially = NO;
+    if (sourceSpace) {
+        if (rotationChanged)
+            gBackBufferInSync = NO;
+        renderedPartially = renderSourceDamage(base, srcBPR, (int)width, (int)height, rotQ);
+    }
+    bool needsRotate = (rotQ != 0) && !renderedPartially;
 
     vImage_Buffer srcBuf = {
         .data = base, .height = (vImagePixelCount)height, .width = (vImagePixelCount)width, .rowBytes = srcBPR};
 
     vImage_Buffer stage = srcBuf; // after rotation
     vImage_Buffer rotBuf = {0};
+    vImage_Buffer dstBuf = {.data = gBackBuffer,
+                            .height = (vImagePixelCount)gHeight,
+                            .width = (vImagePixelCount)gWidth,
+                            .rowBytes = gFBBytesPerRow};
+    const int threads = cParallelHashOnFlush ? tileWorkerThreads() : 1;
+
+    // Exact-size unscaled output: rotate straight into the back buffer (hashing each band as it lands)
+    // instead of rotating into the scratch and copying it over.
+    size_t rotW = (rotQ % 2 == 0) ? (size_t)width : (size_t)height;
+    size_t rotH = (rotQ % 2 == 0) ? (size_t)height : (size_t)width;
+    const BOOL rotateIntoBack = needsRotate && rotW == (size_t)gWidth && rotH == (size_t)gHeight && gScale == 1.0;
+    // -z: an unrotated capture at the framebuffer stride is published in place rather than copied
+    const BOOL zeroCopyFrame = gZeroCopy && !needsRotate && !renderedPartially && (int)width == gWidth &&
+                               (int)height == gHeight && srcBPR == gFBBytesPerRow;
+    // Scaled output: resample straight from the capture (rotating on the fly) unless vImage scales (-S hq)
+    ResampleFilter resampleFilter = ResampleFilter::Area;
+    const BOOL resampleIntoBack = !renderedPartially && !rotateIntoBack &&
+                                  !stageCopiesUnscaled((int)rotW, (int)rotH) &&
+                                  scaleFilterForStage((int)rotW, (int)rotH, rotQ != 0, &resampleFilter);
 
 #if DEBUG
     CFTimeInterval __tv_msRotate = 0.0;
     CFTimeInterval __tv_msScaleOrCopy = 0.0;
 #endif
 
-    if (needsRotate) {
+    if (resampleIntoBack) {
+        CFAbsoluteTime tScale0 = CFAbsoluteTimeGetCurrent();
+        resampleParallel(base, srcBPR, (int)width, (int)height, rotQ, resampleFilter, fuseHash, threads);
+        hashedWhileCopying = fuseHash;
+        CFTimeInterval msScale = (CFAbsoluteTimeGetCurrent() - tScale0) * 1000.0;
+        gScaleMsTotal += msScale;
+        gScaleFrames++;
 
 #if DEBUG
-        CFAbsoluteTime __tv_tRot0 = CFAbsoluteTimeGetCurrent();
+        __tv_msScaleOrCopy = msScale;
+        TVLogVerbose(@"resample rot %d*90 into back%@ took %.3f ms (src=%zux%zu -> dst=%dx%d, %s, threads=%d)", rotQ,
+                     fuseHash ? @"+hash" : @"", msScale, width, height, gWidth, gHeight,
+                     resampleFilterName(resampleFilter), threads);
 #endif
 
-        size_t rotW = (rotQ % 2 == 0) ? (size_t)width : (size_t)height;
-        size_t rotH = (rotQ % 2 == 0) ? (size_t)height : (size_t)width;
-        if (ensureRotateScratch(rotW, rotH) != 0) {
-            CVPixelBufferUnlockBaseAddress(pb, kCVPixelBufferLock_ReadOnly);
-            return;
-        }
+    } else if (needsRotate) {
 
-        rotBuf.data = gRotateScratch;
-        rotBuf.width = (vImagePixelCount)rotW;
-        rotBuf.height = (vImagePixelCount)rotH;
-        rotBuf.rowBytes = rotW * (size_t)gBytesPerPixel;
+#if DEBUG
+        CFAbsoluteTime __tv_tRot0 = CFAbsoluteTimeGetCurrent();
+#endif
 
-        uint8_t rotConst = kRotate0DegreesClockwise;
-        switch (rotQ) {
-        case 1:
-            rotConst = kRotate90DegreesClockwise;
-            break;
-        case 2:
-            rotConst = kRotate180DegreesClockwise;
-            break;
-        case 3:
-            rotConst = kRotate270DegreesClockwise;
-            break;
-        default:
-            rotConst = kRotate0DegreesClockwise;
-            break;
+        if (rotateIntoBack) {
+            rotBuf = dstBuf;
+        } else {
+            if (ensureRotateScratch(rotW, rotH) != 0) {
+                CVPixelBufferUnlockBaseAddress(pb, kCVPixelBufferLock_ReadOnly);
+                return;
+            }
+
+            rotBuf.data = gRotateScratch;
+            rotBuf.width = (vImagePixelCount)rotW;
+            rotBuf.height = (vImagePixelCount)rotH;
+            rotBuf.rowBytes = rotW * (size_t)gBytesPerPixel;
         }
 
-        uint8_t bg[4] = {0, 0, 0, 0};
-        vImage_Error rerr = vImageRotate90_ARGB8888(&srcBuf, &rotBuf, rotConst, bg, kvImageNoFlags);
+        const BOOL hashBands = rotateIntoBack && fuseHash;
+        vImage_Error rerr;
+        if (threads > 1) {
+            rerr = rotateParallel(&srcBuf, &rotBuf, rotQ, hashBands);
+        } else {
+            uint8_t bg[4] = {0, 0, 0, 0};
+            rerr = vImageRotate90_ARGB8888(&srcBuf, &rotBuf, rotationConstantForQuad(rotQ), bg, kvImageNoFlags);
+            if (rerr == kvImageNoError && hashBands)
+                gTileDiff.hashFull((const uint8_t *)rotBuf.data, rotBuf.rowBytes);
+        }
         if (rerr != kvImageNoError) {
             static BOOL sLoggedRotErrOnce = NO;
             if (!sLoggedRotErrOnce) {
@@ -2329,32 +3375,61 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
         }
 
         stage = rotBuf;
+        hashedWhileCopying = hashBands;
 
 #if DEBUG
         CFAbsoluteTime __tv_tRot1 = CFAbsoluteTimeGetCurrent();
         __tv_msRotate = (__tv_tRot1 - __tv_tRot0) * 1000.0;
-        TVLogVerbose(@"rotate %d*90 took %.3f ms (rotW=%zu, rotH=%zu)", rotQ, __tv_msRotate, (size_t)rotBuf.width,
-                     (size_t)rotBuf.height);
+        TVLogVerbose(@"rotate %d*90%@ took %.3f ms (rotW=%zu, rotH=%zu, threads=%d)", rotQ,
+                     rotateIntoBack ? (hashBands ? @" into back+hash" : @" into back") : @"", __tv_msRotate,
+                     (size_t)rotBuf.width, (size_t)rotBuf.height, threads);
 #endif
     }
 
     // Scale stage to back buffer (tightly packed)
-    vImage_Buffer dstBuf = {.data = gBackBuffer,
-                            .height = (vImagePixelCount)gHeight,
-                            .width = (vImagePixelCount)gWidth,
-                            .rowBytes = (size_t)gWidth * (size_t)gBytesPerPixel};
-    if (stage.width == dstBuf.width && stage.height == dstBuf.height && gScale == 1.0) {
+    if (renderedPartially) {
+        // Damaged regions are already in the back buffer
+    } else if (rotateIntoBack || resampleIntoBack) {
+        // Rotated and/or scaled in place above
+    } else if (zeroCopyFrame && adoptCaptureAsBackBuffer(pb)) {
+
+#if DEBUG
+        CFAbsoluteTime __tv_tAdopt0 = CFAbsoluteTimeGetCurrent();
+#endif
+
+        // No copy to fuse the hash with: hash the capture where it is
+        if (fuseHash) {
+            hashTiledFromBufferParallel(&gTileDiff, (const uint8_t *)gBackBuffer, gFBBytesPerRow, threads);
+            hashedWhileCopying = YES;
+        }
+
+#if DEBUG
+        CFAbsoluteTime __tv_tAdopt1 = CFAbsoluteTimeGetCurrent();
+        __tv_msScaleOrCopy = (__tv_tAdopt1 - __tv_tAdopt0) * 1000.0;
+        TVLogVerbose(@"zero-copy: capture is the back buffer%@ (%.3f ms)", hashedWhileCopying ? @" +hash" : @"",
+                     __tv_msScaleOrCopy);
+#endif
+
+    } else if (stage.width == dstBuf.width && stage.height == dstBuf.height && gScale == 1.0) {
 
 #if DEBUG
         CFAbsoluteTime __tv_tCopy0 = CFAbsoluteTimeGetCurrent();
 #endif
 
-        copyWithStrideTight((uint8_t *)dstBuf.data, (const uint8_t *)stage.data, gWidth, gHeight, stage.rowBytes);
+        if (fuseHash) {
+            copyWithStrideTightHashed((uint8_t *)dstBuf.data, (const uint8_t *)stage.data, gWidth, gHeight,
+                                      stage.rowBytes, threads);
+            hashedWhileCopying = YES;
+        } else {
+            copyWithStrideTight((uint8_t *)dstBuf.data, (const uint8_t *)stage.data, gWidth, gHeight,
+                                stage.rowBytes);
+        }
 
 #if DEBUG
         CFAbsoluteTime __tv_tCopy1 = CFAbsoluteTimeGetCurrent();
         __tv_msScaleOrCopy = (__tv_tCopy1 - __tv_tCopy0) * 1000.0;
-        TVLogVerbose(@"copy stage->back (tight) took %.3f ms", __tv_msScaleOrCopy);
+        TVLogVerbose(@"copy stage->back (tight%@) took %.3f ms", hashedWhileCopying ? @"+hash" : @"",
+                     __tv_msScaleOrCopy);
 #endif
 
     } else {
@@ -2369,8 +3444,12 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
             CFAbsoluteTime __tv_tPad0 = CFAbsoluteTimeGetCurrent();
 #endif
 
+            if (fuseHash)
+                gTileDiff.resetCurrentHashes();
             copyPadOrCropToTight((uint8_t *)dstBuf.data, (int)dstBuf.width, (int)dstBuf.height,
-                                 (const uint8_t *)stage.data, (int)stage.width, (int)stage.height, stage.rowBytes);
+                                 (const uint8_t *)stage.data, (int)stage.width, (int)stage.height, stage.rowBytes,
+                                 fuseHash, threads);
+            hashedWhileCopying = fuseHash;
 
 #if DEBUG
             CFAbsoluteTime __tv_tPad1 = CFAbsoluteTimeGetCurrent();
@@ -2381,11 +3460,7 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
 #endif
 
         } else {
-
-#if DEBUG
-            CFAbsoluteTime __tv_tScale0 = CFAbsoluteTimeGetCurrent();
-#endif
-
+            CFAbsoluteTime tScale0 = CFAbsoluteTimeGetCurrent();
             if (ensureScaleTemp(stage.width, stage.height, dstBuf.width, dstBuf.height, kvImageHighQualityResampling) !=
                 0) {
                 CVPixelBufferUnlockBaseAddress(pb, kCVPixelBufferLock_ReadOnly);
@@ -2403,9 +3478,12 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
                 return;
             }
 
+            CFTimeInterval msScale = (CFAbsoluteTimeGetCurrent() - tScale0) * 1000.0;
+            gScaleMsTotal += msScale;
+            gScaleFrames++;
+
 #if DEBUG
-            CFAbsoluteTime __tv_tScale1 = CFAbsoluteTimeGetCurrent();
-            __tv_msScaleOrCopy = (__tv_tScale1 - __tv_tScale0) * 1000.0;
+            __tv_msScaleOrCopy = msScale;
             TVLogVerbose(@"scale stage->back took %.3f ms (stage=%zux%zu -> dst=%dx%d)", __tv_msScaleOrCopy,
                          (size_t)stage.width, (size_t)stage.height, gWidth, gHeight);
 #endif
@@ -2417,6 +3495,8 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
 #endif
 
     CVPixelBufferUnlockBaseAddress(pb, kCVPixelBufferLock_ReadOnly);
+    if (sourceSpace)
+        gBackBufferInSync = YES; // full or partial render landed
 
 #if DEBUG
     CFAbsoluteTime __tv_tUnlock1 = CFAbsoluteTimeGetCurrent();
@@ -2428,60 +3508,33 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
     // to avoid mixing hashes/pending dirties from the previous orientation.
     if (rotationChanged) {
         // Clear pending mask/state
-        if (gPendingDirty)
-            memset(gPendingDirty, 0, gTileCount);
+        gTileDiff.clearPending();
         gHasPending = NO;
+        resumeRecordFlush(NULL, 0, YES);
 
 #if DEBUG
         CFAbsoluteTime __tv_tSwap0 = CFAbsoluteTimeGetCurrent();
 #endif
 
-        if (gAsyncSwapEnabled) {
-            pthread_mutex_t *locked[64];
-            size_t lockedCount = 0;
-            if (tryLockAllClients(locked, &lockedCount, sizeof(locked) / sizeof(locked[0]))) {
-                swapBuffers();
-                for (size_t i = 0; i < lockedCount; ++i)
-                    pthread_mutex_unlock(locked[i]);
-                rfbMarkRectAsModified(gScreen, 0, 0, gWidth, gHeight);
-
-#if DEBUG
-                CFAbsoluteTime __tv_tSwap1 = CFAbsoluteTimeGetCurrent();
-                TVLogVerbose(@"rotationChanged async-swap+mark fullscreen took %.3f ms",
-                             (__tv_tSwap1 - __tv_tSwap0) * 1000.0);
-#endif
-
-            } else {
-                copyWithStrideTight((uint8_t *)gFrontBuffer, (uint8_t *)gBackBuffer, gWidth, gHeight,
-                                    (size_t)gWidth * (size_t)gBytesPerPixel);
-                rfbMarkRectAsModified(gScreen, 0, 0, gWidth, gHeight);
+        publishBackBuffer(NULL, 0, NULL, 0, 0, 0);
 
 #if DEBUG
-                CFAbsoluteTime __tv_tSwap1 = CFAbsoluteTimeGetCurrent();
-                TVLogVerbose(@"rotationChanged copy(fullscreen)+mark took %.3f ms",
-                             (__tv_tSwap1 - __tv_tSwap0) * 1000.0);
+        CFAbsoluteTime __tv_tSwap1 = CFAbsoluteTimeGetCurrent();
+        TVLogVerbose(@"rotationChanged publish+mark fullscreen took %.3f ms", (__tv_tSwap1 - __tv_tSwap0) * 1000.0);
 #endif
-            }
-        } else {
-            lockAllClientsBlocking();
-            swapBuffers();
-            rfbMarkRectAsModified(gScreen, 0, 0, gWidth, gHeight);
-            unlockAllClientsBlocking();
 
-#if DEBUG
-            CFAbsoluteTime __tv_tSwap1 = CFAbsoluteTimeGetCurrent();
-            TVLogVerbose(@"rotationChanged blocking-swap+mark fullscreen took %.3f ms",
-                         (__tv_tSwap1 - __tv_tSwap0) * 1000.0);
-#endif
-        }
+        logRotationLatency(rotQ);
 
         // Skip dirty detection for this frame after rotation; return early
         sLastRotQ = rotQ;
+        gBackBufferInSync = NO; // back buffer now holds the previous orientation
+
 
         // Rotation may not change geometry (0<->180). Maintain hashes here so
         // the next frame recomputes curr and swaps to form a clean baseline.
-        resetCurrTileHashes();
-        swapTileHashes();
+        gTileDiff.resetCurrentHashes();
+        gTileDiff.swapHashes();
+        resumeCommitFlush();
 
 #if DEBUG
         CFAbsoluteTime __tv_tEnd = CFAbsoluteTimeGetCurrent();
@@ -2496,50 +3549,22 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
 
     // If dirty detection is disabled, perform a full-screen update
     if (dirtyDisabled) {
+        resumeRecordFlush(NULL, 0, YES);
 
 #if DEBUG
         CFAbsoluteTime __tv_tSwap0 = CFAbsoluteTimeGetCurrent();
 #endif
 
-        if (gAsyncSwapEnabled) {
-            pthread_mutex_t *locked[64];
-            size_t lockedCount = 0;
-            if (tryLockAllClients(locked, &lockedCount, sizeof(locked) / sizeof(locked[0]))) {
-                swapBuffers();
-                for (size_t i = 0; i < lockedCount; ++i)
-                    pthread_mutex_unlock(locked[i]);
-                rfbMarkRectAsModified(gScreen, 0, 0, gWidth, gHeight);
-
-#if DEBUG
-                CFAbsoluteTime __tv_tSwap1 = CFAbsoluteTimeGetCurrent();
-                TVLogVerbose(@"dirtyDisabled async-swap+mark fullscreen took %.3f ms",
-                             (__tv_tSwap1 - __tv_tSwap0) * 1000.0);
-#endif
-
-            } else {
-                // Whole screen copy fallback (tight -> tight)
-                copyWithStrideTight((uint8_t *)gFrontBuffer, (uint8_t *)gBackBuffer, gWidth, gHeight,
-                                    (size_t)gWidth * (size_t)gBytesPerPixel);
-                rfbMarkRectAsModified(gScreen, 0, 0, gWidth, gHeight);
+        publishBackBuffer(NULL, 0, NULL, 0, 0, 0);
+        if (!gBackIsPrevious)
+            gBackBufferInSync = NO;
 
 #if DEBUG
-                CFAbsoluteTime __tv_tSwap1 = CFAbsoluteTimeGetCurrent();
-                TVLogVerbose(@"dirtyDisabled copy(fullscreen)+mark took %.3f ms", (__tv_tSwap1 - __tv_tSwap0) * 1000.0);
+        CFAbsoluteTime __tv_tSwap1 = CFAbsoluteTimeGetCurrent();
+        TVLogVerbose(@"dirtyDisabled publish+mark fullscreen took %.3f ms", (__tv_tSwap1 - __tv_tSwap0) * 1000.0);
 #endif
-            }
-        } else {
-            // Blocking swap to avoid tearing
-            lockAllClientsBlocking();
-            swapBuffers();
-            rfbMarkRectAsModified(gScreen, 0, 0, gWidth, gHeight);
-            unlockAllClientsBlocking();
 
-#if DEBUG
-            CFAbsoluteTime __tv_tSwap1 = CFAbsoluteTimeGetCurrent();
-            TVLogVerbose(@"dirtyDisabled blocking-swap+mark fullscreen took %.3f ms",
-                         (__tv_tSwap1 - __tv_tSwap0) * 1000.0);
-#endif
-        }
+        resumeCommitFlush();
 
 #if DEBUG
         CFAbsoluteTime __tv_tEnd = CFAbsoluteTimeGetCurrent();
@@ -2552,26 +3577,46 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
     }
 
     // Build dirty rectangles with deferred coalescing window (enabled)
-    // Lightweight hashing to update pending and decide whether to flush.
+    // Within the window, a sparse lattice of pixels is compared against the published frame (front buffer): a
+    // differing sample is a real change, so its tile turns pending right away. The lattice phase rotates per frame,
+    // so thin changes between lattice points are caught within a few frames. The full hash or compare at flush
+    // time still covers every change made during the window.
 
 #if DEBUG
     CFAbsoluteTime __tv_tHash0 = CFAbsoluteTimeGetCurrent();
 #endif
 
-    if (cSparseHashDuringDefer && gDeferWindowSec > 0) {
-        hashTiledFromBufferSparse((const uint8_t *)gBackBuffer, gWidth, gHeight,
-                                  (size_t)gWidth * (size_t)gBytesPerPixel, cHashStrideX, cHashStrideY);
-    } else {
-        resetCurrTileHashes();
-        hashTiledFromBuffer((const uint8_t *)gBackBuffer, gWidth, gHeight, (size_t)gWidth * (size_t)gBytesPerPixel);
+    // Tiles around the touch point are sampled at every pixel
+    DirtyRect focus = {0, 0, 0, 0};
+    BOOL hasFocus = pointerFocusRect(&focus);
+    gTileDiff.setFocusRect(focus);
+
+    BOOL sparsePass = NO;
+    if (sourceSpace || hashedWhileCopying) {
+        // Changed tiles are already known (fused hash, source-space mask)
+    } else if (cSparseHashDuringDefer && gDeferWindowSec > 0) {
+        int marked = gTileDiff.sampleSparse((const uint8_t *)gBackBuffer, (const uint8_t *)gFrontBuffer, gFBBytesPerRow,
+                                            cHashStrideX, cHashStrideY);
+        sparsePass = YES;
+        TVLogVerbose(@"sparse pass: %d tiles pending, coverage %.1f%% (every pixel within %d frames)", marked,
+                     gTileDiff.sparseCoverage() * 100.0, gTileDiff.sparseCycle());
+    } else if (!compareMode) {
+        gTileDiff.hashFull((const uint8_t *)gBackBuffer, gFBBytesPerRow);
     }
 
 #if DEBUG
     CFAbsoluteTime __tv_tHash1 = CFAbsoluteTimeGetCurrent();
     CFTimeInterval __tv_msHash = (__tv_tHash1 - __tv_tHash0) * 1000.0;
-    TVLogVerbose(@"tile hashing took %.3f ms (tiles=%zu, tileSize=%d)%@%@", __tv_msHash, gTileCount, gTileSize,
-                 (cSparseHashDuringDefer && gDeferWindowSec > 0) ? @" [sparse]" : @"",
-                 cUseCRC32Hash ? @" [crc32]" : @" [fnv]");
+    NSString *__tv_hashPass = @"";
+    if (sourceSpace)
+        __tv_hashPass = @" [source]";
+    else if (hashedWhileCopying)
+        __tv_hashPass = @" [fused]";
+    else if (sparsePass)
+        __tv_hashPass = @" [sparse]";
+    TVLogVerbose(@"tile hashing took %.3f ms (tiles=%zu, tileSize=%d, bytes=%llu)%@ [%s]", __tv_msHash,
+                 gTileDiff.tileCount(), gTileSize, (unsigned long long)gTileDiff.bytesTouched(), __tv_hashPass,
+                 compareMode ? "compare" : gTileDiff.hashName());
 #endif
 
     enum { kRectBuf = 1024 };
@@ -2584,7 +3629,10 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
     CFAbsoluteTime __tv_tPend0 = CFAbsoluteTimeGetCurrent();
 #endif
 
-    accumulatePendingDirty();
+    // Sparse hashes are not comparable with the full-hash baseline (every tile would turn pending);
+    // the full hash at flush covers the final frame against the last published one.
+    if (!compareMode && !sparsePass)
+        gTileDiff.accumulatePending();
 
 #if DEBUG
     CFAbsoluteTime __tv_tPend1 = CFAbsoluteTimeGetCurrent();
@@ -2595,17 +3643,27 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
     // Decide whether to flush now
     BOOL shouldFlush = YES;
     static CFAbsoluteTime sDeferStartTime = 0;
+    static CFAbsoluteTime sLastFlushTime = 0;
     if (gDeferWindowSec > 0) {
+        CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
         if (!gHasPending) {
             gHasPending = YES;
-            sDeferStartTime = CFAbsoluteTimeGetCurrent();
+            sDeferStartTime = now;
             shouldFlush = NO; // start window, wait for more
         } else {
-            CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
             shouldFlush = ((now - sDeferStartTime) >= gDeferWindowSec);
             TVLogVerbose(@"defer window elapsed=%.3f ms (threshold=%.3f ms) -> %@", (now - sDeferStartTime) * 1000.0,
                          gDeferWindowSec * 1000.0, shouldFlush ? @"FLUSH" : @"WAIT");
         }
+        // A change under the finger skips the rest of the window, but updates never come closer together than
+        // the usual cadence (a window plus the frame that closes it), so the update rate does not go up
+        if (!shouldFlush && hasFocus && now - sLastFlushTime >= 2.0 * gDeferWindowSec &&
+            gTileDiff.hasPendingInRect(focus)) {
+            shouldFlush = YES;
+            TVLogVerbose(@"defer window cut short: change near the touch point");
+        }
+        if (shouldFlush)
+            sLastFlushTime = now;
     }
 
     int rectCount = 0;
@@ -2626,34 +3684,52 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
         return;
     }
 
-    // At flush: recompute full hashes for precise rects
+    // At flush: recompute full hashes (or compare against front) for precise rects
     {
 
 #if DEBUG
         CFAbsoluteTime __tv_tHashFull0 = CFAbsoluteTimeGetCurrent();
 #endif
 
-        if (cParallelHashOnFlush) {
-            // Use number of logical CPUs as thread hint (capped)
-            int threads = (int)[[NSProcessInfo processInfo] processorCount];
-            if (threads < 2)
-                threads = 2;
-            if (threads > 8)
-                threads = 8;
-            hashTiledFromBufferParallel((const uint8_t *)gBackBuffer, gWidth, gHeight,
-                                        (size_t)gWidth * (size_t)gBytesPerPixel, threads);
+        const uint8_t *back = (const uint8_t *)gBackBuffer;
+        size_t bpr = gFBBytesPerRow;
+        if (sourceSpace || hashedWhileCopying) {
+            // Changed tiles were computed from this exact back buffer while producing it; nothing to redo
+        } else if (cParallelHashOnFlush) {
+            if (compareMode)
+                compareTiledFromBuffersParallel(back, (const uint8_t *)gFrontBuffer, bpr, threads);
+            else
+                hashTiledFromBufferParallel(&gTileDiff, back, bpr, threads);
+        } else if (compareMode) {
+            gTileDiff.compareFull(back, (const uint8_t *)gFrontBuffer, bpr);
         } else {
-            resetCurrTileHashes();
-            hashTiledFromBuffer((const uint8_t *)gBackBuffer, gWidth, gHeight, (size_t)gWidth * (size_t)gBytesPerPixel);
+            gTileDiff.hashFull(back, bpr);
         }
 
 #if DEBUG
         CFAbsoluteTime __tv_tHashFull1 = CFAbsoluteTimeGetCurrent();
         __tv_msHash = (__tv_tHashFull1 - __tv_tHashFull0) * 1000.0;
-        TVLogVerbose(@"tile hashing (flush full)%@ took %.3f ms (tiles=%zu, tileSize=%d)%@",
-                     cParallelHashOnFlush ? @" [parallel]" : @"", __tv_msHash, gTileCount, gTileSize,
-                     cUseCRC32Hash ? @" [crc32]" : @" [fnv]");
+        TVLogVerbose(@"tile hashing (flush full)%@ took %.3f ms (tiles=%zu, tileSize=%d, bytes=%llu) [%s]",
+                     cParallelHashOnFlush ? @" [parallel]" : @"", __tv_msHash, gTileDiff.tileCount(), gTileSize,
+                     (unsigned long long)gTileDiff.bytesTouched(), compareMode ? "compare" : gTileDiff.hashName());
+#endif
+    }
+
+    // Whole-frame early-out: identical frame fingerprint (or no changed band) and nothing pending.
+    // Clients already have this frame; skip rect building and the client-locking swap.
+    if (!gTileDiff.frameChanged() && !gTileDiff.hasPendingTiles()) {
+        gHasPending = NO;
+        sLastRotQ = rotQ;
+
+#if DEBUG
+        CFAbsoluteTime __tv_tEnd = CFAbsoluteTimeGetCurrent();
+        TVLogVerbose(@"unchanged frame summary rotQ=%d lock=%.3fms resize=%.3fms rotate=%.3fms scale/copy=%.3fms "
+                     @"hash=%.3fms total=%.3fms (tilesVisited=%llu)",
+                     rotQ, __tv_msLock, __tv_msResize, __tv_msRotate, __tv_msScaleOrCopy, __tv_msHash,
+                     (__tv_tEnd - __tv_tStart) * 1000.0, (unsigned long long)gTileDiff.tilesVisited());
 #endif
+
+        return;
     }
 
 // Promote pending tiles into rects
@@ -2661,146 +3737,150 @@ static void handleFramebuffer(CMSampleBufferRef sampleBuffer) {
     CFAbsoluteTime __tv_tRects0 = CFAbsoluteTimeGetCurrent();
 #endif
 
-    rectCount = buildRectsFromPending(rects, MIN(gMaxRectsLimit, kRectBuf));
-
-    // If anything from this frame is also new dirty not in pending, ensure included
-    int extraTiles = 0;
-    if (rectCount == 0) {
-        rectCount = buildDirtyRects(rects, MIN(gMaxRectsLimit, kRectBuf), &changedTiles);
-    } else {
-        // Merge current frame dirties by re-running with hashes, bounded
-        DirtyRect rectsNow[kRectBuf];
-        int nowCount = buildDirtyRects(rectsNow, MIN(gMaxRectsLimit, kRectBuf), &extraTiles);
-
-        // Simple append then vertical merge will compact later in pipeline
-        int space = kRectBuf - rectCount;
-        int take = nowCount < space ? nowCount : space;
-        if (take > 0)
-            memcpy(&rects[rectCount], rectsNow, (size_t)take * sizeof(DirtyRect));
-        rectCount += take;
-    }
-
-    int totalTiles = (int)gTileCount;
-    int totalChanged = changedTiles + extraTiles;
-    changedPct = (totalTiles > 0) ? (totalChanged * 100 / totalTiles) : 100;
-
-    if (rectCount >= gMaxRectsLimit) {
-        // Collapse to bounding box
-        int minX = gWidth, minY = gHeight, maxX = 0, maxY = 0;
-        for (int i = 0; i < rectCount; ++i) {
-            if (rects[i].w <= 0 || rects[i].h <= 0)
-                continue;
-            if (rects[i].x < minX)
-                minX = rects[i].x;
-            if (rects[i].y < minY)
-                minY = rects[i].y;
-            if (rects[i].x + rects[i].w > maxX)
-                maxX = rects[i].x + rects[i].w;
-            if (rects[i].y + rects[i].h > maxY)
-                maxY = rects[i].y + rects[i].h;
+    // Hot regions (video, spinners) go out at most gHotRegionFps times per second; other tiles are not held back
+    static CFAbsoluteTime sLastHotFlush = 0;
+    CFAbsoluteTime flushTime = CFAbsoluteTimeGetCurrent();
+    BOOL holdHot = gHotRegionFps > 0 && !sourceSpace && flushTime - sLastHotFlush < 1.0 / gHotRegionFps;
+    if (!holdHot)
+        sLastHotFlush = flushTime;
+
+    // Region masks (-Z): excluded regions are never updated, throttled ones only when their interval is up
+    DirtyRect maskRects[cMaxRegionMasks];
+    if (gRegionMaskCount > 0 && !sourceSpace)
+        applyRegionMasks(rotQ, flushTime, maskRects);
+
+    // Pending and current-frame dirty tiles are merged word by word in one pass, coalesced by estimated wire cost
+    rectCount = gTileDiff.buildRectsFromPending(rects, MIN(gMaxRectsLimit, kRectBuf), &changedTiles, holdHot);
+
+    int heldTiles = gTileDiff.heldTiles();
+    int droppedTiles = gTileDiff.droppedTiles();
+    if (heldTiles > 0 || droppedTiles > 0) {
+        gHotHeldTiles += (uint64_t)heldTiles;
+        if (rectCount == 0) {
+            // Only held or excluded tiles changed: nothing to send, held tiles stay pending
+            gTileDiff.updateChangeHistory();
+            gTileDiff.clearPending();
+            gHasPending = NO;
+            sLastRotQ = rotQ;
+            gHotSkippedFlushes++;
+            TVLogVerbose(@"held regions: %d tiles held, %d excluded, flush skipped", heldTiles, droppedTiles);
+            logHotRegionStats();
+            return;
         }
+    }
+
+    int totalTiles = (int)gTileDiff.tileCount();
+    changedPct = (totalTiles > 0) ? (changedTiles * 100 / totalTiles) : 100;
+    const int rectsBuilt = rectCount;
+
+    // Updates may be mostly scrolled or slid content: send that as CopyRect and encode only what is left
+    DirtyRect moves[cMaxMoves];
+    int moveCount = 0, moveDx = 0, moveDy = 0;
+    if ((gScrollDetect || gMotionSearch || gDedupTiles) && rectCount > 0) {
+        moveCount = detectMoves(rects, &rectCount, MIN(gMaxRectsLimit, kRectBuf - cMaxMoves), rotQ, changedPct, moves,
+                                &moveDx, &moveDy);
+        if (moveCount > 0)
+            changedPct = (int)(rectsArea(rects, rectCount) * 100 / ((uint64_t)gWidth * (uint64_t)gHeight));
+    }
+
+    fullScreen = (changedPct >= gFullscreenThresholdPercent) || (rectCount == 0 && moveCount == 0);
+
+    // The published buffer keeps what clients have in held and excluded tiles, unless the whole frame goes out
+    if (heldTiles > 0 || droppedTiles > 0) {
+        if (fullScreen)
+            gTileDiff.releaseHeldTiles();
+        else
+            gTileDiff.restoreHeldTiles((uint8_t *)gBackBuffer, (const uint8_t *)gFrontBuffer, gFBBytesPerRow);
+    }
 
-        rects[0] = (DirtyRect){minX, minY, maxX - minX, maxY - minY};
-        rectCount = 1;
+    uint64_t tileArea = fullScreen ? (uint64_t)gWidth * (uint64_t)gHeight : rectsArea(rects, rectCount);
 
-        TVLogVerbose(@"rects exceeded limit -> collapse to bbox");
+    // Shrink small rects to the pixels that actually differ from what clients have
+    if (!fullScreen && gRefineMaxArea > 0) {
+        uint64_t bytesBeforeRefine = gTileDiff.bytesTouched();
+        rectCount = refineRectsParallel(rects, rectCount, gRefineMaxArea);
+        TVLogVerbose(@"refine rects -> %d (bytes=%llu)", rectCount,
+                     (unsigned long long)(gTileDiff.bytesTouched() - bytesBeforeRefine));
     }
+    uint64_t pixelArea = fullScreen ? tileArea : rectsArea(rects, rectCount);
 
-    fullScreen = (changedPct >= gFullscreenThresholdPercent) || rectCount == 0;
+    // Refined rects may now be close enough to merge cheaply
+    if (!fullScreen && gRefineMaxArea > 0 && rectCount > 1)
+        rectCount = gTileDiff.coalesceRects(rects, rectCount, MIN(gMaxRectsLimit, kRectBuf));
 
 #if DEBUG
     CFAbsoluteTime __tv_tRects1 = CFAbsoluteTimeGetCurrent();
     CFTimeInterval __tv_msRects = (__tv_tRects1 - __tv_tRects0) * 1000.0;
-    TVLogVerbose(@"build rects took %.3f ms (rects=%d, changedTiles=%d, extraTiles=%d, changedPct=%d%%, fsThresh=%d%%, "
-                 @"fullscreen=%@)",
-                 __tv_msRects, rectCount, changedTiles, extraTiles, changedPct, gFullscreenThresholdPercent,
+    TVLogVerbose(@"build rects took %.3f ms (rects=%d, changedTiles=%d, changedPct=%d%%, fsThresh=%d%%, fullscreen=%@)",
+                 __tv_msRects, rectCount, changedTiles, changedPct, gFullscreenThresholdPercent,
                  fullScreen ? @"YES" : @"NO");
 #endif
 
-    // Clear pending
-    if (gPendingDirty)
-        memset(gPendingDirty, 0, gTileCount);
-
-    gHasPending = NO;
-
-#if DEBUG
-    CFAbsoluteTime __tv_tSwap0 = CFAbsoluteTimeGetCurrent();
-#endif
+    if (gRegionMaskCount > 0 && !sourceSpace)
+        markRegionMasksSent(maskRects, rects, rectCount, fullScreen, flushTime);
 
-    if (gAsyncSwapEnabled) {
-        // Try non-blocking swap with fallback to single-buffer copy.
-        pthread_mutex_t *locked[64];
-        size_t lockedCount = 0;
-
-        if (tryLockAllClients(locked, &lockedCount, sizeof(locked) / sizeof(locked[0]))) {
-            swapBuffers();
-            for (size_t i = 0; i < lockedCount; ++i)
-                pthread_mutex_unlock(locked[i]);
-            if (fullScreen) {
-                rfbMarkRectAsModified(gScreen, 0, 0, gWidth, gHeight);
-            } else {
-                markRectsModified(rects, rectCount);
-            }
+    // Flushed tiles keep a finer sparse lattice for the next few windows; then clear pending
+    gTileDiff.updateChangeHistory();
+    gTileDiff.clearPending();
 
-#if DEBUG
-            CFAbsoluteTime __tv_tSwap1 = CFAbsoluteTimeGetCurrent();
-            TVLogVerbose(@"async-swap+mark took %.3f ms (%@)", (__tv_tSwap1 - __tv_tSwap0) * 1000.0,
-                         fullScreen ? @"fullscreen" : @"partial");
-#endif
+    gHasPending = NO;
 
-        } else {
-            if (fullScreen) {
-                // Whole screen copy fallback (tight -> tight)
-                copyWithStrideTight((uint8_t *)gFrontBuffer, (uint8_t *)gBackBuffer, gWidth, gHeight,
-                                    (size_t)gWidth * (size_t)gBytesPerPixel);
-                rfbMarkRectAsModified(gScreen, 0, 0, gWidth, gHeight);
+    // Moved content changed too: rects[rectCount..syncCount) are copied between the buffers like dirty rects,
+    // and sent as CopyRect unless the update goes out full-screen anyway
+    int syncCount = rectCount;
+    if (moveCount > 0) {
+        memcpy(&rects[rectCount], moves, (size_t)moveCount * sizeof(DirtyRect));
+        syncCount += moveCount;
+    }
+    const int copyCount = fullScreen ? 0 : moveCount;
+    resumeRecordFlush(rects, syncCount, fullScreen);
 
 #if DEBUG
-                CFAbsoluteTime __tv_tSwap1 = CFAbsoluteTimeGetCurrent();
-                TVLogVerbose(@"async path copy(fullscreen)+mark took %.3f ms", (__tv_tSwap1 - __tv_tSwap0) * 1000.0);
+    CFAbsoluteTime __tv_tSwap0 = CFAbsoluteTimeGetCurrent();
 #endif
 
-            } else {
-                // Only copy dirty regions from back to front to reduce tearing and bandwidth
-                copyRectsFromBackToFront(rects, rectCount);
-                markRectsModified(rects, rectCount);
-
-#if DEBUG
-                CFAbsoluteTime __tv_tSwap1 = CFAbsoluteTimeGetCurrent();
-                TVLogVerbose(@"async path copy(dirty %d rects)+mark took %.3f ms", rectCount,
-                             (__tv_tSwap1 - __tv_tSwap0) * 1000.0);
-#endif
-            }
-        }
-    } else {
-        // Original blocking behavior to avoid tearing.
-        lockAllClientsBlocking();
-        swapBuffers();
-        if (fullScreen) {
-            rfbMarkRectAsModified(gScreen, 0, 0, gWidth, gHeight);
-        } else {
-            markRectsModified(rects, rectCount);
-        }
-        unlockAllClientsBlocking();
+    if (fullScreen)
+        publishBackBuffer(NULL, 0, NULL, 0, 0, 0);
+    else
+        publishBackBuffer(rects, rectCount, moves, copyCount, moveDx, moveDy);
+    if (sourceSpace) {
+        if (gBackIsPrevious)
+            copyRectsFromFrontToBack(rects, syncCount); // keep the back buffer complete for partial renders
+        else
+            gBackBufferInSync = NO; // not the previous frame: the next render is a full one
+    }
 
 #if DEBUG
-        CFAbsoluteTime __tv_tSwap1 = CFAbsoluteTimeGetCurrent();
-        TVLogVerbose(@"blocking-swap+mark took %.3f ms (%@)", (__tv_tSwap1 - __tv_tSwap0) * 1000.0,
-                     fullScreen ? @"fullscreen" : @"partial");
+    CFAbsoluteTime __tv_tSwap1 = CFAbsoluteTimeGetCurrent();
+    TVLogVerbose(@"publish+mark took %.3f ms (%@, gen=%llu)", (__tv_tSwap1 - __tv_tSwap0) * 1000.0,
+                 fullScreen ? @"fullscreen" : @"partial", (unsigned long long)gPublishGen.load());
 #endif
-    }
 
     // Prepare for next frame: current hashes become previous
-    swapTileHashes();
+    gTileDiff.swapHashes();
     sLastRotQ = rotQ;
+    resumeCommitFlush();
+
+    // Nothing is pending right after a flush: a safe point to retile
+    if (gTileSizeAdaptive) {
+        int suggested = gTileTuner.observe(gTileSize, rectsBuilt, tileArea, pixelArea, changedPct);
+        if (suggested != gTileSize)
+            retileAdaptive(suggested);
+    }
+    logWorkerPoolUtilization();
+    logHotRegionStats();
+    logScaleStats();
 
 #if DEBUG
     CFAbsoluteTime __tv_tEnd = CFAbsoluteTimeGetCurrent();
     TVLogVerbose(@"frame summary rotQ=%d lock=%.3fms resize=%.3fms rotate=%.3fms scale/copy=%.3fms hash=%.3fms "
-                 @"rects=%.3fms total=%.3fms (rectCount=%d, changedPct=%d%%, fullscreen=%@, inflight=%d/%d)",
+                 @"rects=%.3fms total=%.3fms (rectCount=%d, moves=%d, changedPct=%d%%, fullscreen=%@, inflight=%d/%d, "
+                 @"diffBytes=%llu, tilesVisited=%llu/%zu)",
                  rotQ, __tv_msLock, __tv_msResize, __tv_msRotate, __tv_msScaleOrCopy, __tv_msHash, __tv_msRects,
-                 (__tv_tEnd - __tv_tStart) * 1000.0, rectCount, changedPct, fullScreen ? @"YES" : @"NO",
-                 gInflight.load(std::memory_order_relaxed), gMaxInflightUpdates);
+                 (__tv_tEnd - __tv_tStart) * 1000.0, rectCount, copyCount, changedPct, fullScreen ? @"YES" : @"NO",
+                 gInflight.load(std::memory_order_relaxed), gMaxInflightUpdates,
+                 (unsigned long long)gTileDiff.bytesTouched(), (unsigned long long)gTileDiff.tilesVisited(),
+                 gTileDiff.tileCount());
 #endif
 }
 
@@ -3155,6 +4235,14 @@ static void ptrAddEvent(int buttonMask, int x, int y, rfbClientPtr cl) {
     TVClientState *st = tvGetClientState(cl);
     int lastMask = st ? st->lastButtonMask : 0;
 
+    // Touches and drags (left button, bit 0) and wheel ticks (bits 3-4) steer update priority towards this point;
+    // middle/right (power/home keys) do not point at anything on screen
+    if (((buttonMask | lastMask) & (1 | 8 | 16)) != 0) {
+        gFocusPoint.store((uint32_t)MAX(0, MIN(x, 0xFFFF)) | (uint32_t)MAX(0, MIN(y, 0xFFFF)) << 16,
+                          std::memory_order_relaxed);
+        gFocusTime.store(CFAbsoluteTimeGetCurrent(), std::memory_order_relaxed);
+    }
+
     // Left button (bit 0)
     bool leftNow = (buttonMask & 1) != 0;
     bool leftPrev = (lastMask & 1) != 0;
@@ -3939,6 +5027,8 @@ static BOOL gRestoreAssist = NO;
 #endif
 
 static void clientGoneHook(rfbClientPtr cl) {
+    readerSlotRelease(cl);
+
     // Free per-client state
     TVClientState *st = tvGetClientState(cl);
     BOOL isRepeaterClient = NO;
@@ -4014,6 +5104,7 @@ static void clientGoneHook(rfbClientPtr cl) {
 
 static enum rfbNewClientAction newClientHook(rfbClientPtr cl) {
     cl->clientGoneHook = clientGoneHook;
+    readerSlotClaim(cl);
     if (!cl->viewOnly && gViewOnly)
         cl->viewOnly = TRUE;
 
@@ -4354,15 +5445,36 @@ static void setupGeometry(void) {
     }
 
     // Apply output scaling if requested, then align (width multiple of 4)
-    int tmpW = (gScale > 0.0 && gScale < 1.0) ? MAX(1, (int)floor((double)gSrcWidth * gScale)) : gSrcWidth;
-    int tmpH = (gScale > 0.0 && gScale < 1.0) ? MAX(1, (int)floor((double)gSrcHeight * gScale)) : gSrcHeight;
-    alignDimensions(tmpW, tmpH, &gWidth, &gHeight);
-    gFBSize = (size_t)gWidth * (size_t)gHeight * (size_t)gBytesPerPixel;
-
-    // Allocate double buffers (tightly packed BGRA/ARGB32)
-    gFrontBuffer = calloc(1, gFBSize);
-    gBackBuffer = calloc(1, gFBSize);
-    if (!gFrontBuffer || !gBackBuffer) {
+    outputSizeForRotation(0, &gWidth, &gHeight);
+
+    // -z: unscaled frames are published straight from the capture, so framebuffers of its size take its stride
+    if (gZeroCopyEnabled) {
+        if (gWidth == gSrcWidth && gHeight == gSrcHeight) {
+            gZeroCopy = YES;
+            gZeroCopyBytesPerRow = [props[(__bridge NSString *)kIOSurfaceBytesPerRow] unsignedLongValue];
+            [[ScreenCapturer sharedCapturer] setSurfaceRingCount:cZeroCopySurfaces];
+            if (gSourceSpaceDirty) {
+                gSourceSpaceDirty = NO; // the capture is the output: nothing to render partially
+                TVLog(@"Zero-copy: -X space=source ignored");
+            }
+        } else {
+            TVLog(@"Zero-copy: output %dx%d differs from the capture %dx%d; frames are copied", gWidth, gHeight,
+                  gSrcWidth, gSrcHeight);
+        }
+    }
+    gFBBytesPerRow = framebufferBytesPerRow(gWidth, gHeight);
+    gFBSize = gFBBytesPerRow * (size_t)gHeight;
+    gFBCapacity = framebufferCapacity();
+    prepareTransformScratch();
+    if (gOrientationSyncEnabled) {
+        // Tile state for the landscape output too, at the finest tile size -t auto or -calibrate may pick
+        int landscapeW = 0, landscapeH = 0;
+        outputSizeForRotation(1, &landscapeW, &landscapeH);
+        gTileDiff.reserve(landscapeW, landscapeH, MIN(gTileSize, cAdaptiveTileMin));
+    }
+
+    // Allocate the publication buffers (BGRA/ARGB32, tightly packed unless -z), large enough for either orientation
+    if (!reserveFramebuffers() || !(gFrontBuffer = takeFreeBuffer()) || !(gBackBuffer = takeFreeBuffer())) {
         TVPrintError("Failed to allocate required frame buffers");
         exit(EXIT_FAILURE);
     }
@@ -4418,7 +5530,11 @@ static void setupOrientationObserver(void) {
         UIInterfaceOrientation activeOrientation = [update orientation];
 
         // Note: Actual framebuffer rotation will be handled in the next step.
-        gRotationQuad.store(rotationForOrientation(activeOrientation), std::memory_order_relaxed);
+        int rotQ = rotationForOrientation(activeOrientation);
+        if (rotQ != gRotationQuad.load(std::memory_order_relaxed)) {
+            gRotationRequestedAt.store(CFAbsoluteTimeGetCurrent());
+            gRotationQuad.store(rotQ, std::memory_order_relaxed);
+        }
 
 #if DEBUG
         NSUInteger seq = [update sequenceNumber];
@@ -4438,6 +5554,196 @@ static void setupOrientationObserver(void) {
           gRotationQuad.load(std::memory_order_relaxed));
 }
 
+#pragma mark - Calibration
+
+// -calibrate (or AutoCalibrate): time the frame path (fused copy + tile hash, rect building, refine, swap) on
+// synthetic frames at the output resolution for each hash kernel, tile size and worker count.
+static const int cCalibrationTileSizes[] = {16, 32, 64};
+static const int cCalibrationWarmupFrames = 3;
+static const int cCalibrationFrames = 24;
+static const int cCalibrationMaxWorkers = 8;
+static const int cCalibrationRectBuf = 1024;
+
+NS_INLINE NSString *calibrationKey(void) { return [NSString stringWithFormat:@"%dx%d", gWidth, gHeight]; }
+
+// UI-like content: a light background with short runs of dark "text" pixels, in lines and columns.
+static void fillCalibrationFrame(uint8_t *buf, int width, int height, size_t bpr) {
+    uint32_t seed = 0x2545F491u;
+    for (int y = 0; y < height; ++y) {
+        uint32_t *row = (uint32_t *)(buf + (size_t)y * bpr);
+        BOOL textRow = (y / 12) % 4 != 3 && (y % 12) < 8;
+        for (int x = 0; x < width; ++x) {
+            uint32_t px = 0xFFF2F2F7u;
+            if (textRow && (x / 40) % 5 != 4) {
+                seed = seed * 1664525u + 1013904223u;
+                if ((seed >> 28) < 5)
+                    px = 0xFF1C1C1Eu;
+            }
+            row[x] = px;
+        }
+    }
+}
+
+// A mix of typical updates: a caret blinking every frame, a list scrolling every third frame, and a large
+// change (a screen transition) every sixth frame.
+static void mutateCalibrationFrame(uint8_t *buf, int width, int height, size_t bpr, int frame) {
+    for (int y = height / 5; y < MIN(height, height / 5 + 20); ++y) {
+        uint32_t *px = (uint32_t *)(buf + (size_t)y * bpr) + width / 3;
+        px[0] ^= 0x00FFFFFFu;
+        px[1] ^= 0x00FFFFFFu;
+    }
+    if (frame % 3 == 1) {
+        const int top = height / 4, bottom = height * 3 / 4, step = 8;
+        memmove(buf + (size_t)top * bpr, buf + (size_t)(top + step) * bpr, (size_t)(bottom - top - step) * bpr);
+        for (int y = bottom - step; y < bottom; ++y) {
+            uint32_t *row = (uint32_t *)(buf + (size_t)y * bpr);
+            for (int x = 0; x < width; ++x)
+                row[x] ^= (uint32_t)((x * 7 + y * 13 + frame) & 0x3F);
+        }
+    }
+    if (frame % 6 == 5) {
+        for (int y = height / 5; y < height * 4 / 5; ++y) {
+            uint32_t *row = (uint32_t *)(buf + (size_t)y * bpr);
+            for (int x = 0; x < width; ++x)
+                row[x] ^= 0x00101010u;
+        }
+    }
+}
+
+// Median time per frame (ms) of one candidate, run through the same helpers as handleFramebuffer.
+static double runCalibrationCandidate(uint8_t *src, size_t srcBPR, TileHashKernel kernel, int tileSize, int workers) {
+    gHashKernel = kernel;
+    gTileSize = tileSize;
+    gWorkerThreads = workers;
+    delete gWorkerPool;
+    gWorkerPool = NULL;
+    initializeTilingOrReset();
+    gTileDiff.clearPending();
+    fillCalibrationFrame(src, gWidth, gHeight, srcBPR);
+
+    static DirtyRect sRects[cCalibrationRectBuf];
+    const int threads = tileWorkerThreads();
+    const int maxRects = MIN(gMaxRectsLimit, cCalibrationRectBuf);
+    std::vector<double> times;
+    for (int f = 0; f < cCalibrationWarmupFrames + cCalibrationFrames; ++f) {
+        mutateCalibrationFrame(src, gWidth, gHeight, srcBPR, f);
+        CFAbsoluteTime t0 = CFAbsoluteTimeGetCurrent();
+        copyWithStrideTightHashed((uint8_t *)gBackBuffer, src, gWidth, gHeight, srcBPR, threads);
+        int rectCount = gTileDiff.buildRectsFromPending(sRects, maxRects);
+        if (gRefineMaxArea > 0)
+            rectCount = refineRectsParallel(sRects, rectCount, gRefineMaxArea);
+        gTileDiff.clearPending();
+        // Swap without clients: nothing to lock or mark
+        void *tmp = gFrontBuffer;
+        gFrontBuffer = gBackBuffer;
+        gBackBuffer = tmp;
+        gTileDiff.swapHashes();
+        if (f >= cCalibrationWarmupFrames)
+            times.push_back((CFAbsoluteTimeGetCurrent() - t0) * 1000.0);
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Keep the other DirtyTuning keys; hash and workers are replaced.
+static void saveCalibration(TileHashKernel kernel, int tileSize, int workers) {
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+    NSMutableDictionary *prefs = [[defaults persistentDomainForName:@"com.82flex.trollvnc"] mutableCopy];
+    if (!prefs)
+        prefs = [NSMutableDictionary dictionary];
+
+    NSMutableArray<NSString *> *keys = [NSMutableArray array];
+    NSString *tuning = [prefs objectForKey:@"DirtyTuning"];
+    if ([tuning isKindOfClass:[NSString class]]) {
+        for (NSString *kv in [tuning componentsSeparatedByString:@","]) {
+            if (kv.length == 0 || [kv hasPrefix:@"hash="] || [kv hasPrefix:@"workers="])
+                continue;
+            [keys addObject:kv];
+        }
+    }
+    [keys addObject:[NSString stringWithFormat:@"hash=%s", TileHashKernelName(kernel)]];
+    [keys addObject:[NSString stringWithFormat:@"workers=%d", workers]];
+
+    [prefs setObject:[keys componentsJoinedByString:@","] forKey:@"DirtyTuning"];
+    [prefs setObject:@(tileSize) forKey:@"TileSize"];
+    [prefs setObject:calibrationKey() forKey:@"CalibratedFor"];
+    [defaults setPersistentDomain:prefs forName:@"com.82flex.trollvnc"];
+    TVLog(@"Calibration: saved to com.82flex.trollvnc (TileSize=%d, DirtyTuning=%@)", tileSize,
+          [prefs objectForKey:@"DirtyTuning"]);
+}
+
+// Kernels and tile sizes are compared with the default worker count, then worker counts with the winner.
+// The result is applied to the running configuration and saved. Needs setupGeometry() first.
+static void runCalibration(void) {
+    const TileDiffMode savedDiffMode = gDiffMode;
+    const BOOL savedSourceSpace = gSourceSpaceDirty;
+    gDiffMode = TileDiffMode::Hash;
+    gSourceSpaceDirty = NO;
+
+    // Captured frames have padded rows; keep the synthetic source the same
+    const size_t srcBPR = (((size_t)gWidth * (size_t)gBytesPerPixel) + 63) & ~(size_t)63;
+    uint8_t *src = (uint8_t *)calloc(1, srcBPR * (size_t)gHeight);
+    if (!src) {
+        TVPrintError("Calibration: failed to allocate the synthetic frame");
+        exit(EXIT_FAILURE);
+    }
+    TVLog(@"Calibration: %dx%d output, %d frames per candidate", gWidth, gHeight, cCalibrationFrames);
+
+    TileHashKernel bestKernel = TileHashKernel::Auto;
+    int bestTileSize = gTileSize;
+    double bestMs = HUGE_VAL;
+    for (int k = (int)TileHashKernel::Scalar; k <= (int)TileHashKernel::AVX2; ++k) {
+        TileHashKernel kernel = (TileHashKernel)k;
+        if (!TileHashKernelSupported(kernel))
+            continue;
+        for (int tileSize : cCalibrationTileSizes) {
+            double ms = runCalibrationCandidate(src, srcBPR, kernel, tileSize, 0);
+            TVLog(@"Calibration: hash=%s tile=%d workers=auto -> %.3f ms/frame", TileHashKernelName(kernel), tileSize,
+                  ms);
+            if (ms < bestMs) {
+                bestMs = ms;
+                bestKernel = kernel;
+                bestTileSize = tileSize;
+            }
+        }
+    }
+
+    // Workers beyond the capture thread, up to one per other CPU (the default)
+    const int autoWorkers = workerPool()->workerCount();
+    int bestWorkers = 0;
+    for (int workers = 1; workers <= MIN(autoWorkers, cCalibrationMaxWorkers); ++workers) {
+        double ms = runCalibrationCandidate(src, srcBPR, bestKernel, bestTileSize, workers);
+        TVLog(@"Calibration: hash=%s tile=%d workers=%d -> %.3f ms/frame", TileHashKernelName(bestKernel),
+              bestTileSize, workers, ms);
+        if (ms < bestMs) {
+            bestMs = ms;
+            bestWorkers = workers == autoWorkers ? 0 : workers;
+        }
+    }
+    free(src);
+
+    TVLog(@"Calibration: fastest hash=%s tile=%d workers=%d (%.3f ms/frame)", TileHashKernelName(bestKernel),
+          bestTileSize, bestWorkers, bestMs);
+    saveCalibration(bestKernel, bestTileSize, bestWorkers);
+
+    // Run with the result; the synthetic frames must not look like screen content to the first real frame
+    gDiffMode = savedDiffMode;
+    gSourceSpaceDirty = savedSourceSpace;
+    gHashKernel = bestKernel;
+    gTileSize = bestTileSize;
+    gWorkerThreads = bestWorkers;
+    delete gWorkerPool;
+    gWorkerPool = NULL;
+    memset(gFrontBuffer, 0, gFBSize);
+    memset(gBackBuffer, 0, gFBSize);
+    initializeTilingOrReset();
+    gTileDiff.clearPending();
+    if (gTileDiff.diffMode() == TileDiffMode::Hash) {
+        hashTiledFromBufferParallel(&gTileDiff, (const uint8_t *)gFrontBuffer, gFBBytesPerRow, tileWorkerThreads());
+        gTileDiff.swapHashes();
+    }
+}
+
 #pragma mark - Setups (RFB)
 
 static void setupRfbScreen(int argc, const char *argv[]) {
@@ -4451,7 +5757,7 @@ static void setupRfbScreen(int argc, const char *argv[]) {
     }
 
     // BGRA (little-endian) layout
-    gScreen->paddedWidthInBytes = gWidth * gBytesPerPixel;
+    gScreen->paddedWidthInBytes = (int)gFBBytesPerRow;
     gScreen->serverFormat.redShift = bitsPerSample * 2;   // 16
     gScreen->serverFormat.greenShift = bitsPerSample * 1; // 8
     gScreen->serverFormat.blueShift = 0;
@@ -4579,7 +5885,7 @@ static void setupRfbServerSideCursor(void) {
     if (gCursorEnabled) {
         setupXCursor(gScreen);
         setupAlphaCursor(gScreen, 0);
-        TVLog(@"Cursor: XCursor + alpha mode=2 enabled");
+        TVLog(@"Cursor: XCursor + alpha mode=2 enabled (every client is locked while a frame is published)");
     } else {
         TVLog(@"Cursor: disabled (default; enable with -U on)");
     }
@@ -4645,6 +5951,17 @@ static void setupRfbFileTransferExtension(void) {
     gFileTransferRegistered = YES;
 }
 
+static void setupRfbResumeExtension(void) {
+    static int pseudoEncodings[] = {cResumeEncoding, 0};
+    gResumeEpoch = (uint16_t)arc4random_uniform(0x10000);
+    gResumeExtension.newClient = resumeNewClient;
+    gResumeExtension.pseudoEncodings = pseudoEncodings;
+    gResumeExtension.enablePseudoEncoding = resumeEnablePseudoEncoding;
+    gResumeExtension.close = resumeClose;
+    rfbRegisterProtocolExtension(&gResumeExtension);
+    TVLog(@"Session resume extension registered (epoch=%04x)", gResumeEpoch);
+}
+
 #pragma mark - Setups (Event Model)
 
 static const long cSelectTimeout = 1e4; // 10 ms
@@ -4868,6 +6185,7 @@ static void cleanupAndExit(int code) {
     if (gFileTransferRegistered) {
         rfbUnregisterTightVNCFileTransferExtension();
     }
+    rfbUnregisterProtocolExtension(&gResumeExtension);
 
     if (gScreen) {
         rfbShutdownServer(gScreen, YES);
@@ -5012,6 +6330,11 @@ int main(int argc, const char *argv[]) {
 
     @autoreleasepool {
         setupGeometry();
+        if (gCalibrateMode || (gAutoCalibrate && ![gCalibratedFor isEqualToString:calibrationKey()])) {
+            runCalibration();
+            if (gCalibrateMode)
+                exit(EXIT_SUCCESS);
+        }
         setupOrientationObserver();
 
         setupRfbLogging();
@@ -5022,12 +6345,14 @@ int main(int argc, const char *argv[]) {
         setupRfbServerSideCursor();
         setupRfbHttpServer();
         setupRfbFileTransferExtension();
+        setupRfbResumeExtension();
 
         prepareBulletinManager();
         prepareClipboardManager();
         prepareScreenCapturer();
 
         initializeTilingOrReset();
+        TVLog(@"Tile hash kernel: %s (requested: %s)", gTileDiff.hashName(), TileHashKernelName(gHashKernel));
         initializeAndRunRfbServer();
 
         installSignalHandlers();
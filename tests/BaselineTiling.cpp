@@ -0,0 +1,215 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "BaselineTiling.h"
+
+#include <cstring>
+
+static const int kBytesPerPixel = 4;
+
+static inline uint64_t fnv1a_basis(void) { return 1469598103934665603ULL; }
+static inline uint64_t fnv1a_update(uint64_t h, const uint8_t *data, size_t len) {
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (uint64_t)data[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+void BaselineTiling::configure(int width, int height, int tileSize) {
+    mWidth = width;
+    mHeight = height;
+    mTileSize = tileSize;
+    mTilesX = (width + tileSize - 1) / tileSize;
+    mTilesY = (height + tileSize - 1) / tileSize;
+    mTileCount = (size_t)mTilesX * (size_t)mTilesY;
+    mPrevHash.assign(mTileCount, 0); // force full update first frame
+    mCurrHash.assign(mTileCount, fnv1a_basis());
+    mPendingDirty.assign(mTileCount, 0);
+}
+
+void BaselineTiling::hash(const uint8_t *buf, size_t bpr) {
+    for (size_t i = 0; i < mTileCount; ++i)
+        mCurrHash[i] = fnv1a_basis();
+    for (int y = 0; y < mHeight; ++y) {
+        int ty = y / mTileSize;
+        for (int tx = 0; tx < mTilesX; ++tx) {
+            int startX = tx * mTileSize;
+            if (startX >= mWidth)
+                break;
+            int endX = startX + mTileSize;
+            if (endX > mWidth)
+                endX = mWidth;
+            size_t offset = (size_t)startX * (size_t)kBytesPerPixel;
+            size_t length = (size_t)(endX - startX) * (size_t)kBytesPerPixel;
+            size_t tileIndex = (size_t)ty * (size_t)mTilesX + (size_t)tx;
+            mCurrHash[tileIndex] = fnv1a_update(mCurrHash[tileIndex], buf + (size_t)y * bpr + offset, length);
+        }
+    }
+}
+
+void BaselineTiling::accumulatePending() {
+    for (size_t i = 0; i < mTileCount; ++i) {
+        if (mCurrHash[i] != mPrevHash[i])
+            mPendingDirty[i] = 1;
+    }
+}
+
+int BaselineTiling::buildDirtyRects(DirtyRect *rects, int maxRects, int *outChangedTiles) {
+    int rectCount = 0;
+    int changedTiles = 0;
+
+    // First pass: horizontal merge per tile row
+    for (int ty = 0; ty < mTilesY; ++ty) {
+        int tx = 0;
+        while (tx < mTilesX) {
+            size_t idx = (size_t)ty * (size_t)mTilesX + (size_t)tx;
+            int changed = (mCurrHash[idx] != mPrevHash[idx]);
+            if (!changed) {
+                tx++;
+                continue;
+            }
+
+            // Start of a run
+            int runStart = tx;
+            changedTiles++;
+            tx++;
+            while (tx < mTilesX) {
+                size_t idx2 = (size_t)ty * (size_t)mTilesX + (size_t)tx;
+                if (mCurrHash[idx2] != mPrevHash[idx2]) {
+                    changedTiles++;
+                    tx++;
+                } else
+                    break;
+            }
+
+            // Emit rect for this horizontal run
+            if (rectCount < maxRects) {
+                int x = runStart * mTileSize;
+                int w = (tx - runStart) * mTileSize;
+                int y = ty * mTileSize;
+                int h = mTileSize;
+                // Clip to screen bounds
+                if (x + w > mWidth)
+                    w = mWidth - x;
+                if (y + h > mHeight)
+                    h = mHeight - y;
+                rects[rectCount++] = DirtyRect{x, y, w, h};
+            } else {
+                // Too many rects; caller may fallback to fullscreen
+                if (outChangedTiles)
+                    *outChangedTiles = changedTiles;
+                return rectCount;
+            }
+        }
+    }
+
+    // Optional vertical merge: merge rects with same x,w and contiguous vertically
+    // Simple O(n^2) merge for small rect counts
+    for (int i = 0; i < rectCount; ++i) {
+        for (int j = i + 1; j < rectCount; ++j) {
+            if (rects[j].w == 0 || rects[j].h == 0)
+                continue;
+            if (rects[i].x == rects[j].x && rects[i].w == rects[j].w) {
+                if (rects[i].y + rects[i].h == rects[j].y) {
+                    rects[i].h += rects[j].h;
+                    rects[j].w = rects[j].h = 0; // mark removed
+                } else if (rects[j].y + rects[j].h == rects[i].y) {
+                    rects[j].h += rects[i].h;
+                    rects[i].w = rects[i].h = 0;
+                }
+            }
+        }
+    }
+
+    // Compact removed entries
+    int k = 0;
+    for (int i = 0; i < rectCount; ++i) {
+        if (rects[i].w > 0 && rects[i].h > 0)
+            rects[k++] = rects[i];
+    }
+
+    rectCount = k;
+    if (outChangedTiles)
+        *outChangedTiles = changedTiles;
+    return rectCount;
+}
+
+int BaselineTiling::buildRectsFromPending(DirtyRect *rects, int maxRects) {
+    // Temporarily mark curr!=prev for pending tiles
+    for (size_t i = 0; i < mTileCount; ++i) {
+        if (mPendingDirty[i] && mCurrHash[i] == mPrevHash[i])
+            mCurrHash[i] ^= 0x1ULL;
+    }
+
+    int dummyTiles = 0;
+    int cnt = buildDirtyRects(rects, maxRects, &dummyTiles);
+
+    // Restore hashes for tiles we toggled
+    for (size_t i = 0; i < mTileCount; ++i) {
+        if (mPendingDirty[i]) {
+            if (mCurrHash[i] == mPrevHash[i])
+                mCurrHash[i] ^= 0x1ULL; // unlikely path
+            else if ((mCurrHash[i] ^ 0x1ULL) == mPrevHash[i])
+                mCurrHash[i] ^= 0x1ULL;
+        }
+    }
+    return cnt;
+}
+
+int BaselineTiling::flush(DirtyRect *rects, int maxRects, int *outChangedTiles) {
+    int changedTiles = 0;
+    int rectCount = buildRectsFromPending(rects, maxRects);
+
+    // If anything from this frame is also new dirty not in pending, ensure included
+    if (rectCount == 0) {
+        rectCount = buildDirtyRects(rects, maxRects, &changedTiles);
+    } else {
+        std::vector<DirtyRect> rectsNow((size_t)maxRects);
+        int extraTiles = 0;
+        int nowCount = buildDirtyRects(rectsNow.data(), maxRects, &extraTiles);
+        memcpy(&rects[rectCount], rectsNow.data(), (size_t)nowCount * sizeof(DirtyRect));
+        rectCount += nowCount;
+        changedTiles += extraTiles;
+    }
+
+    if (rectCount >= maxRects) {
+        // Collapse to bounding box
+        int minX = mWidth, minY = mHeight, maxX = 0, maxY = 0;
+        for (int i = 0; i < rectCount; ++i) {
+            if (rects[i].w <= 0 || rects[i].h <= 0)
+                continue;
+            if (rects[i].x < minX)
+                minX = rects[i].x;
+            if (rects[i].y < minY)
+                minY = rects[i].y;
+            if (rects[i].x + rects[i].w > maxX)
+                maxX = rects[i].x + rects[i].w;
+            if (rects[i].y + rects[i].h > maxY)
+                maxY = rects[i].y + rects[i].h;
+        }
+        rects[0] = DirtyRect{minX, minY, maxX - minX, maxY - minY};
+        rectCount = 1;
+    }
+
+    std::fill(mPendingDirty.begin(), mPendingDirty.end(), 0);
+    mPrevHash.swap(mCurrHash);
+    if (outChangedTiles)
+        *outChangedTiles = changedTiles;
+    return rectCount;
+}
@@ -0,0 +1,73 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BaselineTiling_h
+#define BaselineTiling_h
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RectCoalescer.h"
+
+/**
+ BaselineTiling
+ ----------------
+ The dirty detection trollvncserver.mm used before TileDiffEngine, kept as the
+ reference the engine is checked against: FNV-1a tile hashes, horizontal runs
+ per tile row followed by the O(n^2) vertical merge of runs with identical x
+ and w, a per-tile byte mask for pending tiles, and the merge-then-bbox policy
+ of handleFramebuffer (pending rects, then the current frame's rects appended,
+ collapsed to their bounding box once the rect limit is reached).
+ */
+class BaselineTiling {
+  public:
+    void configure(int width, int height, int tileSize);
+
+    /** hashTiledFromBuffer(): full hash of every tile. */
+    void hash(const uint8_t *buf, size_t bytesPerRow);
+
+    /** accumulatePendingDirty(). */
+    void accumulatePending();
+
+    /** buildDirtyRects(). */
+    int buildDirtyRects(DirtyRect *rects, int maxRects, int *outChangedTiles);
+
+    /** buildRectsFromPending(). */
+    int buildRectsFromPending(DirtyRect *rects, int maxRects);
+
+    /** The flush of handleFramebuffer: pending rects plus the current frame's rects, collapsed to the bounding box
+        when there are maxRects or more. rects needs room for 2 * maxRects. Clears pending and swaps hashes. */
+    int flush(DirtyRect *rects, int maxRects, int *outChangedTiles);
+
+    int tilesX() const { return mTilesX; }
+    int tilesY() const { return mTilesY; }
+    int tileSize() const { return mTileSize; }
+
+  private:
+    int mWidth = 0;
+    int mHeight = 0;
+    int mTileSize = 32;
+    int mTilesX = 0;
+    int mTilesY = 0;
+    size_t mTileCount = 0;
+    std::vector<uint64_t> mPrevHash;
+    std::vector<uint64_t> mCurrHash;
+    std::vector<uint8_t> mPendingDirty;
+};
+
+#endif /* BaselineTiling_h */
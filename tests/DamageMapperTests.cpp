@@ -0,0 +1,126 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// DamageMapper against FrameResampler, for every quarter turn, several downscale factors and every filter: a
+// source rect is changed, the whole output is rendered before and after, and the job the rect maps to must cover
+// every output pixel that changed. The halo is the one renderSourceDamage() passes for FrameResampler filters.
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "DamageMapper.h"
+#include "FrameResampler.h"
+#include "TestSupport.h"
+
+static const int kSrcWidth = 180;
+static const int kSrcHeight = 390;
+static const int kResampleHalo = 2; // renderSourceDamage(): FrameResampler filters read one pixel beyond
+
+static void fillNoise(std::vector<uint8_t> &px, size_t bpr, const DirtyRect &r, TraceRandom &rnd) {
+    for (int y = r.y; y < r.y + r.h; ++y)
+        for (int x = r.x; x < r.x + r.w; ++x) {
+            uint64_t v = rnd.next();
+            memcpy(px.data() + (size_t)y * bpr + (size_t)x * 4, &v, 4);
+        }
+}
+
+static bool inside(const DirtyRect &outer, const DirtyRect &r) {
+    return r.x >= outer.x && r.y >= outer.y && r.x + r.w <= outer.x + outer.w && r.y + r.h <= outer.y + outer.h;
+}
+
+static void checkGeometry(int rotQ, double scale, ResampleFilter filter, const char *filterName) {
+    const int rotW = (rotQ & 1) ? kSrcHeight : kSrcWidth, rotH = (rotQ & 1) ? kSrcWidth : kSrcHeight;
+    const int dstW = std::max(1, (int)(rotW * scale + 0.5)), dstH = std::max(1, (int)(rotH * scale + 0.5));
+    const size_t srcBPR = (size_t)kSrcWidth * 4, dstBPR = (size_t)dstW * 4;
+    const DirtyRect frame = {0, 0, dstW, dstH};
+
+    FrameResampler resampler;
+    resampler.configure(kSrcWidth, kSrcHeight, rotQ, dstW, dstH, filter);
+    DamageMapper mapper;
+    mapper.configure(kSrcWidth, kSrcHeight, rotQ, dstW, dstH, true, kResampleHalo);
+
+    TraceRandom rnd((uint64_t)(rotQ * 1000 + (int)(scale * 100) * 10 + (int)filter));
+    std::vector<uint8_t> src(srcBPR * (size_t)kSrcHeight);
+    fillNoise(src, srcBPR, DirtyRect{0, 0, kSrcWidth, kSrcHeight}, rnd);
+    std::vector<uint8_t> before(dstBPR * (size_t)dstH), after(before.size());
+    resampler.render(src.data(), srcBPR, before.data(), dstBPR, frame);
+
+    // Single pixels, small rects and rects on every edge and corner of the source
+    std::vector<DirtyRect> damage = {{0, 0, 1, 1},
+                                     {kSrcWidth - 1, kSrcHeight - 1, 1, 1},
+                                     {0, 0, kSrcWidth, 3},
+                                     {0, kSrcHeight - 5, kSrcWidth, 5},
+                                     {kSrcWidth - 2, 0, 2, kSrcHeight},
+                                     {0, 100, 7, 9}};
+    for (int i = 0; i < 24; ++i) {
+        int w = rnd.range(1, 40), h = rnd.range(1, 40);
+        damage.push_back(DirtyRect{rnd.range(0, kSrcWidth - w), rnd.range(0, kSrcHeight - h), w, h});
+    }
+
+    for (const DirtyRect &d : damage) {
+        fillNoise(src, srcBPR, d, rnd);
+        resampler.render(src.data(), srcBPR, after.data(), dstBPR, frame);
+
+        DamageJob job;
+        bool mapped = mapper.map(d, &job);
+        int changed = 0, missed = 0;
+        for (int y = 0; y < dstH; ++y)
+            for (int x = 0; x < dstW; ++x) {
+                size_t at = (size_t)y * dstBPR + (size_t)x * 4;
+                if (memcmp(before.data() + at, after.data() + at, 4) == 0)
+                    continue;
+                changed++;
+                const DirtyRect &in = job.dstInterior;
+                missed += !mapped || x < in.x || y < in.y || x >= in.x + in.w || y >= in.y + in.h;
+            }
+        CHECK(missed == 0, "rot %d scale %.2f %s: damage %d,%d %dx%d changed %d output pixels, %d outside %d,%d %dx%d",
+              rotQ, scale, filterName, d.x, d.y, d.w, d.h, changed, missed, job.dstInterior.x, job.dstInterior.y,
+              job.dstInterior.w, job.dstInterior.h);
+        if (mapped) {
+            CHECK(inside(frame, job.dstRender) && inside(job.dstRender, job.dstInterior),
+                  "rot %d scale %.2f %s: damage %d,%d %dx%d maps to interior %d,%d %dx%d outside render %d,%d %dx%d",
+                  rotQ, scale, filterName, d.x, d.y, d.w, d.h, job.dstInterior.x, job.dstInterior.y,
+                  job.dstInterior.w, job.dstInterior.h, job.dstRender.x, job.dstRender.y, job.dstRender.w,
+                  job.dstRender.h);
+            CHECK(inside(DirtyRect{0, 0, kSrcWidth, kSrcHeight}, job.srcRect) && inside(job.srcRect, d),
+                  "rot %d scale %.2f %s: damage %d,%d %dx%d reads %d,%d %dx%d", rotQ, scale, filterName, d.x, d.y,
+                  d.w, d.h, job.srcRect.x, job.srcRect.y, job.srcRect.w, job.srcRect.h);
+        }
+        before.swap(after);
+    }
+}
+
+int main() {
+    const struct {
+        ResampleFilter filter;
+        const char *name;
+    } filters[] = {
+        {ResampleFilter::Area, "area"},
+        {ResampleFilter::Box, "box"},
+        {ResampleFilter::Bilinear, "bilinear"},
+    };
+    int runs = 0;
+    for (int rotQ = 0; rotQ < 4; ++rotQ)
+        for (double scale : {0.25, 0.33, 0.5, 0.6, 0.75, 0.9})
+            for (const auto &f : filters) {
+                checkGeometry(rotQ, scale, f.filter, f.name);
+                runs++;
+            }
+    printf("%d geometries\n", runs);
+    return TEST_RESULT();
+}
@@ -0,0 +1,97 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// DuplicateTileFinder on every trace, following detectMoves() in the server: changed tiles are looked up in the
+// published frame's tile hashes, and the moves go out as CopyRect. Applying them to the published frame must
+// reproduce the new frame byte for byte in every moved rect, moves only cover dirty tiles, and the reported tile
+// count matches the moves. Repeated flat tiles are common enough in the traces that some must be found.
+
+#include <cstring>
+#include <vector>
+
+#include "DuplicateTileFinder.h"
+#include "TestSupport.h"
+#include "TileDiffEngine.h"
+
+static const int kMaxRects = 256;
+static const int kMaxMoves = 16; // cMaxMoves
+
+static int checkTrace(FrameTrace &trace, int tileSize) {
+    const int W = trace.width(), H = trace.height();
+    const size_t bpr = trace.bytesPerRow();
+    TileDiffEngine engine;
+    engine.configure(W, H, tileSize, 4);
+    DuplicateTileFinder finder;
+    finder.configure(W, H, tileSize, 4);
+
+    std::vector<uint8_t> published(bpr * (size_t)H, 0);
+    engine.hashFull(published.data(), bpr); // hashes of the black frame clients start with
+    engine.swapHashes();
+    std::vector<DirtyRect> rects((size_t)kMaxRects);
+    DirtyRect moves[kMaxMoves];
+    int hits = 0;
+    trace.rewind();
+    while (trace.next()) {
+        const uint8_t *cur = trace.pixels();
+        engine.hashFull(cur, bpr);
+        int count = engine.buildDirtyRects(rects.data(), kMaxRects, nullptr);
+        if (count > 0) {
+            int dx = 0, dy = 0, tiles = 0;
+            int moveCount = finder.find(engine.currentHashes(), engine.previousHashes(), cur, published.data(), bpr,
+                                        rects.data(), count, moves, kMaxMoves, &dx, &dy, &tiles);
+            CHECK(moveCount >= 0 && moveCount <= kMaxMoves, "%s tile %d frame %d: %d moves", trace.name().c_str(),
+                  tileSize, trace.frameIndex(), moveCount);
+            if (moveCount > 0) {
+                hits++;
+                int bad = firstWrongMove(cur, published.data(), bpr, W, H, moves, moveCount, dx, dy);
+                const DirtyRect &mv = moves[bad < 0 ? 0 : bad];
+                CHECK(bad < 0, "%s tile %d frame %d: move %d,%d %dx%d by (%d,%d) does not reproduce the frame",
+                      trace.name().c_str(), tileSize, trace.frameIndex(), mv.x, mv.y, mv.w, mv.h, dx, dy);
+                std::vector<uint8_t> dirty = tileCoverage(rects.data(), count, engine.tilesX(), engine.tilesY(),
+                                                          tileSize);
+                std::vector<uint8_t> moved = tileCoverage(moves, moveCount, engine.tilesX(), engine.tilesY(),
+                                                          tileSize);
+                int outside = 0, movedTiles = 0;
+                for (size_t i = 0; i < dirty.size(); ++i) {
+                    outside += moved[i] && !dirty[i];
+                    movedTiles += moved[i];
+                }
+                CHECK(outside == 0, "%s tile %d frame %d: moves cover %d clean tiles", trace.name().c_str(), tileSize,
+                      trace.frameIndex(), outside);
+                CHECK(tiles == movedTiles, "%s tile %d frame %d: %d tiles reported, moves cover %d",
+                      trace.name().c_str(), tileSize, trace.frameIndex(), tiles, movedTiles);
+                int ia = -1, ib = -1;
+                CHECK(!rectsOverlap(moves, moveCount, &ia, &ib), "%s tile %d frame %d: moves %d and %d overlap",
+                      trace.name().c_str(), tileSize, trace.frameIndex(), ia, ib);
+            }
+        }
+        engine.swapHashes();
+        memcpy(published.data(), cur, published.size());
+    }
+    printf("%-12s tile %2d %3d frames with moves\n", trace.name().c_str(), tileSize, hits);
+    return hits;
+}
+
+int main() {
+    std::vector<FrameTrace> traces = loadTraces();
+    int hits = 0;
+    for (FrameTrace &trace : traces)
+        for (int tileSize : {16, 32})
+            hits += checkTrace(trace, tileSize);
+    CHECK(hits > 0, "no duplicate tiles found in any trace");
+    return TEST_RESULT();
+}
@@ -0,0 +1,235 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// FrameResampler against plain reference code:
+// - at the rotated size it is an exact rotation, for every quarter turn and filter;
+// - Box at an integer ratio is the exact block mean, and every filter at any ratio is within one step per
+//   channel of the same filter computed in floating point;
+// - the fused rotate + downscale matches rotating first and downscaling the rotated copy (the two-pass path it
+//   replaces), exactly for even quarter turns and within one step per channel for odd ones, where the two
+//   separable passes run in the other order;
+// - rendering a rect on its own gives the same pixels as a full-frame render.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "FrameResampler.h"
+#include "TestSupport.h"
+
+struct Image {
+    int w = 0, h = 0;
+    std::vector<uint8_t> px;
+    Image() = default;
+    Image(int width, int height) : w(width), h(height), px((size_t)width * (size_t)height * 4, 0) {}
+    size_t bpr() const { return (size_t)w * 4; }
+    uint8_t *at(int x, int y) { return px.data() + (size_t)y * bpr() + (size_t)x * 4; }
+    const uint8_t *at(int x, int y) const { return px.data() + (size_t)y * bpr() + (size_t)x * 4; }
+};
+
+static Image noiseImage(int w, int h, uint64_t seed) {
+    Image img(w, h);
+    TraceRandom rnd(seed);
+    for (uint8_t &b : img.px)
+        b = (uint8_t)rnd.next();
+    return img;
+}
+
+// Rotated-space pixel (rx, ry) of a portrait source turned rotQ quarter turns clockwise (see FrameResampler.cpp).
+static Image rotate(const Image &src, int rotQ) {
+    Image out = (rotQ & 1) ? Image(src.h, src.w) : Image(src.w, src.h);
+    for (int ry = 0; ry < out.h; ++ry)
+        for (int rx = 0; rx < out.w; ++rx) {
+            int sx = rx, sy = ry;
+            if (rotQ == 1)
+                sx = ry, sy = src.h - 1 - rx;
+            else if (rotQ == 2)
+                sx = src.w - 1 - rx, sy = src.h - 1 - ry;
+            else if (rotQ == 3)
+                sx = src.w - 1 - ry, sy = rx;
+            memcpy(out.at(rx, ry), src.at(sx, sy), 4);
+        }
+    return out;
+}
+
+static Image resample(const Image &src, int rotQ, int dstW, int dstH, ResampleFilter filter) {
+    FrameResampler r;
+    r.configure(src.w, src.h, rotQ, dstW, dstH, filter);
+    Image out(dstW, dstH);
+    r.render(src.px.data(), src.bpr(), out.px.data(), out.bpr(), DirtyRect{0, 0, dstW, dstH});
+    return out;
+}
+
+static int maxChannelDiff(const Image &a, const Image &b) {
+    int worst = 0;
+    for (size_t i = 0; i < a.px.size(); ++i)
+        worst = std::max(worst, std::abs((int)a.px[i] - (int)b.px[i]));
+    return worst;
+}
+
+static const ResampleFilter kFilters[] = {ResampleFilter::Area, ResampleFilter::Box, ResampleFilter::Bilinear};
+static const char *kFilterNames[] = {"area", "box", "bilinear"};
+
+static void testIdentity(const Image &src, const char *what) {
+    for (int rotQ = 0; rotQ < 4; ++rotQ) {
+        const Image want = rotate(src, rotQ);
+        for (int f = 0; f < 3; ++f) {
+            const Image got = resample(src, rotQ, want.w, want.h, kFilters[f]);
+            CHECK(got.px == want.px, "%s rot %d %s: identity differs from the rotation by up to %d", what, rotQ,
+                  kFilterNames[f], maxChannelDiff(got, want));
+        }
+    }
+}
+
+static void testFusedMatchesTwoPass(const Image &src, const char *what) {
+    const double scales[] = {0.5, 0.75, 0.33, 0.9};
+    for (int rotQ = 0; rotQ < 4; ++rotQ) {
+        const Image rotated = rotate(src, rotQ);
+        for (double scale : scales) {
+            const int dstW = std::max(1, (int)(rotated.w * scale)), dstH = std::max(1, (int)(rotated.h * scale));
+            for (int f = 0; f < 3; ++f) {
+                const Image fused = resample(src, rotQ, dstW, dstH, kFilters[f]);
+                const Image twoPass = resample(rotated, 0, dstW, dstH, kFilters[f]);
+                const int diff = maxChannelDiff(fused, twoPass);
+                CHECK(diff <= ((rotQ & 1) ? 1 : 0), "%s rot %d scale %.2f %s: fused differs from two-pass by %d",
+                      what, rotQ, scale, kFilterNames[f], diff);
+            }
+        }
+    }
+}
+
+// Box with an integer ratio is an exact block mean (rounded half up), in rotated space.
+static void testBoxBlockMean(const Image &src, int ratio) {
+    for (int rotQ = 0; rotQ < 4; ++rotQ) {
+        const Image rotated = rotate(src, rotQ);
+        const Image got = resample(src, rotQ, rotated.w / ratio, rotated.h / ratio, ResampleFilter::Box);
+        int wrong = 0;
+        for (int y = 0; y < got.h; ++y)
+            for (int x = 0; x < got.w; ++x)
+                for (int c = 0; c < 4; ++c) {
+                    int sum = 0;
+                    for (int by = 0; by < ratio; ++by)
+                        for (int bx = 0; bx < ratio; ++bx)
+                            sum += rotated.at(x * ratio + bx, y * ratio + by)[c];
+                    const int n = ratio * ratio;
+                    wrong += got.at(x, y)[c] != (sum + n / 2) / n;
+                }
+        CHECK(wrong == 0, "rot %d box %d:1: %d channels differ from the block mean", rotQ, ratio, wrong);
+    }
+}
+
+// Per-axis filter weights in floating point, following the definitions in FrameResampler.h.
+static std::vector<std::vector<std::pair<int, double>>> axisWeights(int s, int d, ResampleFilter filter) {
+    std::vector<std::vector<std::pair<int, double>>> out((size_t)d);
+    for (int i = 0; i < d; ++i) {
+        auto &taps = out[(size_t)i];
+        if (filter == ResampleFilter::Box) {
+            const int n = std::clamp((int)std::lround((double)s / d), 1, s);
+            const int k0 = std::min(s - n, (int)((int64_t)i * s / d));
+            for (int k = 0; k < n; ++k)
+                taps.emplace_back(k0 + k, 1.0 / n);
+        } else if (filter == ResampleFilter::Bilinear) {
+            const double c = std::clamp(((2.0 * i + 1) * s - d) / (2.0 * d), 0.0, (double)(s - 1));
+            const int k0 = (int)c;
+            taps.emplace_back(k0, 1.0 - (c - k0));
+            if (k0 + 1 < s)
+                taps.emplace_back(k0 + 1, c - k0);
+        } else {
+            const double a = (double)i * s / d, b = (double)(i + 1) * s / d;
+            for (int k = (int)a; k < b && k < s; ++k)
+                taps.emplace_back(k, (std::min(b, k + 1.0) - std::max(a, (double)k)) / ((double)s / d));
+        }
+    }
+    return out;
+}
+
+// Any ratio, any filter: within one step per channel of the floating-point filter (weights are 14-bit fixed
+// point and line sums are rounded once).
+static void testAgainstFloat(const Image &src, const char *what) {
+    const int sizes[][2] = {{src.w * 2 / 3, src.h * 2 / 3}, {src.w / 3 + 1, src.h / 2 + 1}, {src.w - 1, src.h - 3}};
+    for (int rotQ = 0; rotQ < 4; ++rotQ) {
+        const Image rotated = rotate(src, rotQ);
+        for (const auto &size : sizes) {
+            const int dstW = (rotQ & 1) ? size[1] : size[0], dstH = (rotQ & 1) ? size[0] : size[1];
+            for (int f = 0; f < 3; ++f) {
+                const Image got = resample(src, rotQ, dstW, dstH, kFilters[f]);
+                const auto wx = axisWeights(rotated.w, dstW, kFilters[f]);
+                const auto wy = axisWeights(rotated.h, dstH, kFilters[f]);
+                int worst = 0;
+                for (int y = 0; y < dstH; ++y)
+                    for (int x = 0; x < dstW; ++x)
+                        for (int c = 0; c < 4; ++c) {
+                            double v = 0.0;
+                            for (const auto &ty : wy[(size_t)y])
+                                for (const auto &tx : wx[(size_t)x])
+                                    v += ty.second * tx.second * rotated.at(tx.first, ty.first)[c];
+                            worst = std::max(worst, std::abs((int)got.at(x, y)[c] - (int)std::lround(v)));
+                        }
+                CHECK(worst <= 1, "%s rot %d %dx%d %s: off by %d from the exact filter", what, rotQ, dstW, dstH,
+                      kFilterNames[f], worst);
+            }
+        }
+    }
+}
+
+static void testPartialRender(const Image &src) {
+    for (int rotQ = 0; rotQ < 4; ++rotQ) {
+        const int dstW = ((rotQ & 1) ? src.h : src.w) * 2 / 3, dstH = ((rotQ & 1) ? src.w : src.h) * 2 / 3;
+        const Image full = resample(src, rotQ, dstW, dstH, ResampleFilter::Area);
+        FrameResampler r;
+        r.configure(src.w, src.h, rotQ, dstW, dstH, ResampleFilter::Area);
+        Image part(dstW, dstH);
+        TraceRandom rnd((uint64_t)rotQ + 1);
+        for (int i = 0; i < 40; ++i) {
+            DirtyRect rect = {rnd.range(0, dstW - 1), rnd.range(0, dstH - 1), 0, 0};
+            rect.w = rnd.range(1, dstW - rect.x);
+            rect.h = rnd.range(1, dstH - rect.y);
+            r.render(src.px.data(), src.bpr(), part.px.data(), part.bpr(), rect);
+        }
+        r.renderRows(src.px.data(), src.bpr(), part.px.data(), part.bpr(), 0, dstH); // fill what rects missed
+        CHECK(part.px == full.px, "rot %d: rect renders differ from a full render", rotQ);
+    }
+}
+
+int main() {
+    // A UI frame from a trace (text, flat fills, noise) and an odd-sized noise image for the edges
+    Image ui;
+    std::vector<FrameTrace> traces = loadTraces();
+    if (!traces.empty()) {
+        FrameTrace &trace = traces[0];
+        trace.rewind();
+        for (int i = 0; i < 6 && trace.next();)
+            ++i;
+        ui = Image(trace.width(), trace.height());
+        memcpy(ui.px.data(), trace.pixels(), ui.px.size());
+    }
+    const Image noise = noiseImage(97, 61, 7);
+
+    testBoxBlockMean(noiseImage(96, 64, 8), 2);
+    testBoxBlockMean(noiseImage(96, 64, 9), 4);
+    testAgainstFloat(noise, "noise");
+    testIdentity(noise, "noise");
+    testFusedMatchesTwoPass(noise, "noise");
+    testPartialRender(noise);
+    if (ui.w > 0) {
+        testIdentity(ui, "ui");
+        testFusedMatchesTwoPass(ui, "ui");
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,320 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "FrameTrace.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+
+static const uint32_t kTextInk = 0x1C1C1E;
+static const uint32_t kTextPaper = 0xFFFFFF;
+static const int kTextLinePitch = 22; // rows per text line (12 glyph rows + leading)
+static const int kGlyphRows = 12;
+
+// MARK: - Parsing
+
+bool FrameTrace::load(const char *path, std::string *error) {
+    std::ifstream in(path);
+    if (!in) {
+        if (error)
+            *error = std::string("cannot open ") + path;
+        return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    if (!parse(ss.str(), error))
+        return false;
+    mName = path;
+    size_t slash = mName.find_last_of('/');
+    if (slash != std::string::npos)
+        mName.erase(0, slash + 1);
+    size_t dot = mName.rfind('.');
+    if (dot != std::string::npos)
+        mName.resize(dot);
+    return true;
+}
+
+bool FrameTrace::parse(const std::string &text, std::string *error) {
+    mName.clear();
+    mWidth = mHeight = 0;
+    mFrames.clear();
+    std::istringstream lines(text);
+    std::string line;
+    int lineNo = 0;
+    auto fail = [&](const std::string &msg) {
+        if (error)
+            *error = "line " + std::to_string(lineNo) + ": " + msg;
+        return false;
+    };
+    while (std::getline(lines, line)) {
+        lineNo++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos)
+            line.resize(hash);
+        std::istringstream tok(line);
+        std::string word;
+        if (!(tok >> word))
+            continue;
+        if (word == "trace") {
+            if (!(tok >> mWidth >> mHeight) || mWidth <= 0 || mHeight <= 0)
+                return fail("bad trace header");
+            continue;
+        }
+        if (mWidth <= 0)
+            return fail("missing trace header");
+        if (word == "frame") {
+            mFrames.emplace_back();
+            continue;
+        }
+        if (mFrames.empty())
+            return fail("operation outside a frame");
+        Op op;
+        DirtyRect &r = op.rect;
+        bool ok = true;
+        if (word == "base") {
+            op.kind = OpKind::Base;
+            r = DirtyRect{0, 0, mWidth, mHeight};
+            ok = (bool)(tok >> op.seed);
+        } else if (word == "fill") {
+            op.kind = OpKind::Fill;
+            std::string color;
+            ok = (bool)(tok >> r.x >> r.y >> r.w >> r.h >> color);
+            if (ok)
+                op.a = (int)std::stoul(color, nullptr, 16);
+        } else if (word == "text" || word == "noise") {
+            op.kind = word == "text" ? OpKind::Text : OpKind::Noise;
+            ok = (bool)(tok >> r.x >> r.y >> r.w >> r.h >> op.seed);
+        } else if (word == "scroll") {
+            op.kind = OpKind::Scroll;
+            ok = (bool)(tok >> r.x >> r.y >> r.w >> r.h >> op.a >> op.seed);
+        } else if (word == "move") {
+            op.kind = OpKind::Move;
+            ok = (bool)(tok >> r.x >> r.y >> r.w >> r.h >> op.a >> op.b);
+        } else {
+            return fail("unknown operation '" + word + "'");
+        }
+        if (!ok)
+            return fail("bad arguments for '" + word + "'");
+        mFrames.back().push_back(op);
+    }
+    if (mWidth <= 0 || mFrames.empty())
+        return fail("empty trace");
+    rewind();
+    return true;
+}
+
+std::vector<std::string> FrameTrace::listTraces(const char *dir) {
+    std::vector<std::string> out;
+    DIR *d = opendir(dir);
+    if (!d)
+        return out;
+    while (struct dirent *e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() > 6 && name.compare(name.size() - 6, 6, ".trace") == 0)
+            out.push_back(std::string(dir) + "/" + name);
+    }
+    closedir(d);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+// MARK: - Rendering
+
+void FrameTrace::rewind() {
+    mPixels.assign(bytesPerRow() * (size_t)mHeight, 0);
+    mIndex = -1;
+    mDrawn = DirtyRect{0, 0, 0, 0};
+}
+
+bool FrameTrace::next() {
+    if (mIndex + 1 >= frameCount())
+        return false;
+    mIndex++;
+    mDrawn = DirtyRect{0, 0, 0, 0};
+    for (const Op &op : mFrames[(size_t)mIndex])
+        apply(op);
+    return true;
+}
+
+bool FrameTrace::clip(DirtyRect &r) const {
+    int x0 = std::max(r.x, 0), y0 = std::max(r.y, 0);
+    int x1 = std::min(r.x + r.w, mWidth), y1 = std::min(r.y + r.h, mHeight);
+    r = DirtyRect{x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0)};
+    return r.w > 0 && r.h > 0;
+}
+
+void FrameTrace::addDrawn(const DirtyRect &r) {
+    if (r.w <= 0 || r.h <= 0)
+        return;
+    if (mDrawn.w <= 0) {
+        mDrawn = r;
+        return;
+    }
+    int x0 = std::min(mDrawn.x, r.x), y0 = std::min(mDrawn.y, r.y);
+    int x1 = std::max(mDrawn.x + mDrawn.w, r.x + r.w), y1 = std::max(mDrawn.y + mDrawn.h, r.y + r.h);
+    mDrawn = DirtyRect{x0, y0, x1 - x0, y1 - y0};
+}
+
+static inline void putPixel(uint8_t *p, uint32_t rgb) {
+    p[0] = (uint8_t)(rgb & 0xFF);         // B
+    p[1] = (uint8_t)((rgb >> 8) & 0xFF);  // G
+    p[2] = (uint8_t)((rgb >> 16) & 0xFF); // R
+    p[3] = 0xFF;
+}
+
+void FrameTrace::drawFill(const DirtyRect &r, uint32_t rgb) {
+    for (int y = r.y; y < r.y + r.h; ++y) {
+        uint8_t *row = mPixels.data() + (size_t)y * bytesPerRow();
+        for (int x = r.x; x < r.x + r.w; ++x)
+            putPixel(row + (size_t)x * 4, rgb);
+    }
+}
+
+// Lines of random glyphs (5-9 px wide, random bit rows) separated by word gaps: every glyph row is unique,
+// the leading between lines is blank, like rendered text.
+void FrameTrace::drawText(const DirtyRect &r, uint64_t seed) {
+    drawFill(r, kTextPaper);
+    TraceRandom rnd(seed);
+    const int margin = std::min(8, r.w / 8);
+    for (int lineY = r.y + 4; lineY + kGlyphRows <= r.y + r.h; lineY += kTextLinePitch) {
+        int x = r.x + margin;
+        const int lineEnd = r.x + r.w - margin - rnd.range(0, r.w / 3);
+        while (x < lineEnd) {
+            int glyphs = rnd.range(2, 9);
+            for (int g = 0; g < glyphs && x < lineEnd; ++g) {
+                int gw = rnd.range(5, 9);
+                for (int gy = 0; gy < kGlyphRows; ++gy) {
+                    uint64_t bits = rnd.next();
+                    uint8_t *row = mPixels.data() + (size_t)(lineY + gy) * bytesPerRow();
+                    for (int gx = 0; gx < gw && x + gx < lineEnd; ++gx) {
+                        if ((bits >> gx) & 1)
+                            putPixel(row + (size_t)(x + gx) * 4, kTextInk);
+                    }
+                }
+                x += gw + 1;
+            }
+            x += rnd.range(4, 10); // word gap
+        }
+    }
+}
+
+void FrameTrace::drawNoise(const DirtyRect &r, uint64_t seed) {
+    TraceRandom rnd(seed);
+    for (int y = r.y; y < r.y + r.h; ++y) {
+        uint8_t *row = mPixels.data() + (size_t)y * bytesPerRow();
+        for (int x = r.x; x < r.x + r.w; ++x)
+            putPixel(row + (size_t)x * 4, (uint32_t)rnd.next());
+    }
+}
+
+// Status bar, a list of rows with text and separators, and a tab bar with icons, scaled to the frame height.
+void FrameTrace::drawBase(uint64_t seed) {
+    TraceRandom rnd(seed);
+    const int statusH = std::max(20, mHeight * 47 / 844);
+    const int tabH = std::max(24, mHeight * 83 / 844);
+    const int rowH = std::max(32, mHeight * 88 / 844);
+    drawFill(DirtyRect{0, 0, mWidth, mHeight}, 0xF2F2F7);
+    drawText(DirtyRect{mWidth / 2 - 40, 0, 80, statusH}, rnd.next());
+    for (int y = statusH; y + rowH <= mHeight - tabH; y += rowH) {
+        drawText(DirtyRect{0, y, mWidth, rowH - 1}, rnd.next());
+        drawFill(DirtyRect{16, y + rowH - 1, mWidth - 16, 1}, 0xC6C6C8);
+    }
+    DirtyRect tab = {0, mHeight - tabH, mWidth, tabH};
+    drawFill(tab, 0xF9F9F9);
+    const int icons = 5;
+    for (int i = 0; i < icons; ++i) {
+        DirtyRect icon = {mWidth * (2 * i + 1) / (2 * icons) - 12, tab.y + 8, 24, 24};
+        if (clip(icon))
+            drawNoise(icon, rnd.next());
+    }
+}
+
+void FrameTrace::apply(const Op &op) {
+    DirtyRect r = op.rect;
+    switch (op.kind) {
+    case OpKind::Base:
+        drawBase(op.seed);
+        addDrawn(r);
+        return;
+    case OpKind::Fill:
+        if (clip(r)) {
+            drawFill(r, (uint32_t)op.a);
+            addDrawn(r);
+        }
+        return;
+    case OpKind::Text:
+        if (clip(r)) {
+            drawText(r, op.seed);
+            addDrawn(r);
+        }
+        return;
+    case OpKind::Noise:
+        if (clip(r)) {
+            drawNoise(r, op.seed);
+            addDrawn(r);
+        }
+        return;
+    case OpKind::Scroll: {
+        if (!clip(r))
+            return;
+        const int dy = op.a;
+        const size_t bpr = bytesPerRow();
+        const size_t rowBytes = (size_t)r.w * 4;
+        uint8_t *px = mPixels.data() + (size_t)r.x * 4;
+        if (dy != 0 && std::abs(dy) < r.h) {
+            // Rows move by dy; walk away from the destination so nothing is overwritten before it is read
+            if (dy < 0) {
+                for (int y = r.y; y < r.y + r.h + dy; ++y)
+                    memcpy(px + (size_t)y * bpr, px + (size_t)(y - dy) * bpr, rowBytes);
+            } else {
+                for (int y = r.y + r.h - 1; y >= r.y + dy; --y)
+                    memcpy(px + (size_t)y * bpr, px + (size_t)(y - dy) * bpr, rowBytes);
+            }
+        }
+        int exposed = std::min(std::abs(dy), r.h);
+        if (exposed > 0) {
+            DirtyRect strip = {r.x, dy < 0 ? r.y + r.h - exposed : r.y, r.w, exposed};
+            drawText(strip, op.seed);
+        }
+        addDrawn(r);
+        return;
+    }
+    case OpKind::Move: {
+        DirtyRect src = r;
+        if (!clip(src))
+            return;
+        DirtyRect dst = {src.x + op.a, src.y + op.b, src.w, src.h};
+        if (!clip(dst))
+            return;
+        // Source pixels of the clipped destination
+        const int sx = dst.x - op.a, sy = dst.y - op.b;
+        const size_t bpr = bytesPerRow();
+        const size_t rowBytes = (size_t)dst.w * 4;
+        mScratch.resize(rowBytes * (size_t)dst.h);
+        for (int y = 0; y < dst.h; ++y)
+            memcpy(&mScratch[(size_t)y * rowBytes], &mPixels[(size_t)(sy + y) * bpr + (size_t)sx * 4], rowBytes);
+        for (int y = 0; y < dst.h; ++y)
+            memcpy(&mPixels[(size_t)(dst.y + y) * bpr + (size_t)dst.x * 4], &mScratch[(size_t)y * rowBytes], rowBytes);
+        addDrawn(dst);
+        return;
+    }
+    }
+}
@@ -0,0 +1,128 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef FrameTrace_h
+#define FrameTrace_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "RectCoalescer.h"
+
+/**
+ FrameTrace
+ ----------------
+ A recorded sequence of screen frames, stored as the drawing operations that
+ turn each frame into the next one so that traces stay small enough to check
+ in. Frames are rendered into a tightly packed 32-bit BGRA buffer.
+
+ Text format, one operation per line (`#` starts a comment):
+
+     trace <width> <height>
+     frame                         start the next frame (a copy of the previous one)
+     base <seed>                   whole-screen UI: status bar, list rows with text, tab bar
+     fill <x> <y> <w> <h> <rrggbb> solid rect
+     text <x> <y> <w> <h> <seed>   white rect with lines of pseudo-glyphs
+     noise <x> <y> <w> <h> <seed>  random pixels (video, gradients)
+     scroll <x> <y> <w> <h> <dy> <seed>
+                                   move the rect's content by dy rows (dy < 0: up) and fill
+                                   the exposed strip with text
+     move <x> <y> <w> <h> <dx> <dy> copy a block to (x + dx, y + dy)
+
+ Rects are clipped to the frame. The same trace always renders the same
+ pixels, on any platform.
+ */
+class FrameTrace {
+  public:
+    /** Parse a trace file. Returns false (with a message in error) if it is malformed. */
+    bool load(const char *path, std::string *error);
+
+    /** Parse a trace from text. */
+    bool parse(const std::string &text, std::string *error);
+
+    /** File name of the trace without directory and extension (empty if parsed from text). */
+    const std::string &name() const { return mName; }
+
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    size_t bytesPerRow() const { return (size_t)mWidth * 4; }
+    int frameCount() const { return (int)mFrames.size(); }
+
+    /** Restart at the first frame. */
+    void rewind();
+
+    /** Render the next frame into the current frame buffer. Returns false after the last frame. */
+    bool next();
+
+    /** Pixels of the last rendered frame (bytesPerRow() stride). */
+    const uint8_t *pixels() const { return mPixels.data(); }
+    uint8_t *mutablePixels() { return mPixels.data(); }
+
+    /** Index of the last rendered frame (-1 before the first). */
+    int frameIndex() const { return mIndex; }
+
+    /** Bounding box of what the last rendered frame drew (empty if nothing). */
+    const DirtyRect &drawnBounds() const { return mDrawn; }
+
+    /** Trace files in dir ending in .trace, sorted by name. */
+    static std::vector<std::string> listTraces(const char *dir);
+
+  private:
+    enum class OpKind { Base, Fill, Text, Noise, Scroll, Move };
+    struct Op {
+        OpKind kind;
+        DirtyRect rect;
+        int a = 0;         // color (fill), dy (scroll), dx (move)
+        int b = 0;         // dy (move)
+        uint64_t seed = 0; // base, text, noise, scroll
+    };
+
+    void apply(const Op &op);
+    bool clip(DirtyRect &r) const;
+    void drawFill(const DirtyRect &r, uint32_t rgb);
+    void drawText(const DirtyRect &r, uint64_t seed);
+    void drawNoise(const DirtyRect &r, uint64_t seed);
+    void drawBase(uint64_t seed);
+    void addDrawn(const DirtyRect &r);
+
+    std::string mName;
+    int mWidth = 0;
+    int mHeight = 0;
+    std::vector<std::vector<Op>> mFrames;
+    std::vector<uint8_t> mPixels;
+    std::vector<uint8_t> mScratch;
+    int mIndex = -1;
+    DirtyRect mDrawn = {0, 0, 0, 0};
+};
+
+/** splitmix64: small deterministic generator shared by traces, the generator and tests. */
+struct TraceRandom {
+    uint64_t state;
+    explicit TraceRandom(uint64_t seed) : state(seed) {}
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    /** Uniform in [lo, hi]. */
+    int range(int lo, int hi) { return hi <= lo ? lo : lo + (int)(next() % (uint64_t)(hi - lo + 1)); }
+};
+
+#endif /* FrameTrace_h */
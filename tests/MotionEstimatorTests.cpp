@@ -0,0 +1,95 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// MotionEstimator on every trace, following detectMoves() in the server: the dirty rects of each frame are searched
+// for blocks of the previous frame, and the moves go out as CopyRect. Applying them to the previous frame must
+// reproduce the new frame byte for byte in every moved rect, and moves only cover dirty tiles. The traces with
+// sliding content (scroll, mixed) must yield moves.
+
+#include <cstring>
+#include <vector>
+
+#include "MotionEstimator.h"
+#include "TestSupport.h"
+#include "TileDiffEngine.h"
+
+static const int kTileSize = 32;
+static const int kMaxRects = 256;
+static const int kMaxMoves = 16; // cMaxMoves
+
+static int checkTrace(FrameTrace &trace) {
+    const int W = trace.width(), H = trace.height();
+    const size_t bpr = trace.bytesPerRow();
+    TileDiffEngine engine;
+    engine.configure(W, H, kTileSize, 4);
+    MotionEstimator estimator;
+    estimator.configure(W, H, kTileSize, 4);
+
+    std::vector<uint8_t> prev(bpr * (size_t)H, 0);
+    std::vector<DirtyRect> rects((size_t)kMaxRects);
+    DirtyRect moves[kMaxMoves];
+    int hits = 0;
+    trace.rewind();
+    while (trace.next()) {
+        const uint8_t *cur = trace.pixels();
+        engine.hashFull(cur, bpr);
+        int count = engine.buildDirtyRects(rects.data(), kMaxRects, nullptr);
+        engine.swapHashes();
+        if (trace.frameIndex() > 0 && count > 0) {
+            int dx = 0, dy = 0;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            int moveCount = estimator.search(cur, prev.data(), bpr, rects.data(), count, deadline, moves, kMaxMoves,
+                                             &dx, &dy);
+            CHECK(moveCount >= 0 && moveCount <= kMaxMoves, "%s frame %d: %d moves", trace.name().c_str(),
+                  trace.frameIndex(), moveCount);
+            if (moveCount > 0) {
+                hits++;
+                CHECK(dx != 0 || dy != 0, "%s frame %d: moves by (0,0)", trace.name().c_str(), trace.frameIndex());
+                int bad = firstWrongMove(cur, prev.data(), bpr, W, H, moves, moveCount, dx, dy);
+                const DirtyRect &mv = moves[bad < 0 ? 0 : bad];
+                CHECK(bad < 0, "%s frame %d: move %d,%d %dx%d by (%d,%d) does not reproduce the frame",
+                      trace.name().c_str(), trace.frameIndex(), mv.x, mv.y, mv.w, mv.h, dx, dy);
+                std::vector<uint8_t> dirty = tileCoverage(rects.data(), count, engine.tilesX(), engine.tilesY(),
+                                                          kTileSize);
+                std::vector<uint8_t> moved = tileCoverage(moves, moveCount, engine.tilesX(), engine.tilesY(),
+                                                          kTileSize);
+                int outside = 0;
+                for (size_t i = 0; i < dirty.size(); ++i)
+                    outside += moved[i] && !dirty[i];
+                CHECK(outside == 0, "%s frame %d: moves cover %d clean tiles", trace.name().c_str(),
+                      trace.frameIndex(), outside);
+                int ia = -1, ib = -1;
+                CHECK(!rectsOverlap(moves, moveCount, &ia, &ib), "%s frame %d: moves %d and %d overlap",
+                      trace.name().c_str(), trace.frameIndex(), ia, ib);
+                estimator.remember(dx, dy);
+            }
+        }
+        memcpy(prev.data(), cur, prev.size());
+    }
+    printf("%-12s %3d frames with moves\n", trace.name().c_str(), hits);
+    return hits;
+}
+
+int main() {
+    std::vector<FrameTrace> traces = loadTraces();
+    for (FrameTrace &trace : traces) {
+        int hits = checkTrace(trace);
+        if (trace.name() == "scroll" || trace.name() == "mixed")
+            CHECK(hits > 0, "%s: no moves found", trace.name().c_str());
+    }
+    return TEST_RESULT();
+}
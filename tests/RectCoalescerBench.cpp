@@ -0,0 +1,132 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Estimated update bytes of the coalesced rects against the pre-engine policy (runs merged vertically, pending
+// and current rects sent together, everything collapsed to the bounding box at the rect limit), on every trace
+// with the server's defaults: 32 px tiles, a flush every 2 frames, 256 rects, 64 header bytes per rect.
+// Also checks on random rect sets that reduce() covers its input with no two rects overlapping.
+
+#include <vector>
+
+#include "BaselineTiling.h"
+#include "TestSupport.h"
+#include "TileDiffEngine.h"
+
+static const int kTileSize = 32;
+static const int kDefer = 2;
+static const int kMaxRects = 256; // gMaxRectsLimit
+
+struct Totals {
+    double bytes = 0.0;
+    double pixels = 0.0;
+    int rects = 0;
+};
+
+static void benchTrace(FrameTrace &trace, const std::string &name) {
+    const size_t bpr = trace.bytesPerRow();
+    RectCoalescer model; // default cost model, same as the server's
+    BaselineTiling base;
+    base.configure(trace.width(), trace.height(), kTileSize);
+    TileDiffEngine engine;
+    engine.configure(trace.width(), trace.height(), kTileSize, 4);
+    engine.setRectCostModel(model.headerBytes(), model.pixelBytes());
+
+    std::vector<DirtyRect> baseRects(2 * (size_t)kMaxRects), engineRects((size_t)kMaxRects);
+    Totals b, e;
+    int flushes = 0;
+    trace.rewind();
+    while (trace.next()) {
+        base.hash(trace.pixels(), bpr);
+        base.accumulatePending();
+        engine.hashFull(trace.pixels(), bpr);
+        engine.accumulatePending();
+        if ((trace.frameIndex() + 1) % kDefer != 0)
+            continue;
+        flushes++;
+        int tiles = 0;
+        int nb = base.flush(baseRects.data(), kMaxRects, &tiles);
+        int ne = engine.buildRectsFromPending(engineRects.data(), kMaxRects);
+        engine.clearPending();
+        engine.swapHashes();
+        int ia = -1, ib = -1;
+        CHECK(!rectsOverlap(engineRects.data(), ne, &ia, &ib), "%s frame %d: rects %d and %d overlap", name.c_str(),
+              trace.frameIndex(), ia, ib);
+        b.bytes += model.cost(baseRects.data(), nb);
+        e.bytes += model.cost(engineRects.data(), ne);
+        for (int i = 0; i < nb; ++i)
+            b.pixels += (double)baseRects[(size_t)i].w * baseRects[(size_t)i].h;
+        for (int i = 0; i < ne; ++i)
+            e.pixels += (double)engineRects[(size_t)i].w * engineRects[(size_t)i].h;
+        b.rects += nb;
+        e.rects += ne;
+    }
+    printf("%-18s %3d flushes | baseline %9.0f bytes %6d rects %9.0f px | coalesced %9.0f bytes %6d rects %9.0f px"
+           " | %5.1f%% fewer bytes\n",
+           name.c_str(), flushes, b.bytes, b.rects, b.pixels, e.bytes, e.rects, e.pixels,
+           b.bytes > 0 ? 100.0 * (b.bytes - e.bytes) / b.bytes : 0.0);
+    CHECK(e.bytes <= b.bytes, "%s: coalesced rects cost %.0f bytes, baseline %.0f", name.c_str(), e.bytes, b.bytes);
+}
+
+// Random tile-aligned rect sets, as the sweep produces them, plus unaligned ones as callers pass them.
+static void checkReduce() {
+    TraceRandom rnd(9);
+    RectCoalescer coalescer;
+    for (int c = 0; c < 300; ++c) {
+        const int W = 390, H = 844;
+        const bool aligned = c % 2 == 0;
+        std::vector<DirtyRect> in((size_t)rnd.range(1, 120));
+        for (DirtyRect &r : in) {
+            if (aligned) {
+                r.x = rnd.range(0, W / 16 - 1) * 16;
+                r.y = rnd.range(0, H / 16 - 1) * 16;
+                r.w = std::min(W - r.x, rnd.range(1, 6) * 16);
+                r.h = std::min(H - r.y, rnd.range(1, 6) * 16);
+            } else {
+                r.w = rnd.range(1, 90), r.h = rnd.range(1, 90);
+                r.x = rnd.range(0, W - r.w), r.y = rnd.range(0, H - r.h);
+            }
+        }
+        coalescer.setCostModel(c % 3 == 0 ? 0.0 : 64.0, 1.0);
+        const int maxRects = c % 5 == 0 ? rnd.range(1, 8) : 256;
+        std::vector<DirtyRect> out = in;
+        int n = coalescer.reduce(out.data(), (int)out.size(), maxRects);
+        CHECK(n >= 1 && n <= std::min(maxRects, (int)in.size()), "case %d: %d rects (limit %d, input %zu)", c, n,
+              maxRects, in.size());
+        int ia = -1, ib = -1;
+        CHECK(!rectsOverlap(out.data(), n, &ia, &ib), "case %d: rects %d and %d overlap", c, ia, ib);
+        // Every input pixel is covered (check on a coarse grid of the input rects' corners and centers)
+        for (const DirtyRect &r : in) {
+            const int px[] = {r.x, r.x + r.w / 2, r.x + r.w - 1}, py[] = {r.y, r.y + r.h / 2, r.y + r.h - 1};
+            for (int x : px)
+                for (int y : py) {
+                    bool covered = false;
+                    for (int i = 0; i < n && !covered; ++i)
+                        covered = x >= out[(size_t)i].x && x < out[(size_t)i].x + out[(size_t)i].w &&
+                                  y >= out[(size_t)i].y && y < out[(size_t)i].y + out[(size_t)i].h;
+                    CHECK(covered, "case %d: pixel %d,%d not covered", c, x, y);
+                }
+        }
+    }
+}
+
+int main() {
+    checkReduce();
+    std::vector<FrameTrace> traces = loadTraces();
+    for (FrameTrace &trace : traces)
+        benchTrace(trace, trace.name());
+    return TEST_RESULT();
+}
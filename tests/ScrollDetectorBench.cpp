@@ -0,0 +1,110 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Estimated update bytes with and without scroll detection, on every trace, following detectMoves() in the
+// server: the dirty rects of each frame are searched for content of the previous frame that moved, moves go out
+// as CopyRect and the rects left over are encoded. Every reported move is verified against the previous frame.
+// The scroll trace must save bytes.
+
+#include <cstring>
+#include <vector>
+
+#include "ScrollDetector.h"
+#include "TestSupport.h"
+#include "TileDiffEngine.h"
+
+static const int kTileSize = 32;
+static const int kMaxRects = 256;
+static const int kMaxMoves = 16;         // cMaxMoves
+static const double kCopyRectBytes = 16; // rect header + source position
+
+static double benchTrace(FrameTrace &trace) {
+    const int W = trace.width(), H = trace.height();
+    const size_t bpr = trace.bytesPerRow();
+    RectCoalescer model;
+    TileDiffEngine engine;
+    engine.configure(W, H, kTileSize, 4);
+    ScrollDetector detector;
+    detector.configure(16, 8); // cScrollMinLines, cScrollMinVotes
+
+    std::vector<uint8_t> prev(bpr * (size_t)H, 0);
+    std::vector<DirtyRect> rects((size_t)kMaxRects), remainder((size_t)kMaxRects);
+    DirtyRect moves[kMaxMoves];
+    double without = 0.0, with = 0.0;
+    int frames = 0, hits = 0;
+    trace.rewind();
+    while (trace.next()) {
+        const uint8_t *cur = trace.pixels();
+        engine.hashFull(cur, bpr);
+        int count = engine.buildDirtyRects(rects.data(), kMaxRects, nullptr);
+        engine.swapHashes();
+        double plain = model.cost(rects.data(), count);
+        without += plain;
+        frames++;
+
+        int x0 = W, y0 = H, x1 = 0, y1 = 0;
+        for (int i = 0; i < count; ++i) {
+            x0 = std::min(x0, rects[(size_t)i].x);
+            y0 = std::min(y0, rects[(size_t)i].y);
+            x1 = std::max(x1, rects[(size_t)i].x + rects[(size_t)i].w);
+            y1 = std::max(y1, rects[(size_t)i].y + rects[(size_t)i].h);
+        }
+        int moveCount = 0, dx = 0, dy = 0, remaining = -1;
+        if (trace.frameIndex() > 0 && x1 > x0 && y1 > y0) {
+            DirtyRect region = {x0, y0, x1 - x0, y1 - y0};
+            moveCount = detector.detect(cur, prev.data(), bpr, 4, region, false, moves, kMaxMoves, &dx, &dy);
+            if (moveCount > 0)
+                remaining = ScrollDetector::subtractRects(rects.data(), count, moves, moveCount, remainder.data(),
+                                                          kMaxRects);
+        }
+        if (moveCount > 0 && remaining >= 0) {
+            hits++;
+            for (int m = 0; m < moveCount; ++m) {
+                const DirtyRect &mv = moves[m];
+                bool same = mv.x - dx >= 0 && mv.y - dy >= 0 && mv.x - dx + mv.w <= W && mv.y - dy + mv.h <= H;
+                for (int y = 0; same && y < mv.h; ++y)
+                    same = memcmp(cur + (size_t)(mv.y + y) * bpr + (size_t)mv.x * 4,
+                                  prev.data() + (size_t)(mv.y - dy + y) * bpr + (size_t)(mv.x - dx) * 4,
+                                  (size_t)mv.w * 4) == 0;
+                CHECK(same, "%s frame %d: move %d,%d %dx%d by (%d,%d) does not match the previous frame",
+                      trace.name().c_str(), trace.frameIndex(), mv.x, mv.y, mv.w, mv.h, dx, dy);
+            }
+            with += model.cost(remainder.data(), remaining) + kCopyRectBytes * moveCount;
+        } else {
+            with += plain;
+        }
+        memcpy(prev.data(), cur, prev.size());
+    }
+    const double saved = without - with;
+    printf("%-12s %3d frames, %3d with moves | %10.0f bytes without, %10.0f with | %5.1f%% saved\n",
+           trace.name().c_str(), frames, hits, without, with, without > 0 ? 100.0 * saved / without : 0.0);
+    return saved;
+}
+
+int main() {
+    std::vector<FrameTrace> traces = loadTraces();
+    bool sawScroll = false;
+    for (FrameTrace &trace : traces) {
+        double saved = benchTrace(trace);
+        if (trace.name() == "scroll") {
+            sawScroll = true;
+            CHECK(saved > 0, "scroll: scroll detection saved %.0f bytes", saved);
+        }
+    }
+    CHECK(sawScroll, "no scroll trace");
+    return TEST_RESULT();
+}
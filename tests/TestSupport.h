@@ -0,0 +1,135 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TestSupport_h
+#define TestSupport_h
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "FrameTrace.h"
+#include "RectCoalescer.h"
+
+// Minimal check helpers: a failed check is reported and counted, the test keeps going and main() returns
+// TEST_RESULT() so that ctest sees the failure.
+
+inline int &testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond, ...)                                                                                               \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            testFailures()++;                                                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, #cond);                                   \
+            fprintf(stderr, __VA_ARGS__);                                                                              \
+            fputc('\n', stderr);                                                                                       \
+        }                                                                                                              \
+    } while (0)
+
+#define TEST_RESULT()                                                                                                  \
+    (testFailures() == 0 ? (printf("OK\n"), 0) : (fprintf(stderr, "%d check(s) failed\n", testFailures()), 1))
+
+/** Load every checked-in trace, failing the test if there are none or one is malformed. */
+inline std::vector<FrameTrace> loadTraces() {
+    std::vector<FrameTrace> traces;
+    for (const std::string &path : FrameTrace::listTraces(TVNC_TRACE_DIR)) {
+        FrameTrace trace;
+        std::string error;
+        bool loaded = trace.load(path.c_str(), &error);
+        CHECK(loaded, "%s: %s", path.c_str(), error.c_str());
+        if (loaded)
+            traces.push_back(std::move(trace));
+    }
+    CHECK(!traces.empty(), "no traces in %s", TVNC_TRACE_DIR);
+    return traces;
+}
+
+/** Mark every tile a rect list touches (one byte per tile, row-major). */
+inline std::vector<uint8_t> tileCoverage(const DirtyRect *rects, int count, int tilesX, int tilesY, int tileSize) {
+    std::vector<uint8_t> mask((size_t)tilesX * (size_t)tilesY, 0);
+    for (int i = 0; i < count; ++i) {
+        const DirtyRect &r = rects[i];
+        if (r.w <= 0 || r.h <= 0)
+            continue;
+        for (int ty = r.y / tileSize; ty <= (r.y + r.h - 1) / tileSize && ty < tilesY; ++ty)
+            for (int tx = r.x / tileSize; tx <= (r.x + r.w - 1) / tileSize && tx < tilesX; ++tx)
+                mask[(size_t)ty * (size_t)tilesX + (size_t)tx] = 1;
+    }
+    return mask;
+}
+
+/** Whether any two rects of the list share a pixel. */
+inline bool rectsOverlap(const DirtyRect *rects, int count, int *outA = nullptr, int *outB = nullptr) {
+    for (int i = 0; i < count; ++i)
+        for (int j = i + 1; j < count; ++j) {
+            const DirtyRect &a = rects[i], &b = rects[j];
+            if (a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h) {
+                if (outA)
+                    *outA = i;
+                if (outB)
+                    *outB = j;
+                return true;
+            }
+        }
+    return false;
+}
+
+/** Apply CopyRect moves (destination rects, source at x - dx, y - dy) to a copy of prev, as a client would, and
+    return the index of the first move whose rect then differs from cur (or whose source leaves the frame), -1 if
+    they all reproduce it. */
+inline int firstWrongMove(const uint8_t *cur, const uint8_t *prev, size_t bytesPerRow, int width, int height,
+                          const DirtyRect *moves, int moveCount, int dx, int dy) {
+    std::vector<uint8_t> client(prev, prev + bytesPerRow * (size_t)height);
+    for (int m = 0; m < moveCount; ++m) {
+        const DirtyRect &mv = moves[m];
+        if (mv.x < 0 || mv.y < 0 || mv.x + mv.w > width || mv.y + mv.h > height || mv.x - dx < 0 || mv.y - dy < 0 ||
+            mv.x - dx + mv.w > width || mv.y - dy + mv.h > height)
+            return m;
+        for (int y = 0; y < mv.h; ++y)
+            memcpy(client.data() + (size_t)(mv.y + y) * bytesPerRow + (size_t)mv.x * 4,
+                   prev + (size_t)(mv.y - dy + y) * bytesPerRow + (size_t)(mv.x - dx) * 4, (size_t)mv.w * 4);
+    }
+    for (int m = 0; m < moveCount; ++m) {
+        const DirtyRect &mv = moves[m];
+        for (int y = 0; y < mv.h; ++y) {
+            size_t at = (size_t)(mv.y + y) * bytesPerRow + (size_t)mv.x * 4;
+            if (memcmp(client.data() + at, cur + at, (size_t)mv.w * 4) != 0)
+                return m;
+        }
+    }
+    return -1;
+}
+
+/** Wall-clock seconds of the best of `runs` calls of fn. */
+template <typename Fn> double bestSeconds(int runs, Fn fn) {
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (s < best)
+            best = s;
+    }
+    return best;
+}
+
+#endif /* TestSupport_h */
@@ -0,0 +1,389 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// TileDiffEngine against the pre-engine dirty detection (BaselineTiling) on the checked-in traces.
+//
+// Both run the server's defer flow: every frame is hashed and accumulated into pending, and every `defer`
+// frames the pending tiles plus the current frame's changes are flushed as rects. The rects must cover exactly
+// the tiles the baseline reports. Under a zero rect header the coalescer only merges exactly adjacent runs, so
+// the covered tiles are the dirty tiles themselves; under the default model merges may cover clean tiles too,
+// but never miss a dirty one.
+
+#include <cstring>
+#include <vector>
+
+#include "BaselineTiling.h"
+#include "TestSupport.h"
+#include "TileDiffEngine.h"
+
+static const int kMaxRects = 4096; // large enough that the baseline never collapses to its bounding box
+
+static int countTiles(const std::vector<uint8_t> &mask) {
+    int n = 0;
+    for (uint8_t m : mask)
+        n += m;
+    return n;
+}
+
+struct RunConfig {
+    int tileSize;
+    int defer;
+    TileHashKernel kernel;
+    TileDiffMode mode;
+    bool exactCost; // zero rect header: coverage must equal the baseline tiles
+};
+
+static void runTrace(FrameTrace &trace, const RunConfig &cfg, const char *name) {
+    const int W = trace.width(), H = trace.height();
+    const size_t bpr = trace.bytesPerRow();
+
+    BaselineTiling base;
+    base.configure(W, H, cfg.tileSize);
+
+    TileDiffEngine engine;
+    engine.setHashKernel(cfg.kernel);
+    engine.setDiffMode(cfg.mode);
+    engine.configure(W, H, cfg.tileSize, 4);
+    if (cfg.exactCost)
+        engine.setRectCostModel(0.0, 1.0);
+
+    // Compare mode diffs against what was last flushed; it starts black like a fresh framebuffer.
+    std::vector<uint8_t> published(bpr * (size_t)H, 0);
+    std::vector<DirtyRect> baseRects(2 * (size_t)kMaxRects), engineRects((size_t)kMaxRects);
+
+    trace.rewind();
+    int frame = 0, flushes = 0;
+    while (trace.next()) {
+        const uint8_t *px = trace.pixels();
+        base.hash(px, bpr);
+        base.accumulatePending();
+        if (cfg.mode == TileDiffMode::Compare)
+            engine.compareFull(px, published.data(), bpr);
+        else
+            engine.hashFull(px, bpr);
+        engine.accumulatePending();
+
+        if (++frame % cfg.defer != 0 && trace.frameIndex() + 1 < trace.frameCount())
+            continue;
+        flushes++;
+
+        int baseTiles = 0;
+        int baseCount = base.flush(baseRects.data(), kMaxRects, &baseTiles);
+        CHECK(baseCount < kMaxRects, "%s: baseline collapsed", name);
+        std::vector<uint8_t> want = tileCoverage(baseRects.data(), baseCount, base.tilesX(), base.tilesY(),
+                                                 cfg.tileSize);
+
+        int engineTiles = 0;
+        int engineCount = engine.buildRectsFromPending(engineRects.data(), kMaxRects, &engineTiles);
+        engine.clearPending();
+        if (cfg.mode == TileDiffMode::Compare)
+            memcpy(published.data(), px, published.size());
+        else
+            engine.swapHashes();
+        std::vector<uint8_t> got = tileCoverage(engineRects.data(), engineCount, engine.tilesX(), engine.tilesY(),
+                                                cfg.tileSize);
+
+        CHECK(engineTiles == countTiles(want), "%s frame %d: engine reports %d tiles, baseline %d", name,
+              trace.frameIndex(), engineTiles, countTiles(want));
+        int missed = 0, extra = 0;
+        for (size_t i = 0; i < want.size(); ++i) {
+            missed += want[i] && !got[i];
+            extra += got[i] && !want[i];
+        }
+        CHECK(missed == 0, "%s frame %d: %d dirty tiles not covered", name, trace.frameIndex(), missed);
+        if (cfg.exactCost)
+            CHECK(extra == 0, "%s frame %d: %d clean tiles covered", name, trace.frameIndex(), extra);
+        int ia = -1, ib = -1;
+        CHECK(!rectsOverlap(engineRects.data(), engineCount, &ia, &ib), "%s frame %d: rects %d and %d overlap", name,
+              trace.frameIndex(), ia, ib);
+        for (int i = 0; i < engineCount; ++i) {
+            const DirtyRect &r = engineRects[(size_t)i];
+            CHECK(r.w > 0 && r.h > 0 && r.x >= 0 && r.y >= 0 && r.x + r.w <= W && r.y + r.h <= H,
+                  "%s frame %d: rect %d,%d %dx%d out of bounds", name, trace.frameIndex(), r.x, r.y, r.w, r.h);
+        }
+    }
+    CHECK(flushes > 0, "%s: no flushes", name);
+}
+
+// Hash a frame twice so both hash generations (and band fingerprints) are equal, reset, and rehash only the even
+// tile rows: the odd rows now hold the reset hashes and must be reported dirty, like a plain hash compare says.
+static void testResetThenPartialRehash(FrameTrace &trace) {
+    const int tileSize = 32;
+    const size_t bpr = trace.bytesPerRow();
+    trace.rewind();
+    trace.next();
+    TileDiffEngine engine;
+    engine.configure(trace.width(), trace.height(), tileSize, 4);
+    engine.setRectCostModel(0.0, 1.0);
+    for (int i = 0; i < 2; ++i) {
+        engine.hashFull(trace.pixels(), bpr);
+        engine.swapHashes();
+    }
+    engine.resetCurrentHashes();
+    engine.hashTileRows(trace.pixels(), bpr, 0, 2);
+
+    const int tilesX = engine.tilesX(), tilesY = engine.tilesY();
+    std::vector<uint8_t> want(engine.tileCount(), 0);
+    for (size_t i = 0; i < engine.tileCount(); ++i)
+        want[i] = engine.currentHashes()[i] != engine.previousHashes()[i];
+    CHECK(countTiles(want) == tilesX * (tilesY / 2), "reset: %d tiles differ, expected the %d of the odd rows",
+          countTiles(want), tilesX * (tilesY / 2));
+
+    std::vector<DirtyRect> rects((size_t)kMaxRects);
+    int changed = 0;
+    int count = engine.buildDirtyRects(rects.data(), kMaxRects, &changed);
+    std::vector<uint8_t> got = tileCoverage(rects.data(), count, tilesX, tilesY, tileSize);
+    CHECK(got == want, "reset: rects cover %d tiles, hash diff has %d", countTiles(got), countTiles(want));
+    CHECK(changed == countTiles(want), "reset: %d changed tiles reported, hash diff has %d", changed,
+          countTiles(want));
+    CHECK(engine.frameChanged(), "reset: frame fingerprint unchanged");
+}
+
+// Synthetic frames for the hot-region and region-mask tests: 8x8 tiles of 32 pixels, tiles are dirtied by
+// painting a new value into them, and every flush runs the server's sequence.
+
+static const int kGridTile = 32;
+static const int kGridTiles = 8;
+
+struct Grid {
+    int width = kGridTile * kGridTiles, height = kGridTile * kGridTiles;
+    size_t bpr = (size_t)kGridTile * kGridTiles * 4;
+    std::vector<uint8_t> pixels = std::vector<uint8_t>(bpr * (size_t)height, 0);
+    uint32_t value = 0;
+
+    void paint(int tx, int ty) {
+        value++;
+        for (int y = ty * kGridTile; y < (ty + 1) * kGridTile; ++y)
+            for (int x = tx * kGridTile; x < (tx + 1) * kGridTile; ++x)
+                memcpy(pixels.data() + (size_t)y * bpr + (size_t)x * 4, &value, 4);
+    }
+};
+
+static DirtyRect tileRect(int tx, int ty) { return DirtyRect{tx * kGridTile, ty * kGridTile, kGridTile, kGridTile}; }
+
+static void configureGrid(TileDiffEngine &engine, const Grid &grid, int hotFlushes) {
+    engine.configure(grid.width, grid.height, kGridTile, 4);
+    engine.setRectCostModel(0.0, 1.0);
+    engine.setHotThreshold(hotFlushes);
+    engine.hashFull(grid.pixels.data(), grid.bpr); // baseline: the black frame clients start with
+    engine.swapHashes();
+}
+
+// Hash the frame and flush it; returns the tiles the rects cover. Held tiles stay pending unless release is set.
+static std::vector<uint8_t> flushGrid(TileDiffEngine &engine, const Grid &grid, bool holdHot, bool release = false) {
+    engine.hashFull(grid.pixels.data(), grid.bpr);
+    engine.accumulatePending();
+    std::vector<DirtyRect> rects((size_t)kMaxRects);
+    int count = engine.buildRectsFromPending(rects.data(), kMaxRects, nullptr, holdHot);
+    if (release)
+        engine.releaseHeldTiles();
+    engine.updateChangeHistory();
+    engine.clearPending();
+    engine.swapHashes();
+    return tileCoverage(rects.data(), count, kGridTiles, kGridTiles, kGridTile);
+}
+
+static bool covers(const std::vector<uint8_t> &mask, int tx, int ty) {
+    return mask[(size_t)(ty * kGridTiles + tx)] != 0;
+}
+
+// Tiles become hot once dirty in the threshold's number of flushes, and never when they cover over a quarter of the
+// frame (scrolling, dragging).
+static void testHotClassification() {
+    const int threshold = 4;
+    Grid grid;
+    TileDiffEngine engine;
+    configureGrid(engine, grid, threshold);
+    for (int flush = 1; flush <= threshold; ++flush) {
+        grid.paint(1, 1);
+        grid.paint(2, 1);
+        if (flush % 2)
+            grid.paint(6, 6); // dirty in every other flush only
+        flushGrid(engine, grid, false);
+        int want = flush < threshold ? 0 : 2;
+        CHECK(engine.hotTiles() == want, "hot: %d hot tiles after %d flushes, expected %d", engine.hotTiles(), flush,
+              want);
+    }
+    for (int flush = 0; flush < 16; ++flush)
+        flushGrid(engine, grid, false);
+    CHECK(engine.hotTiles() == 0, "hot: %d hot tiles after 16 idle flushes", engine.hotTiles());
+
+    const int wide = kGridTiles * kGridTiles / 4 + 1;
+    for (int flush = 0; flush < threshold; ++flush) {
+        for (int i = 0; i < wide; ++i)
+            grid.paint(i % kGridTiles, i / kGridTiles);
+        flushGrid(engine, grid, true);
+    }
+    CHECK(engine.hotTiles() == 0, "hot: %d hot tiles with %d of %d tiles dirty every flush", engine.hotTiles(), wide,
+          kGridTiles * kGridTiles);
+
+    TileDiffEngine off;
+    configureGrid(off, grid, 0);
+    for (int flush = 0; flush < 16; ++flush) {
+        grid.paint(1, 1);
+        flushGrid(off, grid, false);
+    }
+    CHECK(off.hotTiles() == 0, "hot: threshold 0 classified %d tiles hot", off.hotTiles());
+}
+
+// Dirty hot tiles are held out of the rects and stay pending; their content is restored from the published frame.
+// A flush without holding sends them, a released hold drops them from pending, and focus tiles are never held.
+static void testHeldTiles() {
+    const int threshold = 4;
+    Grid grid;
+    TileDiffEngine engine;
+    configureGrid(engine, grid, threshold);
+    for (int flush = 0; flush < threshold; ++flush) {
+        grid.paint(1, 1);
+        flushGrid(engine, grid, false);
+    }
+    CHECK(engine.hotTiles() == 1, "held: %d hot tiles, expected 1", engine.hotTiles());
+    std::vector<uint8_t> published = grid.pixels;
+
+    // Held: only the cold tile goes out, the hot one stays pending and is restored from the published frame
+    grid.paint(1, 1);
+    grid.paint(5, 3);
+    engine.hashFull(grid.pixels.data(), grid.bpr);
+    engine.accumulatePending();
+    std::vector<DirtyRect> rects((size_t)kMaxRects);
+    int count = engine.buildRectsFromPending(rects.data(), kMaxRects, nullptr, true);
+    std::vector<uint8_t> got = tileCoverage(rects.data(), count, kGridTiles, kGridTiles, kGridTile);
+    CHECK(!covers(got, 1, 1) && covers(got, 5, 3), "held: hot tile sent or cold tile missing");
+    CHECK(engine.heldTiles() == 1, "held: %d held tiles, expected 1", engine.heldTiles());
+    std::vector<uint8_t> back = grid.pixels;
+    engine.restoreHeldTiles(back.data(), published.data(), grid.bpr);
+    CHECK(memcmp(back.data(), published.data(), grid.bpr) == 0, "held: untouched row changed");
+    bool restored = true, keptCold = true;
+    for (int y = kGridTile; y < 2 * kGridTile; ++y)
+        restored &= memcmp(back.data() + (size_t)y * grid.bpr + (size_t)kGridTile * 4,
+                           published.data() + (size_t)y * grid.bpr + (size_t)kGridTile * 4, (size_t)kGridTile * 4) == 0;
+    for (int y = 3 * kGridTile; y < 4 * kGridTile; ++y)
+        keptCold &= memcmp(back.data() + (size_t)y * grid.bpr, grid.pixels.data() + (size_t)y * grid.bpr,
+                           grid.bpr) == 0;
+    CHECK(restored, "held: hot tile not restored from the published frame");
+    CHECK(keptCold, "held: cold tile overwritten by the restore");
+    engine.updateChangeHistory();
+    engine.clearPending();
+    engine.swapHashes();
+    CHECK(engine.hasPendingInRect(tileRect(1, 1)), "held: hot tile no longer pending");
+    CHECK(!engine.hasPendingInRect(tileRect(5, 3)), "held: sent tile still pending");
+
+    // Still held while hot, then sent by a flush that does not hold
+    got = flushGrid(engine, grid, true);
+    CHECK(!covers(got, 1, 1) && engine.hasPendingInRect(tileRect(1, 1)), "held: pending hot tile not held again");
+    got = flushGrid(engine, grid, false);
+    CHECK(covers(got, 1, 1), "held: pending hot tile not sent without holding");
+    CHECK(!engine.hasPendingTiles(), "held: tiles pending after sending them");
+
+    // Released: the held tile's content went out after all, so nothing stays pending
+    grid.paint(1, 1);
+    got = flushGrid(engine, grid, true, true);
+    CHECK(!covers(got, 1, 1), "release: hot tile not held");
+    CHECK(!engine.hasPendingTiles(), "release: released tile still pending");
+
+    // Focus: the tile being touched goes out on every flush even while hot
+    CHECK(engine.hotTiles() == 1, "focus: %d hot tiles, expected 1", engine.hotTiles());
+    engine.setFocusRect(DirtyRect{kGridTile + 4, kGridTile + 4, 2, 2});
+    grid.paint(1, 1);
+    got = flushGrid(engine, grid, true);
+    CHECK(covers(got, 1, 1), "focus: focused hot tile held");
+    CHECK(!engine.hasPendingTiles(), "focus: focused hot tile left pending");
+}
+
+// Excluded tiles never show up in rects and are dropped from pending; held regions stay pending until the mask
+// stops holding them. Tiles a mask only partly touches count as masked.
+static void testRegionMasks() {
+    Grid grid;
+    TileDiffEngine engine;
+    configureGrid(engine, grid, 0);
+    const DirtyRect excluded = {2 * kGridTile + 8, 2 * kGridTile, 8, 8}; // inside tile (2,2)
+    const DirtyRect held = {0, 7 * kGridTile, grid.width, kGridTile};    // bottom tile row
+    engine.setRegionMasks(&excluded, 1, &held, 1);
+
+    grid.paint(2, 2);
+    grid.paint(3, 7);
+    grid.paint(5, 4);
+    engine.hashFull(grid.pixels.data(), grid.bpr);
+    engine.accumulatePending();
+    std::vector<DirtyRect> rects((size_t)kMaxRects);
+    int changed = 0;
+    int count = engine.buildRectsFromPending(rects.data(), kMaxRects, &changed);
+    std::vector<uint8_t> got = tileCoverage(rects.data(), count, kGridTiles, kGridTiles, kGridTile);
+    CHECK(!covers(got, 2, 2), "mask: excluded tile in rects");
+    CHECK(!covers(got, 3, 7), "mask: held tile in rects");
+    CHECK(covers(got, 5, 4) && countTiles(got) == 1, "mask: rects cover %d tiles, expected only the unmasked one",
+          countTiles(got));
+    CHECK(changed == 1, "mask: %d changed tiles reported, expected 1", changed);
+    CHECK(engine.droppedTiles() == 1 && engine.heldTiles() == 1, "mask: %d dropped, %d held, expected 1 each",
+          engine.droppedTiles(), engine.heldTiles());
+    engine.updateChangeHistory();
+    engine.clearPending();
+    engine.swapHashes();
+    CHECK(!engine.hasPendingInRect(tileRect(2, 2)), "mask: excluded tile left pending");
+    CHECK(engine.hasPendingInRect(tileRect(3, 7)), "mask: held tile not pending");
+
+    // Excluded tiles stay out on later changes too; the held tile goes out once its region is no longer held
+    grid.paint(2, 2);
+    engine.setRegionMasks(&excluded, 1, nullptr, 0);
+    got = flushGrid(engine, grid, false);
+    CHECK(!covers(got, 2, 2), "mask: excluded tile in rects after a new change");
+    CHECK(covers(got, 3, 7), "mask: held tile not sent once released");
+    CHECK(!engine.hasPendingTiles(), "mask: tiles pending after the flush");
+}
+
+int main() {
+    testHotClassification();
+    testHeldTiles();
+    testRegionMasks();
+
+    std::vector<FrameTrace> traces = loadTraces();
+    if (!traces.empty())
+        testResetThenPartialRehash(traces[0]);
+
+    std::vector<TileHashKernel> kernels;
+    for (TileHashKernel k : {TileHashKernel::Scalar, TileHashKernel::CRC32, TileHashKernel::NEON,
+                             TileHashKernel::SSE42, TileHashKernel::AVX2}) {
+        if (TileHashKernelSupported(k))
+            kernels.push_back(k);
+    }
+
+    int runs = 0;
+    for (size_t t = 0; t < traces.size(); ++t) {
+        for (int tileSize : {16, 32, 64}) {
+            for (int defer : {1, 3}) {
+                for (bool exactCost : {true, false}) {
+                    for (TileHashKernel kernel : kernels) {
+                        char name[128];
+                        snprintf(name, sizeof(name), "trace %zu tile %d defer %d %s %s", t, tileSize, defer,
+                                 TileHashKernelName(kernel), exactCost ? "exact" : "default");
+                        runTrace(traces[t], RunConfig{tileSize, defer, kernel, TileDiffMode::Hash, exactCost}, name);
+                        runs++;
+                    }
+                    char name[128];
+                    snprintf(name, sizeof(name), "trace %zu tile %d defer %d compare %s", t, tileSize, defer,
+                             exactCost ? "exact" : "default");
+                    runTrace(traces[t], RunConfig{tileSize, defer, TileHashKernel::Auto, TileDiffMode::Compare,
+                                                  exactCost},
+                             name);
+                    runs++;
+                }
+            }
+        }
+    }
+    printf("%d runs over %zu traces, %zu hash kernels\n", runs, traces.size(), kernels.size());
+    return TEST_RESULT();
+}
@@ -0,0 +1,85 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Cross-kernel checks of the tile hash row functions, over random row widths and tile sizes (including tiles
+// that are not a multiple of 8 bytes and short last tiles):
+// - every kernel's hashRow() equals the same kernel hashing each tile on its own, so the interleaved lanes of
+//   crc32x4_row / sse42_row never mix tiles up;
+// - kernels whose row function is the per-tile update (Scalar, CRC32, SSE42) equal update() tile by tile;
+// - CRC32 equals Scalar bit for bit (on ARM, Scalar is CRC32 too).
+
+#include <vector>
+
+#include "TestSupport.h"
+#include "TileHash.h"
+
+static const int kRowsPerCase = 3; // hashes chain across rows like the rows of a tile
+
+int main() {
+    TraceRandom rnd(2025);
+    std::vector<TileHashKernel> kernels;
+    for (TileHashKernel k : {TileHashKernel::Scalar, TileHashKernel::CRC32, TileHashKernel::NEON,
+                             TileHashKernel::SSE42, TileHashKernel::AVX2}) {
+        if (TileHashKernelSupported(k))
+            kernels.push_back(k);
+    }
+    const bool haveCRC32 = TileHashKernelSupported(TileHashKernel::CRC32);
+
+    int cases = 0;
+    for (int c = 0; c < 400; ++c) {
+        // Mostly pixel-sized tiles (multiples of 4 bytes), some arbitrary byte counts
+        size_t tileBytes = (c % 4 == 3) ? (size_t)rnd.range(1, 300) : (size_t)rnd.range(1, 80) * 4;
+        int tiles = rnd.range(1, 23);
+        size_t lastTileBytes = (c % 3 == 0) ? tileBytes : (size_t)rnd.range(1, (int)tileBytes);
+        size_t rowBytes = (size_t)(tiles - 1) * tileBytes + lastTileBytes;
+        std::vector<uint8_t> rows(rowBytes * kRowsPerCase);
+        for (uint8_t &b : rows)
+            b = (uint8_t)rnd.next();
+
+        std::vector<uint64_t> scalar;
+        for (TileHashKernel k : kernels) {
+            const TileHashOps &ops = TileHashResolve(k);
+            CHECK(ops.kernel == k, "%s resolved to %s", TileHashKernelName(k), ops.name);
+            std::vector<uint64_t> row((size_t)tiles, ops.basis), single((size_t)tiles, ops.basis);
+            std::vector<uint64_t> update((size_t)tiles, ops.basis);
+            for (int y = 0; y < kRowsPerCase; ++y) {
+                const uint8_t *p = rows.data() + (size_t)y * rowBytes;
+                ops.hashRow(row.data(), p, tiles, tileBytes, lastTileBytes);
+                for (int tx = 0; tx < tiles; ++tx) {
+                    size_t len = (tx == tiles - 1) ? lastTileBytes : tileBytes;
+                    ops.hashRow(&single[(size_t)tx], p + (size_t)tx * tileBytes, 1, len, len);
+                    update[(size_t)tx] = ops.update(update[(size_t)tx], p + (size_t)tx * tileBytes, len);
+                }
+            }
+            for (int tx = 0; tx < tiles; ++tx) {
+                const size_t i = (size_t)tx;
+                CHECK(row[i] == single[i], "%s: tile %d of %d (tileBytes %zu, last %zu) differs from single-tile",
+                      ops.name, tx, tiles, tileBytes, lastTileBytes);
+                if (k == TileHashKernel::Scalar || k == TileHashKernel::CRC32 || k == TileHashKernel::SSE42)
+                    CHECK(row[i] == update[i], "%s: tile %d of %d (tileBytes %zu, last %zu) differs from update()",
+                          ops.name, tx, tiles, tileBytes, lastTileBytes);
+            }
+            if (k == TileHashKernel::Scalar)
+                scalar = row;
+            if (k == TileHashKernel::CRC32)
+                CHECK(row == scalar, "crc32: differs from scalar (tileBytes %zu, last %zu)", tileBytes, lastTileBytes);
+        }
+        cases++;
+    }
+    printf("%d cases, %zu kernels%s\n", cases, kernels.size(), haveCRC32 ? "" : " (no ARM CRC32 on this CPU)");
+    return TEST_RESULT();
+}
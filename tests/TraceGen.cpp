@@ -0,0 +1,112 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// tvnc-tracegen: writes the frame traces checked in under tests/traces (see FrameTrace.h for the format).
+//
+//     tvnc-tracegen <scattered|scroll|mixed> <width> <height> <frames> <seed> > tests/traces/<name>.trace
+//
+// scattered: small independent updates all over the screen (carets, badges, spinners, list cells), with
+//            occasional bursts of many tiny updates that exceed the server's rect limit.
+// scroll:    a list scrolling under a fixed status bar and tab bar, at varying speeds, with a blinking caret.
+// mixed:     a video region, a scrolling feed, a sliding panel and scattered text changes.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "FrameTrace.h"
+
+static void usage(void) {
+    fprintf(stderr, "usage: tvnc-tracegen <scattered|scroll|mixed> <width> <height> <frames> <seed>\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 6)
+        usage();
+    const std::string mode = argv[1];
+    const int W = atoi(argv[2]), H = atoi(argv[3]), frames = atoi(argv[4]);
+    const uint64_t seed = strtoull(argv[5], nullptr, 10);
+    if (W <= 0 || H <= 0 || frames <= 0 || (mode != "scattered" && mode != "scroll" && mode != "mixed"))
+        usage();
+
+    TraceRandom rnd(seed);
+    const int statusH = std::max(20, H * 47 / 844);
+    const int tabH = std::max(24, H * 83 / 844);
+    const int contentY = statusH, contentH = H - statusH - tabH;
+
+    printf("# generated: tvnc-tracegen %s %d %d %d %llu\n", mode.c_str(), W, H, frames, (unsigned long long)seed);
+    printf("trace %d %d\n", W, H);
+    printf("frame\nbase %llu\n", (unsigned long long)rnd.next());
+
+    for (int f = 1; f < frames; ++f) {
+        printf("frame\n");
+        if (mode == "scattered") {
+            // Caret blink in a text field
+            printf("fill %d %d 2 18 %s\n", W / 3, contentY + 40, (f & 1) ? "007aff" : "ffffff");
+            int updates = rnd.range(1, 10);
+            if (f % 9 == 0)
+                updates = rnd.range(300, 500); // burst: more rects than the server sends
+            for (int i = 0; i < updates; ++i) {
+                int w = rnd.range(4, 60), h = rnd.range(4, 40);
+                int x = rnd.range(0, W - w), y = rnd.range(0, H - h);
+                switch (rnd.range(0, 3)) {
+                case 0:
+                    printf("text %d %d %d %d %llu\n", x, y, w, h, (unsigned long long)rnd.next());
+                    break;
+                case 1:
+                    printf("fill %d %d %d %d %06x\n", x, y, w, h, (unsigned)(rnd.next() & 0xFFFFFF));
+                    break;
+                default:
+                    printf("noise %d %d %d %d %llu\n", x, y, std::min(w, 24), std::min(h, 24),
+                           (unsigned long long)rnd.next());
+                    break;
+                }
+            }
+        } else if (mode == "scroll") {
+            static const int speeds[] = {-4, -12, -24, -40, -40, -24, -12, -6, 0, 8, 16};
+            int dy = speeds[(f / 3) % (int)(sizeof(speeds) / sizeof(speeds[0]))];
+            if (dy != 0)
+                printf("scroll 0 %d %d %d %d %llu\n", contentY, W, contentH, dy, (unsigned long long)rnd.next());
+            // Scroll indicator on the right edge
+            printf("fill %d %d 3 %d 8e8e93\n", W - 5, contentY + (f * 7) % (contentH - 40), 36);
+            if (f % 4 == 0)
+                printf("fill %d %d 2 18 %s\n", W / 2, statusH / 4, (f & 4) ? "000000" : "f2f2f7");
+        } else {
+            const int videoH = std::max(16, contentH / 4);
+            printf("noise 0 %d %d %d %llu\n", contentY, W, videoH, (unsigned long long)rnd.next());
+            if (f % 2 == 0)
+                printf("scroll 0 %d %d %d %d %llu\n", contentY + videoH, W, contentH - videoH, -rnd.range(6, 30),
+                       (unsigned long long)rnd.next());
+            if (f % 10 >= 6) {
+                // Panel sliding in from the right
+                int step = W / 8;
+                printf("move %d %d %d %d %d 0\n", step, contentY + videoH, W - step, contentH / 2, -step);
+                printf("text %d %d %d %d %llu\n", W - step, contentY + videoH, step, contentH / 2,
+                       (unsigned long long)rnd.next());
+            }
+            for (int i = rnd.range(0, 4); i > 0; --i) {
+                int w = rnd.range(8, 80), h = rnd.range(10, 24);
+                printf("text %d %d %d %d %llu\n", rnd.range(0, W - w), rnd.range(0, H - h), w, h,
+                       (unsigned long long)rnd.next());
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ This file is part of TrollVNC
+ Copyright (c) 2025 82Flex <82flex@gmail.com> and contributors
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// WorkerPool scheduling: every chunk of a batch runs exactly once, also when idle lanes steal from a slow one,
+// batches submitted back to back complete independently, and destroying the pool runs what is still queued.
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "TestSupport.h"
+#include "WorkerPool.h"
+
+// Per-chunk run counters of one batch.
+struct ChunkCounts {
+    std::vector<std::atomic<int>> runs;
+
+    explicit ChunkCounts(int chunks) : runs((size_t)chunks) {}
+
+    WorkerPool::ChunkFn counter() {
+        return [this](int chunk) { runs[(size_t)chunk].fetch_add(1, std::memory_order_relaxed); };
+    }
+
+    // Chunks that did not run exactly once.
+    int wrong() const {
+        int n = 0;
+        for (const std::atomic<int> &r : runs)
+            n += r.load() != 1;
+        return n;
+    }
+};
+
+static uint64_t totalSteals(const std::vector<WorkerPool::LaneStats> &stats, uint64_t *outChunks = nullptr) {
+    uint64_t steals = 0, chunks = 0;
+    for (const WorkerPool::LaneStats &s : stats) {
+        steals += s.steals;
+        chunks += s.chunks;
+    }
+    if (outChunks)
+        *outChunks = chunks;
+    return steals;
+}
+
+static void testParallelFor() {
+    WorkerPool pool(3);
+    CHECK(pool.workerCount() == 3 && pool.laneCount() == 4, "pool: %d workers, %d lanes", pool.workerCount(),
+          pool.laneCount());
+    pool.takeStats();
+    uint64_t expected = 0;
+    for (int chunks : {1, 2, 3, 4, 5, 17, 100, 1000}) {
+        ChunkCounts counts(chunks);
+        pool.parallelFor(chunks, counts.counter());
+        CHECK(counts.wrong() == 0, "parallelFor %d: %d chunks did not run exactly once", chunks, counts.wrong());
+        if (chunks > 1)
+            expected += (uint64_t)chunks; // a single chunk runs inline, outside the lane stats
+    }
+    uint64_t chunksRun = 0;
+    totalSteals(pool.takeStats(), &chunksRun);
+    CHECK(chunksRun == expected, "parallelFor: lanes ran %llu chunks, expected %llu", (unsigned long long)chunksRun,
+          (unsigned long long)expected);
+}
+
+// Lane 1's block is slow: the other lanes finish theirs and steal from it, and still every chunk runs once.
+static void testStealing() {
+    WorkerPool pool(3);
+    const int chunks = 64, lanes = pool.laneCount();
+    const int slowBegin = chunks / lanes, slowEnd = 2 * chunks / lanes;
+    for (int round = 0; round < 3; ++round) {
+        ChunkCounts counts(chunks);
+        pool.takeStats();
+        pool.parallelFor(chunks, [&counts, slowBegin, slowEnd](int chunk) {
+            if (chunk >= slowBegin && chunk < slowEnd)
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            counts.runs[(size_t)chunk].fetch_add(1, std::memory_order_relaxed);
+        });
+        uint64_t chunksRun = 0;
+        uint64_t steals = totalSteals(pool.takeStats(), &chunksRun);
+        CHECK(counts.wrong() == 0, "steal round %d: %d chunks did not run exactly once", round, counts.wrong());
+        CHECK(chunksRun == (uint64_t)chunks, "steal round %d: lanes ran %llu chunks of %d", round,
+              (unsigned long long)chunksRun, chunks);
+        CHECK(steals > 0, "steal round %d: no lane stole from the slow one", round);
+    }
+}
+
+// Batches overlap: both are queued before either is waited, and each completes on its own.
+static void testSubmitWait() {
+    WorkerPool pool(2);
+    for (int round = 0; round < 20; ++round) {
+        ChunkCounts a(37), b(5);
+        WorkerPool::BatchRef first = pool.submit(37, a.counter());
+        WorkerPool::BatchRef second = pool.submit(5, b.counter());
+        pool.wait(second);
+        CHECK(WorkerPool::done(second), "submit round %d: second batch not done after wait", round);
+        CHECK(b.wrong() == 0, "submit round %d: %d chunks of the second batch wrong", round, b.wrong());
+        pool.wait(first);
+        CHECK(WorkerPool::done(first), "submit round %d: first batch not done after wait", round);
+        CHECK(a.wrong() == 0, "submit round %d: %d chunks of the first batch wrong", round, a.wrong());
+    }
+    pool.wait(nullptr);
+    CHECK(WorkerPool::done(nullptr), "submit: null batch not done");
+}
+
+// Zero workers asks for the default (one per CPU beyond the caller's, at least one); empty batches are done
+// right away and a single chunk runs on the calling thread.
+static void testZeroWorkers() {
+    WorkerPool pool(0);
+    const int cpus = (int)std::thread::hardware_concurrency();
+    const int want = cpus > 1 ? cpus - 1 : 1;
+    CHECK(pool.workerCount() == want, "zero: %d workers for %d CPUs, expected %d", pool.workerCount(), cpus, want);
+    CHECK(pool.laneCount() == pool.workerCount() + 1, "zero: %d lanes for %d workers", pool.laneCount(),
+          pool.workerCount());
+
+    std::atomic<int> calls{0};
+    pool.parallelFor(0, [&calls](int) { calls++; });
+    WorkerPool::BatchRef empty = pool.submit(0, [&calls](int) { calls++; });
+    CHECK(WorkerPool::done(empty), "zero: empty batch not done");
+    pool.wait(empty);
+    CHECK(calls.load() == 0, "zero: %d chunks of empty batches ran", calls.load());
+
+    std::thread::id ranOn;
+    pool.parallelFor(1, [&ranOn](int) { ranOn = std::this_thread::get_id(); });
+    CHECK(ranOn == std::this_thread::get_id(), "zero: single chunk did not run on the caller");
+
+    ChunkCounts counts(250);
+    pool.parallelFor(250, counts.counter());
+    CHECK(counts.wrong() == 0, "zero: %d chunks did not run exactly once", counts.wrong());
+}
+
+// Workers drain the queues before they exit, so a batch never waited is complete once the pool is gone.
+static void testShutdownWithQueuedWork() {
+    for (int workers : {1, 3}) {
+        ChunkCounts counts(200);
+        WorkerPool::BatchRef batch;
+        {
+            auto pool = std::make_unique<WorkerPool>(workers);
+            batch = pool->submit(200, [&counts](int chunk) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                counts.runs[(size_t)chunk].fetch_add(1, std::memory_order_relaxed);
+            });
+            CHECK(!WorkerPool::done(batch), "shutdown %d: batch done before the pool went away", workers);
+        }
+        CHECK(WorkerPool::done(batch), "shutdown %d: batch not done after the pool went away", workers);
+        CHECK(counts.wrong() == 0, "shutdown %d: %d chunks did not run exactly once", workers, counts.wrong());
+    }
+}
+
+int main() {
+    testParallelFor();
+    testStealing();
+    testSubmitWait();
+    testZeroWorkers();
+    testShutdownWithQueuedWork();
+    return TEST_RESULT();
+}